@@ -58,6 +58,35 @@ endif
 
 include $(BUILD_EXECUTABLE)
 
+##########################################################
+# Host stress test for the Zygote service request queue
+##########################################################
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := xposed_service_queue_test.cpp
+LOCAL_CFLAGS += -Wall -Werror -Wextra -Wunused
+LOCAL_LDLIBS := -lpthread
+LOCAL_MODULE := xposed_service_queue_test
+LOCAL_MODULE_TAGS := tests
+LOCAL_MODULE_HOST_OS := linux
+
+include $(BUILD_HOST_NATIVE_TEST)
+
+##########################################################
+# Host fork-storm benchmark for the file descriptor table
+##########################################################
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := fd_utils_benchmark.cpp
+LOCAL_CFLAGS += -Wall -Werror -Wextra -Wunused
+LOCAL_CFLAGS += -DPLATFORM_SDK_VERSION=$(PLATFORM_SDK_VERSION)
+LOCAL_SHARED_LIBRARIES := liblog libnativehelper
+LOCAL_MODULE := fd_utils_benchmark
+LOCAL_MODULE_TAGS := tests
+LOCAL_MODULE_HOST_OS := linux
+
+include $(BUILD_HOST_EXECUTABLE)
+
 ##########################################################
 # Library for Dalvik-/ART-specific functions
 ##########################################################
@@ -61,6 +61,11 @@ class FileDescriptorInfo {
       return NULL;
     }
 
+    return createFromStat(fd, f_stat);
+  }
+
+  // Same as createFromFd(), for a file descriptor that has just been stat'ed.
+  static FileDescriptorInfo* createFromStat(int fd, const struct stat& f_stat) {
     if (S_ISSOCK(f_stat.st_mode)) {
       std::string socket_name;
       if (!GetSocketName(fd, &socket_name)) {
@@ -85,6 +90,13 @@ class FileDescriptorInfo {
       return NULL;
     }
 
+    return createFromPath(fd, f_stat, file_path);
+  }
+
+  // Same as createFromStat(), for a file that is known to be whitelisted. This
+  // skips resolving the path, but the flags and the offset are read again.
+  static FileDescriptorInfo* createFromPath(int fd, const struct stat& f_stat,
+                                            const std::string& file_path) {
     // We only handle whitelisted regular files and character devices. Whitelisted
     // character devices must provide a guarantee of sensible behaviour when
     // reopened.
@@ -331,58 +343,119 @@ class FileDescriptorInfo {
 };
 
 // A FileDescriptorTable is a collection of FileDescriptorInfo objects
-// keyed by their FDs.
+// keyed by their FDs. It is kept across forks, so that descriptors which
+// still refer to the same file don't need to be resolved again.
 class FileDescriptorTable {
  public:
   // Creates a new FileDescriptorTable. This function scans
-  // /proc/self/fd for the list of open file descriptors and collects
-  // information about them. Returns NULL if an error occurs.
+  // /proc/self/fd for the list of open file descriptors, collects
+  // information about them and detaches the whitelisted ones. Returns NULL
+  // if an error occurs.
   static FileDescriptorTable* Create() {
+    FileDescriptorTable* table = new FileDescriptorTable();
+    if (!table->Restat()) {
+      delete table;
+      return NULL;
+    }
+    return table;
+  }
+
+  ~FileDescriptorTable() {
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+      delete it->second.info;
+    }
+  }
+
+  // Scans /proc/self/fd again and detaches the whitelisted file descriptors,
+  // to be called before the next fork after Reopen(). A descriptor that
+  // still refers to the same device and inode as during the last scan isn't
+  // resolved again. Its whitelisted status and path are reused, only the
+  // flags and the offset of files are read again. Returns false if
+  // /proc/self/fd can't be read, then nothing has been detached.
+  bool Restat() {
     DIR* d = opendir(kFdPath);
     if (d == NULL) {
       ALOGE("Unable to open directory %s: %s", kFdPath, strerror(errno));
-      return NULL;
+      return false;
     }
     int dir_fd = dirfd(d);
     dirent* e;
 
-    std::unordered_map<int, FileDescriptorInfo*> open_fd_map;
+    ++generation_;
     while ((e = readdir(d)) != NULL) {
       const int fd = ParseFd(e, dir_fd);
       if (fd == -1) {
         continue;
       }
 
-      FileDescriptorInfo* info = FileDescriptorInfo::createFromFd(fd);
-      if (info == NULL) {
+      struct stat f_stat;
+      if (TEMP_FAILURE_RETRY(fstat(fd, &f_stat)) == -1) {
+        ALOGE("Unable to stat fd %d : %s", fd, strerror(errno));
         continue;
       }
-      info->Detach();
-      open_fd_map[fd] = info;
+
+      // New entries are value-initialized, i.e. without info.
+      Entry& entry = entries_[fd];
+      if (entry.generation != 0 && entry.dev == f_stat.st_dev && entry.ino == f_stat.st_ino) {
+        if (entry.info != NULL && !entry.info->is_sock) {
+          FileDescriptorInfo* info =
+              FileDescriptorInfo::createFromPath(fd, f_stat, entry.info->file_path);
+          delete entry.info;
+          entry.info = info;
+        }
+      } else {
+        delete entry.info;
+        entry.dev = f_stat.st_dev;
+        entry.ino = f_stat.st_ino;
+        entry.info = FileDescriptorInfo::createFromStat(fd, f_stat);
+      }
+      entry.generation = generation_;
+
+      if (entry.info != NULL) {
+        entry.info->Detach();
+      }
     }
 
+    // Entries which haven't been seen have been closed in the meantime.
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      if (it->second.generation != generation_) {
+        delete it->second.info;
+        it = entries_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+
+    // The descriptors have been detached already, so the table must be kept.
     if (closedir(d) == -1) {
       ALOGE("Unable to close directory : %s", strerror(errno));
-      return NULL;
     }
-    return new FileDescriptorTable(open_fd_map);
+    return true;
   }
 
-  // Reopens all file descriptors that are contained in the table.
+  // Reopens all file descriptors that have been detached by the last scan.
+  // The table is kept for the next call to Restat().
   void Reopen() {
-    std::unordered_map<int, FileDescriptorInfo*>::const_iterator it;
-    for (it = open_fd_map_.begin(); it != open_fd_map_.end(); ++it) {
-      const FileDescriptorInfo* info = it->second;
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+      const FileDescriptorInfo* info = it->second.info;
       if (info != NULL) {
         info->Reopen();
-        delete info;
       }
     }
   }
 
  private:
-  FileDescriptorTable(const std::unordered_map<int, FileDescriptorInfo*>& map)
-      : open_fd_map_(map) {
+  // A file descriptor seen by the last scan. The info is NULL if it wasn't
+  // whitelisted, then it is ignored as long as it refers to the same file.
+  struct Entry {
+    dev_t dev;
+    ino_t ino;
+    FileDescriptorInfo* info;
+    // The scan in which the descriptor was seen last, 0 for new entries.
+    uint32_t generation;
+  };
+
+  FileDescriptorTable() : generation_(0) {
   }
 
   static int ParseFd(dirent* e, int dir_fd) {
@@ -401,8 +474,8 @@ class FileDescriptorTable {
     return fd;
   }
 
-  // Invariant: All values in this unordered_map are non-NULL.
-  std::unordered_map<int, FileDescriptorInfo*> open_fd_map_;
+  std::unordered_map<int, Entry> entries_;
+  uint32_t generation_;
 
   // DISALLOW_COPY_AND_ASSIGN(FileDescriptorTable);
   FileDescriptorTable(const FileDescriptorTable&);
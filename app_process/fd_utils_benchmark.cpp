@@ -0,0 +1,112 @@
+/**
+ * Host-side fork-storm benchmark for the FileDescriptorTable that is used around Zygote forks.
+ *
+ * Usage: fd_utils_benchmark [<open descriptors> [<forks>]]
+ */
+
+#define LOG_TAG "Xposed"
+
+#include "fd_utils-inl.h"
+
+#include <stdio.h>
+#include <sys/wait.h>
+#include <time.h>
+
+static uint64_t nanoTime() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + now.tv_nsec;
+}
+
+// Opens files and sockets, about half of each, like the many jars, fonts and sockets of Zygote.
+static bool openDescriptors(int count, std::vector<int>* fds) {
+    char path[] = "/tmp/fd_utils_benchmark.XXXXXX";
+    int tmp = mkstemp(path);
+    if (tmp < 0) {
+        perror("mkstemp");
+        return false;
+    }
+    fds->push_back(tmp);
+
+    while ((int) fds->size() < count) {
+        if (fds->size() % 2 == 0) {
+            int fd = open(path, O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                perror("open");
+                return false;
+            }
+            fds->push_back(fd);
+        } else {
+            int sockets[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0) {
+                perror("socketpair");
+                return false;
+            }
+            fds->push_back(sockets[0]);
+            fds->push_back(sockets[1]);
+        }
+    }
+
+    unlink(path);
+    return true;
+}
+
+// Forks like Zygote does with Xposed, see XposedBridge_closeFilesBeforeForkNative() and
+// XposedBridge_reopenFilesAfterForkNative(). Returns the average table time per fork in ns.
+static uint64_t forkStorm(int forks, bool incremental, uint64_t* totalPerFork) {
+    FileDescriptorTable* table = NULL;
+    uint64_t tableTime = 0;
+    uint64_t start = nanoTime();
+
+    for (int i = 0; i < forks; i++) {
+        uint64_t before = nanoTime();
+        if (table == NULL) {
+            table = FileDescriptorTable::Create();
+        } else {
+            table->Restat();
+        }
+        tableTime += nanoTime() - before;
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            _exit(0);
+        } else if (pid < 0) {
+            perror("fork");
+            exit(1);
+        }
+
+        before = nanoTime();
+        table->Reopen();
+        if (!incremental) {
+            delete table;
+            table = NULL;
+        }
+        tableTime += nanoTime() - before;
+
+        waitpid(pid, NULL, 0);
+    }
+
+    *totalPerFork = (nanoTime() - start) / forks;
+    delete table;
+    return tableTime / forks;
+}
+
+int main(int argc, char** argv) {
+    int count = (argc > 1) ? atoi(argv[1]) : 200;
+    int forks = (argc > 2) ? atoi(argv[2]) : 500;
+
+    std::vector<int> fds;
+    if (count <= 0 || forks <= 0 || !openDescriptors(count, &fds)) {
+        fprintf(stderr, "Usage: %s [<open descriptors> [<forks>]]\n", argv[0]);
+        return 1;
+    }
+
+    for (int incremental = 0; incremental <= 1; incremental++) {
+        uint64_t total;
+        uint64_t table = forkStorm(forks, incremental, &total);
+        printf("%-11s %zu descriptors, %d forks: table %.1f us/fork, total %.1f us/fork\n",
+               incremental ? "incremental" : "full", fds.size(), forks, table / 1e3, total / 1e3);
+    }
+
+    return 0;
+}
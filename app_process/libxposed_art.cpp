@@ -4,6 +4,8 @@
 
 #define LOG_TAG "Xposed"
 
+#include <sstream>
+
 #include "xposed_shared.h"
 #include "libxposed_common.h"
 #if PLATFORM_SDK_VERSION >= 21
@@ -25,8 +27,10 @@
 #include "well_known_classes.h"
 
 #if PLATFORM_SDK_VERSION >= 24
+#include "jit/jit.h"
 #include "mirror/abstract_method.h"
 #include "thread_list.h"
+#include "xposed_hook_stats.h"
 #endif
 
 using namespace art;
@@ -95,9 +99,65 @@ void XposedBridge_hookMethodNative(JNIEnv* env, jclass, jobject javaReflectedMet
     artMethod->EnableXposedHook(soa, javaAdditionalInfo);
 }
 
+#if PLATFORM_SDK_VERSION >= 24
+void XposedBridge_hookMethodsNative(JNIEnv* env, jclass, jobjectArray javaReflectedMethods,
+            jobjectArray javaAdditionalInfos) {
+    // Detect usage errors.
+    ScopedObjectAccess soa(env);
+    if (javaReflectedMethods == nullptr || javaAdditionalInfos == nullptr) {
+        ThrowIllegalArgumentException("methods and additional infos must not be null");
+        return;
+    }
+    auto* reflectedMethods = soa.Decode<mirror::ObjectArray<mirror::AbstractMethod>*>(javaReflectedMethods);
+    auto* additionalInfoObjects = soa.Decode<mirror::ObjectArray<mirror::Object>*>(javaAdditionalInfos);
+    size_t count = reflectedMethods->GetLength();
+    if (static_cast<size_t>(additionalInfoObjects->GetLength()) != count) {
+        ThrowIllegalArgumentException("methods and additional infos must have the same length");
+        return;
+    }
+
+    // Get the ArtMethods of the methods to be hooked. The additional infos are kept in global
+    // references, as there might be more of them than the local reference table can hold.
+    std::vector<ArtMethod*> artMethods;
+    std::vector<jobject> additionalInfos;
+    artMethods.reserve(count);
+    additionalInfos.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        auto* reflectedMethod = reflectedMethods->Get(i);
+        if (reflectedMethod == nullptr) {
+            for (jobject additionalInfo : additionalInfos) {
+                soa.Vm()->DeleteGlobalRef(soa.Self(), additionalInfo);
+            }
+            ThrowIllegalArgumentException("method must not be null");
+            return;
+        }
+        artMethods.push_back(reflectedMethod->GetArtMethod());
+        additionalInfos.push_back(soa.Vm()->AddGlobalRef(soa.Self(), additionalInfoObjects->Get(i)));
+    }
+
+    // Hook the methods, stopping the world only once.
+    ArtMethod::EnableXposedHooks(soa, artMethods, additionalInfos);
+
+    for (jobject additionalInfo : additionalInfos) {
+        soa.Vm()->DeleteGlobalRef(soa.Self(), additionalInfo);
+    }
+}
+#endif
+
 jobject XposedBridge_invokeOriginalMethodNative(JNIEnv* env, jclass, jobject javaMethod,
             jint isResolved, jobjectArray, jclass, jobject javaReceiver, jobjectArray javaArgs) {
     ScopedFastNativeObjectAccess soa(env);
+#if PLATFORM_SDK_VERSION >= 24
+    // Call the backup directly if we can find its hook info. The hook installation has
+    // already checked everything that reflection would check for the backup.
+    ArtMethod* hookedMethod = ArtMethod::FromReflectedMethod(soa, javaMethod);
+    if (LIKELY(hookedMethod->IsXposedOriginalMethod())) {
+        hookedMethod = hookedMethod->GetXposedHookedMethod();
+    }
+    if (LIKELY(hookedMethod != nullptr && hookedMethod->IsXposedHookedMethod())) {
+        return InvokeXposedOriginalMethod(soa, hookedMethod->GetXposedHookInfo(), javaReceiver, javaArgs);
+    }
+#endif
     if (UNLIKELY(!isResolved)) {
         ArtMethod* artMethod = ArtMethod::FromReflectedMethod(soa, javaMethod);
         if (LIKELY(artMethod->IsXposedHookedMethod())) {
@@ -139,9 +199,34 @@ void XposedBridge_setObjectClassNative(JNIEnv* env, jclass, jobject javaObj, jcl
     obj->SetClass(clazz.Get());
 }
 
-void XposedBridge_dumpObjectNative(JNIEnv*, jclass, jobject) {
-    // TODO Can be useful for debugging
-    UNIMPLEMENTED(ERROR|LOG_XPOSED);
+#if PLATFORM_SDK_VERSION >= 24
+/** Returns the hooked method for a reflected hooked method or its backup, or null. */
+static ArtMethod* getHookedMethod(ScopedObjectAccess& soa, jobject javaMethod) {
+    ArtMethod* artMethod = ArtMethod::FromReflectedMethod(soa, javaMethod);
+    if (artMethod->IsXposedOriginalMethod()) {
+        artMethod = artMethod->GetXposedHookedMethod();
+    }
+    return (artMethod != nullptr && artMethod->IsXposedHookedMethod()) ? artMethod : nullptr;
+}
+#endif
+
+void XposedBridge_dumpObjectNative(JNIEnv* env, jclass, jobject javaObj) {
+    ScopedObjectAccess soa(env);
+    std::ostringstream os;
+    os << "Object " << PrettyTypeOf(soa.Decode<mirror::Object*>(javaObj));
+#if PLATFORM_SDK_VERSION >= 24
+    // For hooked methods, include the call statistics.
+    if (javaObj != nullptr && env->IsInstanceOf(javaObj, WellKnownClasses::java_lang_reflect_AbstractMethod)) {
+        ArtMethod* hookedMethod = getHookedMethod(soa, javaObj);
+        XposedHookStats* stats = (hookedMethod != nullptr)
+            ? XposedHookStats::Get(hookedMethod->GetXposedHookInfo()) : nullptr;
+        if (stats != nullptr) {
+            os << ", hook ";
+            stats->Dump(os);
+        }
+    }
+#endif
+    XLOG(INFO) << os.str();
 }
 
 jobject XposedBridge_cloneToSubclassNative(JNIEnv* env, jclass, jobject javaObject, jclass javaClazz) {
@@ -168,16 +253,33 @@ jint XposedBridge_getRuntime(JNIEnv*, jclass) {
 }
 
 #if PLATFORM_SDK_VERSION >= 21
+// Kept across forks in Zygote, so that only new or changed file descriptors need to be resolved.
 static FileDescriptorTable* gClosedFdTable = NULL;
+// The process which created the table. Forked children don't need it after the specialization.
+static pid_t gClosedFdTablePid = 0;
 
 void XposedBridge_closeFilesBeforeForkNative(JNIEnv*, jclass) {
-    gClosedFdTable = FileDescriptorTable::Create();
+#if XPOSED_WITH_SELINUX
+    // Zygote doesn't allow forking with unknown sockets.
+    xposed->zygoteservice_closeFdChannel();
+#endif  // XPOSED_WITH_SELINUX
+    if (gClosedFdTable == NULL) {
+        gClosedFdTable = FileDescriptorTable::Create();
+        gClosedFdTablePid = getpid();
+    } else if (!gClosedFdTable->Restat()) {
+        delete gClosedFdTable;
+        gClosedFdTable = NULL;
+    }
 }
 
 void XposedBridge_reopenFilesAfterForkNative(JNIEnv*, jclass) {
-    gClosedFdTable->Reopen();
-    delete gClosedFdTable;
-    gClosedFdTable = NULL;
+    if (gClosedFdTable != NULL) {
+        gClosedFdTable->Reopen();
+        if (getpid() != gClosedFdTablePid) {
+            delete gClosedFdTable;
+            gClosedFdTable = NULL;
+        }
+    }
 }
 #endif
 
@@ -187,25 +289,74 @@ void XposedBridge_invalidateCallersNative(JNIEnv* env, jclass, jobjectArray java
     auto* runtime = Runtime::Current();
     auto* cl = runtime->GetClassLinker();
 
-    // Invalidate callers of the given methods.
+    // Invalidate callers of the given methods. This might suspend the thread, so collect the
+    // ArtMethods first, they don't move.
     auto* abstract_methods = soa.Decode<mirror::ObjectArray<mirror::AbstractMethod>*>(javaMethods);
     size_t count = abstract_methods->GetLength();
+    std::vector<ArtMethod*> methods;
+    methods.reserve(count);
     for (size_t i = 0; i < count; i++) {
         auto* abstract_method = abstract_methods->Get(i);
         if (abstract_method == nullptr) {
             continue;
         }
-        ArtMethod* method = abstract_method->GetArtMethod();
-        cl->InvalidateCallersForMethod(soa.Self(), method);
+        methods.push_back(abstract_method->GetArtMethod());
+    }
+    cl->InvalidateCallersForMethods(soa.Self(), methods);
+
+    // Now instrument the frames returning to invalidated methods which are being called right now,
+    // so that they are deoptimized.
+    {
+        ScopedThreadSuspension sts(soa.Self(), kSuspended);
+        ScopedSuspendAll ssa(__FUNCTION__);
+        MutexLock mu(soa.Self(), *Locks::thread_list_lock_);
+        runtime->GetThreadList()->ForEach([](Thread* thread, void*) SHARED_REQUIRES(Locks::mutator_lock_) {
+            Runtime::Current()->GetInstrumentation()->InstrumentInvalidatedCallerFrames(thread);
+        }, nullptr);
+    }
+
+    // Compile the invalidated callers again right away, like after installing hooks.
+    jit::Jit* jit = runtime->GetJit();
+    if (jit != nullptr) {
+        jit->CompileScheduledMethods(soa.Self());
+    }
+}
+
+void XposedBridge_setHookStatsEnabledNative(JNIEnv*, jclass, jboolean enabled) {
+    XposedHookStats::SetEnabled(enabled);
+}
+
+jlongArray XposedBridge_getHookStatsNative(JNIEnv* env, jclass, jobject javaMethod) {
+    XposedHookStats* stats = nullptr;
+    {
+        ScopedObjectAccess soa(env);
+        if (javaMethod == nullptr) {
+            ThrowIllegalArgumentException("method must not be null");
+            return nullptr;
+        }
+        ArtMethod* hookedMethod = getHookedMethod(soa, javaMethod);
+        if (hookedMethod != nullptr) {
+            stats = XposedHookStats::Get(hookedMethod->GetXposedHookInfo());
+        }
+    }
+    if (stats == nullptr) {
+        return nullptr;
     }
 
-    // Now instrument the stack to deoptimize methods which are being called right now.
-    ScopedThreadSuspension sts(soa.Self(), kSuspended);
-    ScopedSuspendAll ssa(__FUNCTION__);
-    MutexLock mu(soa.Self(), *Locks::thread_list_lock_);
-    runtime->GetThreadList()->ForEach([](Thread* thread, void*) SHARED_REQUIRES(Locks::mutator_lock_) {
-        Runtime::Current()->GetInstrumentation()->InstrumentThreadStack(thread);
-    }, nullptr);
+    // Same order as the fields of XposedHookStats::Snapshot.
+    XposedHookStats::Snapshot snapshot = stats->GetSnapshot();
+    const jlong values[] = {
+        static_cast<jlong>(snapshot.calls),
+        static_cast<jlong>(snapshot.total_ns),
+        static_cast<jlong>(snapshot.max_ns),
+        static_cast<jlong>(snapshot.median_ns),
+        static_cast<jlong>(snapshot.p99_ns),
+    };
+    jlongArray result = env->NewLongArray(NELEM(values));
+    if (result != nullptr) {
+        env->SetLongArrayRegion(result, 0, NELEM(values), values);
+    }
+    return result;
 }
 #endif
 
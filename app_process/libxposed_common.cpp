@@ -39,6 +39,7 @@ static jmethodID constructorFileResult = NULL;
 ////////////////////////////////////////////////////////////
 
 static int register_natives_XposedBridge(JNIEnv* env, jclass clazz);
+static void register_optional_natives_XposedBridge(JNIEnv* env, jclass clazz);
 static int register_natives_XResources(JNIEnv* env, jclass clazz);
 static int register_natives_ZygoteService(JNIEnv* env, jclass clazz);
 
@@ -82,6 +83,7 @@ bool initXposedBridge(JNIEnv* env) {
         env->ExceptionClear();
         return false;
     }
+    register_optional_natives_XposedBridge(env, classXposedBridge);
 
     methodXposedBridgeHandleHookedMethod = env->GetStaticMethodID(classXposedBridge, "handleHookedMethod",
         "(Ljava/lang/reflect/Member;ILjava/lang/Object;Ljava/lang/Object;[Ljava/lang/Object;)Ljava/lang/Object;");
@@ -360,6 +362,23 @@ int register_natives_XposedBridge(JNIEnv* env, jclass clazz) {
     return env->RegisterNatives(clazz, methods, NELEM(methods));
 }
 
+/** Registers methods which older versions of XposedBridge don't declare. */
+void register_optional_natives_XposedBridge(JNIEnv* env, jclass clazz) {
+#if PLATFORM_SDK_VERSION >= 24
+    const JNINativeMethod methods[] = {
+        NATIVE_METHOD(XposedBridge, hookMethodsNative, "([Ljava/lang/reflect/Member;[Ljava/lang/Object;)V"),
+        NATIVE_METHOD(XposedBridge, setHookStatsEnabledNative, "(Z)V"),
+        NATIVE_METHOD(XposedBridge, getHookStatsNative, "(Ljava/lang/reflect/Member;)[J"),
+    };
+    for (size_t i = 0; i < NELEM(methods); i++) {
+        if (env->RegisterNatives(clazz, &methods[i], 1) != JNI_OK) {
+            ALOGD("Optional native method %s not declared in '%s'", methods[i].name, CLASS_XPOSED_BRIDGE);
+            env->ExceptionClear();
+        }
+    }
+#endif
+}
+
 int register_natives_XResources(JNIEnv* env, jclass clazz) {
     const JNINativeMethod methods[] = {
         NATIVE_METHOD(XResources, rewriteXmlReferencesNative, "(JLandroid/content/res/XResources;Landroid/content/res/Resources;)V"),
@@ -52,6 +52,10 @@ extern void    XposedBridge_reopenFilesAfterForkNative(JNIEnv* env, jclass clazz
 #endif
 #if PLATFORM_SDK_VERSION >= 24
 extern void    XposedBridge_invalidateCallersNative(JNIEnv*, jclass, jobjectArray javaMethods);
+extern void    XposedBridge_hookMethodsNative(JNIEnv* env, jclass clazz, jobjectArray reflectedMethodsIndirect,
+                                              jobjectArray additionalInfosIndirect);
+extern void    XposedBridge_setHookStatsEnabledNative(JNIEnv* env, jclass clazz, jboolean enabled);
+extern jlongArray XposedBridge_getHookStatsNative(JNIEnv* env, jclass clazz, jobject reflectedMethodIndirect);
 #endif
 
 }  // namespace xposed
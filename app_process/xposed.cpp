@@ -414,6 +414,7 @@ void onVmCreated(JNIEnv* env) {
     xposed->zygoteservice_accessFile = &service::membased::accessFile;
     xposed->zygoteservice_statFile   = &service::membased::statFile;
     xposed->zygoteservice_readFile   = &service::membased::readFile;
+    xposed->zygoteservice_closeFdChannel = &service::membased::closeFdChannel;
 #endif  // XPOSED_WITH_SELINUX
 
     if (xposedInitLib(xposed)) {
@@ -6,6 +6,7 @@
 
 #include "xposed.h"
 #include "xposed_service.h"
+#include "xposed_service_queue.h"
 
 #include <binder/BpBinder.h>
 #include <binder/IInterface.h>
@@ -13,11 +14,16 @@
 #include <binder/IServiceManager.h>
 #include <binder/Parcel.h>
 #include <binder/ProcessState.h>
+#include <utils/KeyedVector.h>
+#include <utils/RefBase.h>
+#include <utils/String8.h>
+#include <atomic>
 #include <errno.h>
 #include <fcntl.h>
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
 #include <sys/mman.h>
+#include <sys/socket.h>
 
 #define UID_SYSTEM 1000
 
@@ -34,23 +40,187 @@ bool running = false;
 
 
 ////////////////////////////////////////////////////////////
-// Memory-based communication (used by Zygote)
+// Cache for file contents
 ////////////////////////////////////////////////////////////
 
-namespace membased {
+namespace cache {
+
+// Limits for the cache, larger files are always read from disk.
+static const size_t kMaxFiles = 64;
+static const size_t kMaxBytes = 4 * 1024 * 1024;
+static const size_t kMaxFileSize = 1024 * 1024;
+// Log the hit/miss counters after this many lookups.
+static const uint32_t kLogInterval = 100;
+
+class CachedFile : public RefBase {
+    public:
+        CachedFile(const struct stat& st1, uint8_t* content1, size_t size1)
+                : st(st1), content(content1), size(size1), lastUse(0) {}
+
+        virtual ~CachedFile() {
+            free(content);
+        }
 
-enum State {
-    STATE_NOT_RUNNING,
-    STATE_IDLE,
-    STATE_SERVICE_ACTION,
-    STATE_SERVER_RESPONSE,
+        // Whether the file on disk is still the one that was cached.
+        bool matches(const struct stat& other) const {
+            return st.st_dev == other.st_dev
+                && st.st_ino == other.st_ino
+                && st.st_size == other.st_size
+#if PLATFORM_SDK_VERSION >= 21
+                && st.st_mtim.tv_sec == other.st_mtim.tv_sec
+                && st.st_mtim.tv_nsec == other.st_mtim.tv_nsec;
+#else
+                && st.st_mtime == other.st_mtime;
+#endif
+        }
+
+        // Metadata of the file from which the content was read.
+        const struct stat st;
+        uint8_t* const content;
+        const size_t size;
+        uint32_t lastUse;
 };
 
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static KeyedVector<String8, sp<CachedFile> > files;
+static size_t totalBytes = 0;
+static uint32_t useCounter = 0;
+static uint32_t hits = 0;
+static uint32_t misses = 0;
+
+// Reads a whole regular file, the caller has to check the size first.
+static sp<CachedFile> loadFile(const char* path) {
+    int fd = TEMP_FAILURE_RETRY(open(path, O_RDONLY | O_CLOEXEC));
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (size_t) st.st_size > kMaxFileSize) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = st.st_size;
+    uint8_t* content = (uint8_t*) malloc(size + 1);
+    if (content == NULL) {
+        close(fd);
+        return NULL;
+    }
+    content[size] = 0;
+
+    size_t offset = 0;
+    while (offset < size) {
+        ssize_t rc = TEMP_FAILURE_RETRY(read(fd, content + offset, size - offset));
+        if (rc <= 0) {
+            // Error or the file has been truncated, don't cache it.
+            free(content);
+            close(fd);
+            return NULL;
+        }
+        offset += rc;
+    }
+
+    close(fd);
+    return new CachedFile(st, content, size);
+}
+
+// Removes the cached content of a file, if any. The lock must be held.
+static void removeLocked(const String8& key) {
+    ssize_t index = files.indexOfKey(key);
+    if (index >= 0) {
+        totalBytes -= files.valueAt(index)->size;
+        files.removeItemsAt(index);
+    }
+}
+
+// Removes the least recently used files until there is enough space for the new one.
+static void evictFor(size_t size) {
+    while (files.size() > 0 && (files.size() >= kMaxFiles || totalBytes + size > kMaxBytes)) {
+        size_t oldest = 0;
+        for (size_t i = 1; i < files.size(); i++) {
+            if (files.valueAt(i)->lastUse < files.valueAt(oldest)->lastUse) {
+                oldest = i;
+            }
+        }
+        totalBytes -= files.valueAt(oldest)->size;
+        files.removeItemsAt(oldest);
+    }
+}
+
+/**
+ * Returns the content of a file, which has just been stat()ed with the given result. It's
+ * served from memory if the file's device, inode, size and modification time haven't changed.
+ * Returns NULL if the file can't or shouldn't be cached, then it should be read directly.
+ * The content might be from a newer version of the file, see CachedFile::st.
+ */
+static sp<CachedFile> getFile(const char* path, const struct stat& st) {
+    String8 key(path);
+    if (!S_ISREG(st.st_mode) || (size_t) st.st_size > kMaxFileSize) {
+        // The file might have been cacheable before, don't keep the old content around.
+        pthread_mutex_lock(&lock);
+        removeLocked(key);
+        pthread_mutex_unlock(&lock);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&lock);
+    sp<CachedFile> file = files.valueFor(key);
+    bool hit = file != NULL && file->matches(st);
+    if (hit) {
+        file->lastUse = ++useCounter;
+        hits++;
+    } else {
+        misses++;
+    }
+    if ((hits + misses) % kLogInterval == 0) {
+        ALOGD("File cache: %u hits, %u misses, %zu files with %zu bytes",
+              hits, misses, files.size(), totalBytes);
+    }
+    pthread_mutex_unlock(&lock);
+
+    if (hit) {
+        return file;
+    }
+
+    // Read the file without holding the lock, another thread might do the same
+    file = loadFile(path);
+
+    pthread_mutex_lock(&lock);
+    removeLocked(key);
+    if (file != NULL) {
+        evictFor(file->size);
+        file->lastUse = ++useCounter;
+        files.add(key, file);
+        totalBytes += file->size;
+    }
+    pthread_mutex_unlock(&lock);
+
+    return file;
+}
+
+// Forgets a file that can't be stat()ed anymore, e.g. because it has been deleted.
+static void removeFile(const char* path) {
+    pthread_mutex_lock(&lock);
+    removeLocked(String8(path));
+    pthread_mutex_unlock(&lock);
+}
+
+}  // namespace cache
+
+
+////////////////////////////////////////////////////////////
+// Memory-based communication (used by Zygote)
+////////////////////////////////////////////////////////////
+
+namespace membased {
+
 enum Action {
     OP_NONE,
     OP_ACCESS_FILE,
     OP_STAT_FILE,
     OP_READ_FILE,
+    OP_OPEN_FILE,
 };
 
 struct AccessFileData {
@@ -81,38 +251,50 @@ struct ReadFileData {
     char content[32*1024];
 };
 
-struct MemBasedState {
-    pthread_mutex_t workerMutex;
-    pthread_cond_t workerCond;
-    State state;
+struct OpenFileData {
+    // in
+    char path[PATH_MAX];
+    // out
+    bool sent;
+};
+
+struct MemBasedRequest {
     Action action;
     int error;
     union {
         AccessFileData accessFile;
         StatFileData statFile;
         ReadFileData readFile;
+        OpenFileData openFile;
     } data;
 };
 
+// Number of requests that can be handled at the same time, and threads handling them.
+static const int kNumSlots = 8;
+static const int kNumWorkers = 4;
+
+typedef SharedRequestQueue<MemBasedRequest, kNumSlots> MemBasedState;
+typedef MemBasedState::Slot Slot;
+
 MemBasedState* shared = NULL;
 pid_t zygotePid = 0;
 bool canAlwaysAccessService = false;
 
-inline static void initSharedMutex(pthread_mutex_t* mutex) {
-    pthread_mutexattr_t attr;
-    pthread_mutexattr_init(&attr);
-    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
-    pthread_mutex_init(mutex, &attr);
-    pthread_mutexattr_destroy(&attr);
-}
-
-inline static void initSharedCond(pthread_cond_t* cond) {
-    pthread_condattr_t cattr;
-    pthread_condattr_init(&cattr);
-    pthread_condattr_setpshared(&cattr, PTHREAD_PROCESS_SHARED);
-    pthread_cond_init(cond, &cattr);
-    pthread_condattr_destroy(&cattr);
-}
+// Socket pair for passing opened files from the service to Zygote, see readFile().
+// Zygote must close its end before forking, see closeFdChannel(). It isn't recreated afterwards,
+// as the running service couldn't get the new end, so file descriptors are only passed while
+// Zygote starts up (preloading and loading modules). Later reads use the shared memory.
+int clientSocket = -1;
+int serverSocket = -1;
+
+// Descriptors that have been received for other slots than the one of the receiving thread,
+// or FD_RECEIVE_FAILED. Only used by Zygote.
+static const int FD_NONE = -1;
+static const int FD_RECEIVE_FAILED = -2;
+pthread_mutex_t receiveMutex = PTHREAD_MUTEX_INITIALIZER;
+int receivedFds[kNumSlots];
+// Set by the first thread that fails to receive a descriptor, read by all of them.
+std::atomic<bool> fdPassingFailed(false);
 
 static bool init() {
     shared = (MemBasedState*) mmap(NULL, sizeof(MemBasedState), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
@@ -125,14 +307,44 @@ static bool init() {
     zygotePid = getpid();
     canAlwaysAccessService = true;
 
-    initSharedMutex(&shared->workerMutex);
-    initSharedCond(&shared->workerCond);
-    shared->state = STATE_NOT_RUNNING;
-    shared->action = OP_NONE;
-    shared->error = 0;
+    shared->init();
+
+    for (int i = 0; i < kNumSlots; i++) {
+        receivedFds[i] = FD_NONE;
+    }
+
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets) == 0) {
+        clientSocket = sockets[0];
+        serverSocket = sockets[1];
+    } else {
+        ALOGW("Could not create socket pair for Zygote service, reading files in chunks: %s", strerror(errno));
+    }
     return true;
 }
 
+static void closeServerSocket() {
+    if (serverSocket >= 0) {
+        close(serverSocket);
+        serverSocket = -1;
+    }
+}
+
+void closeFdChannel() {
+    pthread_mutex_lock(&receiveMutex);
+    if (clientSocket >= 0) {
+        close(clientSocket);
+        clientSocket = -1;
+    }
+    for (int i = 0; i < kNumSlots; i++) {
+        if (receivedFds[i] >= 0) {
+            close(receivedFds[i]);
+        }
+        receivedFds[i] = FD_NONE;
+    }
+    pthread_mutex_unlock(&receiveMutex);
+}
+
 void restrictMemoryInheritance() {
     madvise(shared, sizeof(MemBasedState), MADV_DONTFORK);
     canAlwaysAccessService = false;
@@ -148,122 +360,221 @@ static inline bool isServiceAccessible() {
     return true;
 }
 
-// Server implementation
-void* looper(void* unused __attribute__((unused))) {
-    pthread_mutex_lock(&shared->workerMutex);
-    shared->state = STATE_IDLE;
-    pthread_cond_broadcast(&shared->workerCond);
-    while (1) {
-        while (shared->state != STATE_SERVICE_ACTION) {
-            pthread_cond_wait(&shared->workerCond, &shared->workerMutex);
-        }
+// Sends a file descriptor with the index of the requesting slot as payload.
+static bool sendFd(int socket, int fd, int slotIndex) {
+    struct iovec iov = { &slotIndex, sizeof(slotIndex) };
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    return TEMP_FAILURE_RETRY(sendmsg(socket, &msg, MSG_NOSIGNAL)) == (ssize_t) sizeof(slotIndex);
+}
 
-        switch (shared->action) {
-            case OP_ACCESS_FILE: {
-                struct AccessFileData* data = &shared->data.accessFile;
-                data->result = TEMP_FAILURE_RETRY(access(data->path, data->mode));
-                if (data->result != 0) {
-                    shared->error = errno;
-                }
-            } break;
+// Receives a file descriptor sent with sendFd(). Returns false if there was no message,
+// otherwise *fd is -1 if the descriptor couldn't be received, which includes SELinux not
+// allowing this process to use it.
+static bool receiveFd(int socket, int* fd, int* slotIndex) {
+    struct iovec iov = { slotIndex, sizeof(*slotIndex) };
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    if (TEMP_FAILURE_RETRY(recvmsg(socket, &msg, 0)) != (ssize_t) sizeof(*slotIndex)
+            || *slotIndex < 0 || *slotIndex >= kNumSlots) {
+        return false;
+    }
 
-            case OP_STAT_FILE: {
-                struct StatFileData* data = &shared->data.statFile;
-                data->result = TEMP_FAILURE_RETRY(stat(data->path, &data->st));
-                if (data->result != 0) {
-                    shared->error = errno;
-                }
-            } break;
+    *fd = -1;
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS
+            && cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+        memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+    }
 
-            case OP_READ_FILE: {
-                struct ReadFileData* data = &shared->data.readFile;
-                struct stat st;
+    if (*fd >= 0 && (msg.msg_flags & MSG_CTRUNC)) {
+        close(*fd);
+        *fd = -1;
+    }
 
-                if (stat(data->path, &st) != 0) {
-                    shared->error = errno;
-                    break;
-                }
+    if (*fd >= 0) {
+        fcntl(*fd, F_SETFD, FD_CLOEXEC);
+    }
+    return true;
+}
+
+// Server implementation
+static void handleRequest(MemBasedRequest* request, int slotIndex) {
+    switch (request->action) {
+        case OP_ACCESS_FILE: {
+            struct AccessFileData* data = &request->data.accessFile;
+            data->result = TEMP_FAILURE_RETRY(access(data->path, data->mode));
+            if (data->result != 0) {
+                request->error = errno;
+            }
+        } break;
 
-                data->totalSize = st.st_size;
+        case OP_STAT_FILE: {
+            struct StatFileData* data = &request->data.statFile;
+            data->result = TEMP_FAILURE_RETRY(stat(data->path, &data->st));
+            if (data->result != 0) {
+                request->error = errno;
+            }
+        } break;
 
-                FILE *f = fopen(data->path, "r");
-                if (f == NULL) {
-                    shared->error = errno;
-                    break;
-                }
+        case OP_READ_FILE: {
+            struct ReadFileData* data = &request->data.readFile;
+            struct stat st;
+
+            if (stat(data->path, &st) != 0) {
+                request->error = errno;
+                cache::removeFile(data->path);
+                break;
+            }
 
-                if (data->offset > 0 && fseek(f, data->offset, SEEK_SET) != 0) {
-                    shared->error = ferror(f);
-                    fclose(f);
-                    break;
+            sp<cache::CachedFile> cached = cache::getFile(data->path, st);
+            if (cached != NULL) {
+                int size = cached->size;
+                data->totalSize = size;
+                data->bytesRead = 0;
+                if (data->offset < size) {
+                    data->bytesRead = size - data->offset;
+                    if (data->bytesRead > (int) sizeof(data->content))
+                        data->bytesRead = sizeof(data->content);
+                    memcpy(data->content, cached->content + data->offset, data->bytesRead);
                 }
+                data->eof = data->offset + data->bytesRead >= size;
+                break;
+            }
 
-                data->bytesRead = fread(data->content, 1, sizeof(data->content), f);
-                shared->error = ferror(f);
-                data->eof = feof(f);
+            data->totalSize = st.st_size;
 
-                fclose(f);
-            } break;
+            FILE *f = fopen(data->path, "r");
+            if (f == NULL) {
+                request->error = errno;
+                break;
+            }
 
-            case OP_NONE: {
-                ALOGE("No-op call to membased service");
+            if (data->offset > 0 && fseek(f, data->offset, SEEK_SET) != 0) {
+                request->error = ferror(f);
+                fclose(f);
                 break;
             }
 
-            default: {
-                ALOGE("Invalid action in call to membased service");
+            data->bytesRead = fread(data->content, 1, sizeof(data->content), f);
+            request->error = ferror(f);
+            data->eof = feof(f);
+
+            fclose(f);
+        } break;
+
+        case OP_OPEN_FILE: {
+            struct OpenFileData* data = &request->data.openFile;
+            data->sent = false;
+
+            int fd = TEMP_FAILURE_RETRY(open(data->path, O_RDONLY | O_CLOEXEC));
+            if (fd < 0) {
+                request->error = errno;
                 break;
             }
+
+            struct stat st;
+            if (fstat(fd, &st) != 0) {
+                request->error = errno;
+            } else if (S_ISDIR(st.st_mode)) {
+                request->error = EISDIR;
+            } else if (serverSocket >= 0 && sendFd(serverSocket, fd, slotIndex)) {
+                data->sent = true;
+            } else {
+                // Without an error, the client will fall back to OP_READ_FILE.
+                ALOGE("Could not pass file descriptor for %s: %s", data->path, strerror(errno));
+            }
+
+            close(fd);
+        } break;
+
+        case OP_NONE: {
+            ALOGE("No-op call to membased service");
+            break;
         }
 
-        shared->state = STATE_SERVER_RESPONSE;
-        pthread_cond_broadcast(&shared->workerCond);
+        default: {
+            ALOGE("Invalid action in call to membased service");
+            break;
+        }
     }
+}
 
-    pthread_mutex_unlock(&shared->workerMutex);
+static void* worker(void* unused __attribute__((unused))) {
+    while (1) {
+        Slot* slot = shared->waitForRequest();
+        handleRequest(&slot->request, shared->indexOf(slot));
+        shared->respond(slot);
+    }
     return NULL;
 }
 
+void* looper(void* unused __attribute__((unused))) {
+    for (int i = 1; i < kNumWorkers; i++) {
+        pthread_t thWorker;
+        if (pthread_create(&thWorker, NULL, &worker, NULL) != 0) {
+            ALOGE("Could not create worker thread for memory-based service: %s", strerror(errno));
+            break;
+        }
+    }
+
+    shared->setRunning();
+    return worker(NULL);
+}
+
 // Client implementation
 static inline bool waitForRunning(int timeout) {
     if (shared == NULL || timeout < 0)
         return false;
 
-    struct timespec ts;
-    clock_gettime(CLOCK_REALTIME, &ts);
-    ts.tv_sec += 5;
-    int rc = 0;
-    pthread_mutex_lock(&shared->workerMutex);
-    while (shared->state == STATE_NOT_RUNNING && rc == 0) {
-        rc = pthread_cond_timedwait(&shared->workerCond, &shared->workerMutex, &ts);
-    }
-    pthread_mutex_unlock(&shared->workerMutex);
-    return rc == 0;
+    return shared->waitForRunning(timeout);
 }
 
-static inline void waitForIdle() {
-    pthread_mutex_lock(&shared->workerMutex);
-    while (shared->state != STATE_IDLE) {
-        pthread_cond_wait(&shared->workerCond, &shared->workerMutex);
-    }
+static inline Slot* claimSlot(Action action) {
+    Slot* slot = shared->claimSlot();
+    slot->request.action = action;
+    return slot;
 }
 
-static inline void callService(Action action) {
-    shared->action = action;
-    shared->state = STATE_SERVICE_ACTION;
-    shared->error = 0;
-    pthread_cond_broadcast(&shared->workerCond);
-
-    while (shared->state != STATE_SERVER_RESPONSE) {
-        pthread_cond_wait(&shared->workerCond, &shared->workerMutex);
-    }
+static inline void callService(Slot* slot) {
+    slot->request.error = 0;
+    shared->call(slot);
 }
 
-static inline void makeIdle() {
-    shared->action = OP_NONE;
-    shared->state = STATE_IDLE;
-    pthread_cond_broadcast(&shared->workerCond);
-    pthread_mutex_unlock(&shared->workerMutex);
+// Releases the slot, sets errno to the error of the last call and returns it.
+static inline int releaseSlot(Slot* slot) {
+    int error = slot->request.error;
+    slot->request.action = OP_NONE;
+    shared->releaseSlot(slot);
+    errno = error;
+    return error;
 }
 
 int accessFile(const char* path, int mode) {
@@ -275,17 +586,16 @@ int accessFile(const char* path, int mode) {
         return -1;
     }
 
-    waitForIdle();
+    Slot* slot = claimSlot(OP_ACCESS_FILE);
 
-    struct AccessFileData* data = &shared->data.accessFile;
+    struct AccessFileData* data = &slot->request.data.accessFile;
     strcpy(data->path, path);
     data->mode = mode;
 
-    callService(OP_ACCESS_FILE);
+    callService(slot);
 
-    makeIdle();
-    errno = shared->error;
-    return shared->error ? -1 : data->result;
+    int result = data->result;
+    return releaseSlot(slot) ? -1 : result;
 }
 
 int statFile(const char* path, struct stat* st) {
@@ -297,43 +607,36 @@ int statFile(const char* path, struct stat* st) {
         return -1;
     }
 
-    waitForIdle();
+    Slot* slot = claimSlot(OP_STAT_FILE);
 
-    struct StatFileData* data = &shared->data.statFile;
+    struct StatFileData* data = &slot->request.data.statFile;
     strcpy(data->path, path);
 
-    callService(OP_STAT_FILE);
+    callService(slot);
 
     memcpy(st, &data->st, sizeof(struct stat));
 
-    makeIdle();
-    errno = shared->error;
-    return shared->error ? -1 : data->result;
+    int result = data->result;
+    return releaseSlot(slot) ? -1 : result;
 }
 
-char* readFile(const char* path, int* bytesRead) {
-    if (!isServiceAccessible())
-        return NULL;
-
+// Reads the file in chunks of ReadFileData::content through the shared memory.
+static char* readFileChunked(const char* path, int* bytesRead) {
     char* result = NULL;
     int offset = 0, totalSize = 0;
 
     if (bytesRead)
         *bytesRead = 0;
 
-    if (strlen(path) > sizeof(ReadFileData::path) - 1) {
-        errno = ENAMETOOLONG;
-        return NULL;
-    }
-
-    waitForIdle();
+    Slot* slot = claimSlot(OP_READ_FILE);
+    MemBasedRequest* request = &slot->request;
 
-    struct ReadFileData* data = &shared->data.readFile;
+    struct ReadFileData* data = &request->data.readFile;
     strcpy(data->path, path);
     data->offset = 0;
 
-    callService(OP_READ_FILE);
-    if (shared->error)
+    callService(slot);
+    if (request->error)
         goto bail;
 
     totalSize = data->totalSize;
@@ -345,12 +648,12 @@ char* readFile(const char* path, int* bytesRead) {
         offset += data->bytesRead;
         data->offset = offset;
 
-        callService(OP_READ_FILE);
-        if (shared->error)
+        callService(slot);
+        if (request->error)
             goto bail;
 
         if (offset + data->bytesRead > totalSize) {
-            shared->error = EBUSY;
+            request->error = EBUSY;
             goto bail;
         }
 
@@ -361,12 +664,116 @@ char* readFile(const char* path, int* bytesRead) {
         *bytesRead = offset + data->bytesRead;
 
     bail:
-    makeIdle();
-    if (shared->error && result) {
+    if (releaseSlot(slot) && result) {
         free(result);
         result = NULL;
     }
-    errno = shared->error;
+    return result;
+}
+
+// Reads a file which has been opened by the service. Returns NULL with errno set on failure.
+static char* readOpenedFile(int fd, int* bytesRead) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return NULL;
+    }
+
+    size_t totalSize = st.st_size;
+    char* result = (char*) malloc(totalSize + 1);
+    if (result == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    // The file might have been truncated in the meantime, so stop at EOF.
+    size_t offset = 0;
+    while (offset < totalSize) {
+        ssize_t rc = TEMP_FAILURE_RETRY(read(fd, result + offset, totalSize - offset));
+        if (rc < 0) {
+            free(result);
+            return NULL;
+        } else if (rc == 0) {
+            break;
+        }
+        offset += rc;
+    }
+
+    result[offset] = 0;
+    if (bytesRead)
+        *bytesRead = offset;
+    return result;
+}
+
+// Returns the descriptor that the service has sent for the slot. Messages for other slots
+// might arrive first, they are kept for the threads waiting for them.
+static int receiveFdForSlot(int slotIndex) {
+    pthread_mutex_lock(&receiveMutex);
+    while (receivedFds[slotIndex] == FD_NONE) {
+        int fd, index;
+        if (clientSocket < 0 || !receiveFd(clientSocket, &fd, &index)) {
+            receivedFds[slotIndex] = FD_RECEIVE_FAILED;
+            break;
+        }
+        receivedFds[index] = (fd >= 0) ? fd : FD_RECEIVE_FAILED;
+    }
+    int fd = receivedFds[slotIndex];
+    receivedFds[slotIndex] = FD_NONE;
+    pthread_mutex_unlock(&receiveMutex);
+    return fd;
+}
+
+// Let the service open the file and pass the descriptor to us, so we can read it without any
+// further round-trips. Returns -1 with errno set if the file can't be opened. Sets *fallback
+// if the descriptor couldn't be passed, then the file should be read in chunks instead.
+static int openFileViaService(const char* path, bool* fallback) {
+    *fallback = false;
+
+    Slot* slot = claimSlot(OP_OPEN_FILE);
+
+    struct OpenFileData* data = &slot->request.data.openFile;
+    strcpy(data->path, path);
+
+    callService(slot);
+
+    // The message was sent before the response, so this can't block for long.
+    int fd = data->sent ? receiveFdForSlot(shared->indexOf(slot)) : -1;
+    if (fd < 0 && (data->sent || slot->request.error == 0)) {
+        if (!fdPassingFailed.exchange(true)) {
+            ALOGW("Could not receive file descriptor from Zygote service, reading files in chunks");
+        }
+        *fallback = true;
+    }
+
+    releaseSlot(slot);
+    return fd;
+}
+
+char* readFile(const char* path, int* bytesRead) {
+    if (!isServiceAccessible())
+        return NULL;
+
+    if (bytesRead)
+        *bytesRead = 0;
+
+    if (strlen(path) > sizeof(ReadFileData::path) - 1) {
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+
+    if (clientSocket < 0 || fdPassingFailed.load()) {
+        return readFileChunked(path, bytesRead);
+    }
+
+    bool fallback;
+    int fd = openFileViaService(path, &fallback);
+    if (fd < 0) {
+        return fallback ? readFileChunked(path, bytesRead) : NULL;
+    }
+
+    char* result = readOpenedFile(fd, bytesRead);
+    int error = errno;
+    close(fd);
+    errno = error;
     return result;
 }
 
@@ -695,10 +1102,12 @@ status_t XposedService::readFile(const String16& filename16, int32_t offset, int
     *bytesRead = -1;
 
     // Get file metadata
-    const char* filename = String8(filename16).string();
+    String8 filename8(filename16);
+    const char* filename = filename8.string();
     struct stat st;
     if (stat(filename, &st) != 0) {
         status_t err = errno;
+        cache::removeFile(filename);
         if (errormsg) *errormsg = formatToString16("%s during stat() on %s", strerror(err), filename);
         return err;
     }
@@ -716,6 +1125,13 @@ status_t XposedService::readFile(const String16& filename16, int32_t offset, int
     *size = st.st_size;
     *mtime = st.st_mtime;
 
+    // Serve small files from memory if they haven't changed
+    sp<cache::CachedFile> cached = cache::getFile(filename, st);
+    if (cached != NULL) {
+        *size = cached->size;
+        *mtime = cached->st.st_mtime;
+    }
+
     // Check range
     if (offset > 0 && offset >= *size) {
         if (errormsg) *errormsg = formatToString16("offset %d >= size %" PRId64 " for %s", offset, *size, filename);
@@ -742,6 +1158,12 @@ status_t XposedService::readFile(const String16& filename16, int32_t offset, int
     }
     (*buffer)[length] = 0;
 
+    if (cached != NULL) {
+        memcpy(*buffer, cached->content + offset, length);
+        *bytesRead = length;
+        return 0;
+    }
+
     // Open file
     FILE *f = fopen(filename, "r");
     if (f == NULL) {
@@ -886,6 +1308,8 @@ bool startAll() {
         ALOGE("Fork for Xposed service in system context failed: %s", strerror(errno));
         return false;
     } else if (pid == 0) {
+        membased::closeFdChannel();
+        membased::closeServerSocket();
         systemService();
         // Should never reach this point
         exit(EXIT_FAILURE);
@@ -896,11 +1320,14 @@ bool startAll() {
         ALOGE("Fork for Xposed service in app context failed: %s", strerror(errno));
         return false;
     } else if (pid == 0) {
+        membased::closeFdChannel();
         appService();
         // Should never reach this point
         exit(EXIT_FAILURE);
     }
 
+    membased::closeServerSocket();
+
     if (xposed->isSELinuxEnabled && !checkMembasedRunning()) {
         return false;
     }
@@ -923,6 +1350,7 @@ bool startMembased() {
         ALOGE("Fork for Xposed Zygote service failed: %s", strerror(errno));
         return false;
     } else if (pid == 0) {
+        membased::closeFdChannel();
         xposed::setProcessName("xposed_zygote_service");
         if (!xposed::switchToXposedInstallerUidGid()) {
             exit(EXIT_FAILURE);
@@ -937,6 +1365,7 @@ bool startMembased() {
         exit(EXIT_FAILURE);
     }
 
+    membased::closeServerSocket();
     return checkMembasedRunning();
 }
 #endif  // XPOSED_WITH_SELINUX
@@ -16,6 +16,10 @@ namespace service {
         int statFile(const char* path, struct stat* stat);
         char* readFile(const char* path, int* bytesRead);
         void restrictMemoryInheritance();
+        // Must be called before Zygote forks. The channel is gone for good then, so passing file
+        // descriptors only speeds up reads during startup, later calls to readFile() use the
+        // shared memory.
+        void closeFdChannel();
     }  // namespace membased
 #endif  // XPOSED_WITH_SELINUX
 
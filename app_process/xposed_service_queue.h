@@ -0,0 +1,158 @@
+#ifndef XPOSED_SERVICE_QUEUE_H_
+#define XPOSED_SERVICE_QUEUE_H_
+
+#include <limits.h>
+#include <linux/futex.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace xposed {
+namespace service {
+
+/**
+ * A fixed number of request slots in memory that is shared between processes. A client claims
+ * a free slot, fills in the request and waits until one of the server's workers has responded.
+ * Every slot has its own state word, so requests in different slots don't wait for each other.
+ * Waiting is done with (non-private) futexes on these words, which works across processes.
+ *
+ * Must be placed in MAP_SHARED memory and initialized with init() before forking.
+ */
+template <typename Request, int kNumSlots>
+struct SharedRequestQueue {
+    enum SlotState {
+        SLOT_FREE,
+        SLOT_CLAIMED,     // The client is filling in the request.
+        SLOT_REQUEST,     // Waiting for a worker.
+        SLOT_PROCESSING,  // A worker is handling the request.
+        SLOT_RESPONSE,    // The client can read the response, then call again or release the slot.
+    };
+
+    struct Slot {
+        int32_t state;
+        Request request;
+    };
+
+    // Set to 1 once the server is running.
+    int32_t running;
+    // Incremented for every request, idle workers wait for it to change.
+    int32_t requestSeq;
+    // Incremented whenever a slot is released, clients wait for it to change if all slots are in use.
+    int32_t releaseSeq;
+    Slot slots[kNumSlots];
+
+    void init() {
+        running = 0;
+        requestSeq = 0;
+        releaseSeq = 0;
+        for (int i = 0; i < kNumSlots; i++) {
+            slots[i].state = SLOT_FREE;
+        }
+    }
+
+    int indexOf(const Slot* slot) const {
+        return slot - slots;
+    }
+
+    // Server implementation
+
+    void setRunning() {
+        __atomic_store_n(&running, 1, __ATOMIC_SEQ_CST);
+        futexWake(&running, INT_MAX);
+    }
+
+    // Blocks until a request is available and returns its slot, which is then owned by the worker.
+    Slot* waitForRequest() {
+        while (1) {
+            int32_t seq = __atomic_load_n(&requestSeq, __ATOMIC_SEQ_CST);
+            // Start at different slots, so that the later ones aren't starved under load.
+            for (int i = 0; i < kNumSlots; i++) {
+                Slot* slot = &slots[((uint32_t) seq + i) % kNumSlots];
+                if (compareAndSwap(&slot->state, SLOT_REQUEST, SLOT_PROCESSING)) {
+                    return slot;
+                }
+            }
+            // A request that is added after the scan changes the sequence, so it can't be missed.
+            futexWait(&requestSeq, seq, NULL);
+        }
+    }
+
+    void respond(Slot* slot) {
+        __atomic_store_n(&slot->state, SLOT_RESPONSE, __ATOMIC_SEQ_CST);
+        futexWake(&slot->state, INT_MAX);
+    }
+
+    // Client implementation
+
+    bool waitForRunning(int timeoutSeconds) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeoutSeconds;
+        while (__atomic_load_n(&running, __ATOMIC_SEQ_CST) == 0) {
+            struct timespec now, remaining;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            remaining.tv_sec = deadline.tv_sec - now.tv_sec;
+            remaining.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+            if (remaining.tv_nsec < 0) {
+                remaining.tv_sec--;
+                remaining.tv_nsec += 1000000000L;
+            }
+            if (remaining.tv_sec < 0) {
+                return false;
+            }
+            futexWait(&running, 0, &remaining);
+        }
+        return true;
+    }
+
+    // Blocks until a slot is free and returns it, it's then owned by the caller until releaseSlot().
+    Slot* claimSlot() {
+        while (1) {
+            int32_t seq = __atomic_load_n(&releaseSeq, __ATOMIC_SEQ_CST);
+            for (int i = 0; i < kNumSlots; i++) {
+                if (compareAndSwap(&slots[i].state, SLOT_FREE, SLOT_CLAIMED)) {
+                    return &slots[i];
+                }
+            }
+            futexWait(&releaseSeq, seq, NULL);
+        }
+    }
+
+    // Submits the request in a claimed slot and blocks until a worker has responded.
+    void call(Slot* slot) {
+        __atomic_store_n(&slot->state, SLOT_REQUEST, __ATOMIC_SEQ_CST);
+        __atomic_fetch_add(&requestSeq, 1, __ATOMIC_SEQ_CST);
+        futexWake(&requestSeq, 1);
+
+        int32_t state;
+        while ((state = __atomic_load_n(&slot->state, __ATOMIC_SEQ_CST)) != SLOT_RESPONSE) {
+            futexWait(&slot->state, state, NULL);
+        }
+    }
+
+    void releaseSlot(Slot* slot) {
+        __atomic_store_n(&slot->state, SLOT_FREE, __ATOMIC_SEQ_CST);
+        __atomic_fetch_add(&releaseSeq, 1, __ATOMIC_SEQ_CST);
+        futexWake(&releaseSeq, 1);
+    }
+
+    private:
+    static bool compareAndSwap(int32_t* addr, int32_t expected, int32_t desired) {
+        return __atomic_compare_exchange_n(addr, &expected, desired, false,
+                                           __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    }
+
+    static void futexWait(int32_t* addr, int32_t expected, const struct timespec* timeout) {
+        syscall(__NR_futex, addr, FUTEX_WAIT, expected, timeout, NULL, 0);
+    }
+
+    static void futexWake(int32_t* addr, int count) {
+        syscall(__NR_futex, addr, FUTEX_WAKE, count, NULL, NULL, 0);
+    }
+};
+
+}  // namespace service
+}  // namespace xposed
+
+#endif  // XPOSED_SERVICE_QUEUE_H_
@@ -0,0 +1,282 @@
+/**
+ * Host-side stress test for the request queue of the memory-based Zygote service.
+ */
+
+#include "xposed_service_queue.h"
+
+#include <algorithm>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace xposed {
+namespace service {
+
+enum TestAction {
+    TEST_ECHO,   // Responds immediately.
+    TEST_SLOW,   // Sleeps for value microseconds, like reading a large file in chunks.
+    TEST_BLOCK,  // Blocks until the gate is opened.
+};
+
+struct TestRequest {
+    TestAction action;
+    int value;
+    int result;
+};
+
+static const int kTestSlots = 8;
+static const int kTestWorkers = 4;
+
+typedef SharedRequestQueue<TestRequest, kTestSlots> TestQueue;
+
+struct TestShared {
+    TestQueue queue;
+    int32_t gate;
+};
+
+static uint64_t nanoTime() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + now.tv_nsec;
+}
+
+static int call(TestQueue* queue, TestAction action, int value) {
+    TestQueue::Slot* slot = queue->claimSlot();
+    slot->request.action = action;
+    slot->request.value = value;
+    queue->call(slot);
+    int result = slot->request.result;
+    queue->releaseSlot(slot);
+    return result;
+}
+
+static void* testWorker(void* arg) {
+    TestShared* shared = static_cast<TestShared*>(arg);
+    while (1) {
+        TestQueue::Slot* slot = shared->queue.waitForRequest();
+        TestRequest* request = &slot->request;
+        switch (request->action) {
+            case TEST_ECHO:
+                break;
+            case TEST_SLOW:
+                usleep(request->value);
+                break;
+            case TEST_BLOCK:
+                while (__atomic_load_n(&shared->gate, __ATOMIC_SEQ_CST) == 0) {
+                    usleep(100);
+                }
+                break;
+        }
+        request->result = request->value * 2;
+        shared->queue.respond(slot);
+    }
+    return NULL;
+}
+
+class SharedRequestQueueTest : public testing::Test {
+  protected:
+    void SetUpShared() {
+        void* memory = mmap(NULL, sizeof(TestShared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        ASSERT_NE(MAP_FAILED, memory);
+        shared_ = static_cast<TestShared*>(memory);
+        shared_->queue.init();
+        shared_->gate = 0;
+
+        server_ = fork();
+        ASSERT_GE(server_, 0);
+        if (server_ == 0) {
+            for (int i = 1; i < kTestWorkers; i++) {
+                pthread_t thread;
+                pthread_create(&thread, NULL, &testWorker, shared_);
+            }
+            shared_->queue.setRunning();
+            testWorker(shared_);
+            _exit(1);
+        }
+        ASSERT_TRUE(shared_->queue.waitForRunning(5));
+    }
+
+    virtual void TearDown() {
+        if (server_ > 0) {
+            kill(server_, SIGKILL);
+            waitpid(server_, NULL, 0);
+        }
+        if (shared_ != NULL) {
+            munmap(shared_, sizeof(TestShared));
+        }
+    }
+
+    TestShared* shared_ = NULL;
+    pid_t server_ = -1;
+};
+
+TEST_F(SharedRequestQueueTest, Echo) {
+    SetUpShared();
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_EQ(i * 2, call(&shared_->queue, TEST_ECHO, i));
+    }
+}
+
+static void* callBlocking(void* arg) {
+    call(static_cast<TestQueue*>(arg), TEST_BLOCK, 1);
+    return NULL;
+}
+
+TEST_F(SharedRequestQueueTest, SmallRequestsDontWaitBehindSlowOnes) {
+    SetUpShared();
+
+    // Keep all workers but one busy.
+    std::vector<pthread_t> threads(kTestWorkers - 1);
+    for (size_t i = 0; i < threads.size(); i++) {
+        ASSERT_EQ(0, pthread_create(&threads[i], NULL, &callBlocking, &shared_->queue));
+    }
+    int processing;
+    do {
+        usleep(100);
+        processing = 0;
+        for (int i = 0; i < kTestSlots; i++) {
+            if (__atomic_load_n(&shared_->queue.slots[i].state, __ATOMIC_SEQ_CST) == TestQueue::SLOT_PROCESSING) {
+                processing++;
+            }
+        }
+    } while (processing < kTestWorkers - 1);
+
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(i * 2, call(&shared_->queue, TEST_ECHO, i));
+    }
+    EXPECT_EQ(0, __atomic_load_n(&shared_->gate, __ATOMIC_SEQ_CST));
+
+    __atomic_store_n(&shared_->gate, 1, __ATOMIC_SEQ_CST);
+    for (size_t i = 0; i < threads.size(); i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+static const int kClients = 16;
+static const int kThreadsPerClient = 4;
+static const int kRequestsPerThread = 2000;
+static const int kSlowEvery = 20;
+static const int kSlowMicros = 500;
+static const int kNumRequests = kClients * kThreadsPerClient * kRequestsPerThread;
+// Generous limit, a working queue stays far below it even on a loaded machine.
+static const int kStressTimeoutSeconds = 60;
+
+// Latency of a request that hasn't completed.
+static const int64_t LATENCY_NONE = -2;
+
+struct ClientThread {
+    TestShared* shared;
+    // Latencies of TEST_ECHO requests in nanoseconds, -1 for TEST_SLOW ones.
+    int64_t* latencies;
+    int firstRequest;
+    int errors;
+};
+
+static void* runClientThread(void* arg) {
+    ClientThread* thread = static_cast<ClientThread*>(arg);
+    TestShared* shared = thread->shared;
+    for (int i = 0; i < kRequestsPerThread; i++) {
+        bool slow = (i % kSlowEvery) == kSlowEvery - 1;
+        int value = slow ? kSlowMicros : i;
+        uint64_t begin = nanoTime();
+        int result = call(&shared->queue, slow ? TEST_SLOW : TEST_ECHO, value);
+        thread->latencies[thread->firstRequest + i] = slow ? -1 : static_cast<int64_t>(nanoTime() - begin);
+        if (result != value * 2) {
+            thread->errors++;
+        }
+    }
+    return NULL;
+}
+
+// Many processes with several threads each, like apps starting during boot. Every 20th request
+// is slow. All requests must complete in time with the right responses. Throughput and latencies
+// of the fast requests depend on the machine, so they are only reported.
+TEST_F(SharedRequestQueueTest, Stress) {
+    SetUpShared();
+    size_t latenciesSize = kNumRequests * sizeof(int64_t);
+    void* memory = mmap(NULL, latenciesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    ASSERT_NE(MAP_FAILED, memory);
+    int64_t* latencies = static_cast<int64_t*>(memory);
+    std::fill(latencies, latencies + kNumRequests, LATENCY_NONE);
+
+    uint64_t start = nanoTime();
+    std::vector<pid_t> clients;
+    for (int c = 0; c < kClients; c++) {
+        pid_t pid = fork();
+        ASSERT_GE(pid, 0);
+        if (pid == 0) {
+            std::vector<pthread_t> threads(kThreadsPerClient);
+            std::vector<ClientThread> args(kThreadsPerClient);
+            for (int t = 0; t < kThreadsPerClient; t++) {
+                args[t].shared = shared_;
+                args[t].latencies = latencies;
+                args[t].firstRequest = (c * kThreadsPerClient + t) * kRequestsPerThread;
+                args[t].errors = 0;
+                pthread_create(&threads[t], NULL, &runClientThread, &args[t]);
+            }
+            int errors = 0;
+            for (int t = 0; t < kThreadsPerClient; t++) {
+                pthread_join(threads[t], NULL);
+                errors += args[t].errors;
+            }
+            _exit(std::min(errors, 255));
+        }
+        clients.push_back(pid);
+    }
+
+    // Wait for all clients, but kill them if the queue got stuck.
+    uint64_t deadline = start + kStressTimeoutSeconds * 1000000000ULL;
+    bool timedOut = false;
+    for (size_t c = 0; c < clients.size(); c++) {
+        int status;
+        pid_t result;
+        while ((result = waitpid(clients[c], &status, WNOHANG)) == 0 && !timedOut) {
+            if (nanoTime() > deadline) {
+                timedOut = true;
+                for (size_t k = c; k < clients.size(); k++) {
+                    kill(clients[k], SIGKILL);
+                }
+            } else {
+                usleep(1000);
+            }
+        }
+        if (result == 0) {
+            result = waitpid(clients[c], &status, 0);
+        }
+        ASSERT_EQ(clients[c], result);
+        if (timedOut) {
+            continue;
+        }
+        ASSERT_TRUE(WIFEXITED(status));
+        EXPECT_EQ(0, WEXITSTATUS(status)) << "wrong responses in client " << c;
+    }
+    ASSERT_FALSE(timedOut) << "requests didn't complete within " << kStressTimeoutSeconds << " s";
+    uint64_t elapsed = nanoTime() - start;
+
+    std::vector<int64_t> fast;
+    int incomplete = 0;
+    for (int i = 0; i < kNumRequests; i++) {
+        if (latencies[i] >= 0) {
+            fast.push_back(latencies[i]);
+        } else if (latencies[i] == LATENCY_NONE) {
+            incomplete++;
+        }
+    }
+    munmap(latencies, latenciesSize);
+    ASSERT_EQ(0, incomplete);
+    ASSERT_FALSE(fast.empty());
+    std::sort(fast.begin(), fast.end());
+    int64_t p50 = fast[fast.size() / 2];
+    int64_t p99 = fast[fast.size() * 99 / 100];
+    printf("%d requests in %.1f ms (%.0f requests/s), fast requests: p50 %.1f us, p99 %.1f us, max %.1f us\n",
+           kNumRequests, elapsed / 1e6, kNumRequests / (elapsed / 1e9),
+           p50 / 1e3, p99 / 1e3, fast.back() / 1e3);
+}
+
+}  // namespace service
+}  // namespace xposed
@@ -46,6 +46,7 @@ struct XposedShared {
     int (*zygoteservice_accessFile)(const char* path, int mode);
     int (*zygoteservice_statFile)(const char* path, struct stat* st);
     char* (*zygoteservice_readFile)(const char* path, int* bytesRead);
+    void (*zygoteservice_closeFdChannel)();
 #endif
 };
 
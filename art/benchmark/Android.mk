@@ -21,7 +21,11 @@ include art/build/Android.common_build.mk
 LIBARTBENCHMARK_COMMON_SRC_FILES := \
   jobject-benchmark/jobject_benchmark.cc \
   jni-perf/perf_jni.cc \
-  scoped-primitive-array/scoped_primitive_array.cc
+  scoped-primitive-array/scoped_primitive_array.cc \
+  xposed-common/xposed_benchmark_hooks.cc \
+  xposed-dispatch/xposed_dispatch.cc \
+  xposed-hook-install/xposed_hook_install.cc \
+  xposed-hooks/xposed_hooks.cc
 
 # $(1): target or host
 define build-libartbenchmark
@@ -41,7 +45,7 @@ define build-libartbenchmark
   endif
   LOCAL_SRC_FILES := $(LIBARTBENCHMARK_COMMON_SRC_FILES)
   LOCAL_SHARED_LIBRARIES += libart libbacktrace libnativehelper
-  LOCAL_C_INCLUDES += $(ART_C_INCLUDES) art/runtime
+  LOCAL_C_INCLUDES += $(ART_C_INCLUDES) art/runtime $(LOCAL_PATH)
   LOCAL_ADDITIONAL_DEPENDENCIES := art/build/Android.common_build.mk
   LOCAL_ADDITIONAL_DEPENDENCIES += $(LOCAL_PATH)/Android.mk
   ifeq ($$(art_target_or_host),target)
@@ -0,0 +1,26 @@
+#include "xposed_benchmark_hooks.h"
+
+#include "art_method-inl.h"
+#include "scoped_thread_state_change.h"
+
+namespace art {
+
+void HookMethodForBenchmark(JNIEnv* env, jclass klass, jobject reflected_method) {
+  if (ArtMethod::xposed_callback_class == nullptr ||
+      !env->IsSameObject(ArtMethod::xposed_callback_class, klass)) {
+    if (ArtMethod::xposed_callback_class != nullptr) {
+      env->DeleteGlobalRef(ArtMethod::xposed_callback_class);
+    }
+    ArtMethod::xposed_callback_class = reinterpret_cast<jclass>(env->NewGlobalRef(klass));
+    ArtMethod::xposed_callback_method = env->GetStaticMethodID(
+        klass,
+        "handleHookedMethod",
+        "(Ljava/lang/reflect/Member;ILjava/lang/Object;Ljava/lang/Object;[Ljava/lang/Object;)"
+        "Ljava/lang/Object;");
+  }
+
+  ScopedObjectAccess soa(env);
+  ArtMethod::FromReflectedMethod(soa, reflected_method)->EnableXposedHook(soa, nullptr);
+}
+
+}  // namespace art
@@ -0,0 +1,15 @@
+#ifndef ART_BENCHMARK_XPOSED_COMMON_XPOSED_BENCHMARK_HOOKS_H_
+#define ART_BENCHMARK_XPOSED_COMMON_XPOSED_BENCHMARK_HOOKS_H_
+
+#include "jni.h"
+
+namespace art {
+
+// Hooks the method and routes its calls to klass.handleHookedMethod(), which must have the
+// signature of XposedBridge.handleHookedMethod(). The callback is global, so it's set again for
+// every hook, in case another benchmark was run in this process before.
+void HookMethodForBenchmark(JNIEnv* env, jclass klass, jobject reflected_method);
+
+}  // namespace art
+
+#endif  // ART_BENCHMARK_XPOSED_COMMON_XPOSED_BENCHMARK_HOOKS_H_
@@ -0,0 +1,108 @@
+import com.google.caliper.SimpleBenchmark;
+
+import java.lang.reflect.Member;
+
+public class XposedDispatchBenchmark extends SimpleBenchmark {
+  private static final Object OBJECT = new Object();
+
+  static native void hookMethod(Member method);
+
+  // Replacement for XposedBridge.handleHookedMethod(). Returns the first argument, which has the
+  // correct (boxed) type for all hooked methods below.
+  static Object handleHookedMethod(Member method, int originalMethodId, Object additionalInfo,
+      Object thisObject, Object[] args) {
+    return (args != null && args.length > 0) ? args[0] : null;
+  }
+
+  static void noArgs() {}
+  static int intArgs(int a, int b) { return a + b; }
+  static long longDoubleArgs(long a, double b) { return a; }
+  static boolean booleanArg(boolean a) { return a; }
+  static Object objectArg(Object a) { return a; }
+
+  static void hookedNoArgs() {}
+  static int hookedIntArgs(int a, int b) { return a + b; }
+  static long hookedLongDoubleArgs(long a, double b) { return a; }
+  static boolean hookedBooleanArg(boolean a) { return a; }
+  static Object hookedObjectArg(Object a) { return a; }
+
+  public void timeNoArgs(int N) {
+    for (int i = 0; i < N; i++) {
+      noArgs();
+    }
+  }
+
+  public void timeHookedNoArgs(int N) {
+    for (int i = 0; i < N; i++) {
+      hookedNoArgs();
+    }
+  }
+
+  public void timeIntArgs(int N) {
+    for (int i = 0; i < N; i++) {
+      intArgs(i, 1);
+    }
+  }
+
+  public void timeHookedIntArgs(int N) {
+    for (int i = 0; i < N; i++) {
+      hookedIntArgs(i, 1);
+    }
+  }
+
+  public void timeHookedSmallIntArgs(int N) {
+    for (int i = 0; i < N; i++) {
+      hookedIntArgs(i & 0x3f, 1);
+    }
+  }
+
+  public void timeLongDoubleArgs(int N) {
+    for (int i = 0; i < N; i++) {
+      longDoubleArgs(i, 1.0);
+    }
+  }
+
+  public void timeHookedLongDoubleArgs(int N) {
+    for (int i = 0; i < N; i++) {
+      hookedLongDoubleArgs(i, 1.0);
+    }
+  }
+
+  public void timeBooleanArg(int N) {
+    for (int i = 0; i < N; i++) {
+      booleanArg((i & 1) == 0);
+    }
+  }
+
+  public void timeHookedBooleanArg(int N) {
+    for (int i = 0; i < N; i++) {
+      hookedBooleanArg((i & 1) == 0);
+    }
+  }
+
+  public void timeObjectArg(int N) {
+    for (int i = 0; i < N; i++) {
+      objectArg(OBJECT);
+    }
+  }
+
+  public void timeHookedObjectArg(int N) {
+    for (int i = 0; i < N; i++) {
+      hookedObjectArg(OBJECT);
+    }
+  }
+
+  static {
+    System.loadLibrary("artbenchmark");
+    try {
+      hookMethod(XposedDispatchBenchmark.class.getDeclaredMethod("hookedNoArgs"));
+      hookMethod(XposedDispatchBenchmark.class.getDeclaredMethod("hookedIntArgs", int.class, int.class));
+      hookMethod(XposedDispatchBenchmark.class.getDeclaredMethod("hookedLongDoubleArgs",
+          long.class, double.class));
+      hookMethod(XposedDispatchBenchmark.class.getDeclaredMethod("hookedBooleanArg", boolean.class));
+      hookMethod(XposedDispatchBenchmark.class.getDeclaredMethod("hookedObjectArg", Object.class));
+    } catch (NoSuchMethodException e) {
+      throw new RuntimeException(e);
+    }
+  }
+}
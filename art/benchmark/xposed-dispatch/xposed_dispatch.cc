@@ -0,0 +1,17 @@
+#include "jni.h"
+#include "xposed-common/xposed_benchmark_hooks.h"
+
+namespace art {
+
+namespace {
+
+extern "C" JNIEXPORT void JNICALL Java_XposedDispatchBenchmark_hookMethod(JNIEnv* env,
+                                                                          jclass klass,
+                                                                          jobject reflected_method) {
+  // Route hooked calls to XposedDispatchBenchmark.handleHookedMethod().
+  HookMethodForBenchmark(env, klass, reflected_method);
+}
+
+}  // namespace
+
+}  // namespace art
@@ -0,0 +1,108 @@
+import com.google.caliper.Param;
+import com.google.caliper.SimpleBenchmark;
+
+import java.lang.reflect.Member;
+
+/**
+ * Compares the cost of ordinary calls, returns, exceptions and stack walks with and without a
+ * hook installed while the benchmark's own frames are on the stack. None of the timed code calls
+ * the hooked method, so both variants should perform the same.
+ */
+public class XposedHookInstallBenchmark extends SimpleBenchmark {
+  private static final int DEPTH = 16;
+  private static final int TARGETS = 8;
+
+  // Number of targets hooked so far. Hooks can't be removed, so every run hooks a new target.
+  private static int hookedTargets;
+
+  @Param({"false", "true"}) boolean hooked;
+
+  static native void hookMethod(Member method);
+
+  // Replacement for XposedBridge.handleHookedMethod().
+  static Object handleHookedMethod(Member method, int originalMethodId, Object additionalInfo,
+      Object thisObject, Object[] args) {
+    return null;
+  }
+
+  static void hookedTarget0() {}
+  static void hookedTarget1() {}
+  static void hookedTarget2() {}
+  static void hookedTarget3() {}
+  static void hookedTarget4() {}
+  static void hookedTarget5() {}
+  static void hookedTarget6() {}
+  static void hookedTarget7() {}
+
+  // Installs the hook from a deep stack, so that all of these frames are live during the
+  // installation.
+  static void installHookAtDepth(int depth, String target) throws Exception {
+    if (depth > 0) {
+      installHookAtDepth(depth - 1, target);
+    } else {
+      hookMethod(XposedHookInstallBenchmark.class.getDeclaredMethod(target));
+    }
+  }
+
+  @Override
+  protected void setUp() throws Exception {
+    if (!hooked) {
+      if (hookedTargets != 0) {
+        throw new IllegalStateException("Hooks of a previous run are still installed");
+      }
+      return;
+    }
+    if (hookedTargets == TARGETS) {
+      throw new IllegalStateException("No more targets to hook");
+    }
+    installHookAtDepth(DEPTH, "hookedTarget" + hookedTargets++);
+  }
+
+  static int recurse(int depth) {
+    return (depth > 0) ? recurse(depth - 1) + 1 : 0;
+  }
+
+  static void throwAtDepth(int depth) {
+    if (depth > 0) {
+      throwAtDepth(depth - 1);
+    } else {
+      throw new IllegalStateException();
+    }
+  }
+
+  static Throwable captureAtDepth(int depth) {
+    return (depth > 0) ? captureAtDepth(depth - 1) : new Throwable();
+  }
+
+  public int timeCallReturn(int N) {
+    int result = 0;
+    for (int i = 0; i < N; i++) {
+      result += recurse(DEPTH);
+    }
+    return result;
+  }
+
+  public int timeThrowCatch(int N) {
+    int caught = 0;
+    for (int i = 0; i < N; i++) {
+      try {
+        throwAtDepth(DEPTH);
+      } catch (IllegalStateException e) {
+        caught++;
+      }
+    }
+    return caught;
+  }
+
+  public int timeStackWalk(int N) {
+    int frames = 0;
+    for (int i = 0; i < N; i++) {
+      frames += captureAtDepth(DEPTH).getStackTrace().length;
+    }
+    return frames;
+  }
+
+  static {
+    System.loadLibrary("artbenchmark");
+  }
+}
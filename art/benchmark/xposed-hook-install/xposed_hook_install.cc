@@ -0,0 +1,18 @@
+#include "jni.h"
+#include "xposed-common/xposed_benchmark_hooks.h"
+
+namespace art {
+
+namespace {
+
+extern "C" JNIEXPORT void JNICALL Java_XposedHookInstallBenchmark_hookMethod(
+    JNIEnv* env,
+    jclass klass,
+    jobject reflected_method) {
+  // Route hooked calls to XposedHookInstallBenchmark.handleHookedMethod().
+  HookMethodForBenchmark(env, klass, reflected_method);
+}
+
+}  // namespace
+
+}  // namespace art
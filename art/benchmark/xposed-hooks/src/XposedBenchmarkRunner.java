@@ -0,0 +1,134 @@
+import com.google.caliper.Param;
+import com.google.caliper.SimpleBenchmark;
+
+import java.lang.reflect.Field;
+import java.lang.reflect.Method;
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.Comparator;
+import java.util.List;
+
+/**
+ * Runs all scenarios of a caliper SimpleBenchmark in the current VM and prints one JSON object
+ * per scenario and time method, for tracking regressions.
+ *
+ * Usage: XposedBenchmarkRunner <benchmark class> [<minimum time per scenario in ms>]
+ */
+public class XposedBenchmarkRunner {
+  private static final long DEFAULT_MIN_TIME_MS = 500;
+
+  public static void main(String[] args) throws Exception {
+    if (args.length < 1 || args.length > 2) {
+      System.err.println("Usage: XposedBenchmarkRunner <benchmark class> [<min time in ms>]");
+      System.exit(1);
+    }
+    Class<?> benchmarkClass = Class.forName(args[0]);
+    long minTimeNs = (args.length > 1 ? Long.parseLong(args[1]) : DEFAULT_MIN_TIME_MS) * 1000000L;
+
+    List<Field> paramFields = new ArrayList<Field>();
+    for (Field field : benchmarkClass.getDeclaredFields()) {
+      if (field.isAnnotationPresent(Param.class)) {
+        field.setAccessible(true);
+        paramFields.add(field);
+      }
+    }
+    Collections.sort(paramFields, new Comparator<Field>() {
+      @Override
+      public int compare(Field lhs, Field rhs) {
+        return lhs.getName().compareTo(rhs.getName());
+      }
+    });
+
+    List<Method> timeMethods = new ArrayList<Method>();
+    for (Method method : benchmarkClass.getDeclaredMethods()) {
+      Class<?>[] parameterTypes = method.getParameterTypes();
+      if (method.getName().startsWith("time") && parameterTypes.length == 1
+          && parameterTypes[0] == int.class) {
+        method.setAccessible(true);
+        timeMethods.add(method);
+      }
+    }
+    Collections.sort(timeMethods, new Comparator<Method>() {
+      @Override
+      public int compare(Method lhs, Method rhs) {
+        return lhs.getName().compareTo(rhs.getName());
+      }
+    });
+
+    // setUp() and tearDown() are protected in another package.
+    Method setUp = SimpleBenchmark.class.getDeclaredMethod("setUp");
+    Method tearDown = SimpleBenchmark.class.getDeclaredMethod("tearDown");
+    setUp.setAccessible(true);
+    tearDown.setAccessible(true);
+
+    // Iterate over all combinations of parameter values.
+    int[] indexes = new int[paramFields.size()];
+    while (true) {
+      Object benchmark = benchmarkClass.newInstance();
+      StringBuilder params = new StringBuilder();
+      for (int i = 0; i < paramFields.size(); i++) {
+        Field field = paramFields.get(i);
+        String value = field.getAnnotation(Param.class).value()[indexes[i]];
+        field.set(benchmark, parseValue(field.getType(), value));
+        if (i > 0) {
+          params.append(',');
+        }
+        params.append(quote(field.getName())).append(':').append(quote(value));
+      }
+
+      setUp.invoke(benchmark);
+      try {
+        for (Method timeMethod : timeMethods) {
+          // Double the repetitions until a run takes long enough, the first ones are warm-up.
+          int reps = 1;
+          long elapsed;
+          while (true) {
+            long start = System.nanoTime();
+            timeMethod.invoke(benchmark, reps);
+            elapsed = System.nanoTime() - start;
+            if (elapsed >= minTimeNs || reps > Integer.MAX_VALUE / 2) {
+              break;
+            }
+            reps *= 2;
+          }
+          System.out.println("{\"benchmark\":" + quote(benchmarkClass.getName())
+              + ",\"method\":" + quote(timeMethod.getName().substring("time".length()))
+              + ",\"params\":{" + params + "}"
+              + ",\"reps\":" + reps
+              + ",\"nsPerRep\":" + ((double) elapsed / reps) + "}");
+        }
+      } finally {
+        tearDown.invoke(benchmark);
+      }
+
+      // Advance to the next combination.
+      int i = 0;
+      for (; i < indexes.length; i++) {
+        if (++indexes[i] < paramFields.get(i).getAnnotation(Param.class).value().length) {
+          break;
+        }
+        indexes[i] = 0;
+      }
+      if (i == indexes.length) {
+        break;
+      }
+    }
+  }
+
+  private static Object parseValue(Class<?> type, String value) {
+    if (type == String.class) {
+      return value;
+    } else if (type == int.class) {
+      return Integer.parseInt(value);
+    } else if (type == long.class) {
+      return Long.parseLong(value);
+    } else if (type == boolean.class) {
+      return Boolean.parseBoolean(value);
+    }
+    throw new IllegalArgumentException("Unsupported parameter type " + type);
+  }
+
+  private static String quote(String value) {
+    return "\"" + value.replace("\\", "\\\\").replace("\"", "\\\"") + "\"";
+  }
+}
@@ -0,0 +1,98 @@
+import com.google.caliper.Param;
+import com.google.caliper.SimpleBenchmark;
+
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.CountDownLatch;
+
+/**
+ * Measures the latency of installing a hook, which stops all threads and walks their stacks,
+ * depending on the size of the heap and the number of threads. The hook cost is the difference
+ * between timeLoadClassAndHook() and timeLoadClass().
+ */
+public class XposedEnableHookBenchmark extends SimpleBenchmark {
+  private static final int STACK_DEPTH = 32;
+
+  @Param({"0", "64", "256"}) int heapMegabytes;
+  @Param({"0", "16", "64"}) int idleThreads;
+
+  private List<Object[]> retained;
+  private List<Thread> threads;
+  private CountDownLatch release;
+
+  public static class Target {
+    public static int target(int a) {
+      return a + 1;
+    }
+  }
+
+  @Override
+  protected void setUp() throws Exception {
+    // Many small objects, so that the collector has something to trace.
+    retained = new ArrayList<Object[]>();
+    for (int i = 0; i < heapMegabytes * 16; i++) {
+      Object[] chunk = new Object[64];
+      for (int j = 0; j < chunk.length; j++) {
+        chunk[j] = new byte[1000];
+      }
+      retained.add(chunk);
+    }
+
+    // Threads which are blocked with some frames on their stack, like the binder threads of an
+    // app.
+    final CountDownLatch started = new CountDownLatch(idleThreads);
+    release = new CountDownLatch(1);
+    threads = new ArrayList<Thread>();
+    for (int i = 0; i < idleThreads; i++) {
+      Thread thread = new Thread() {
+        @Override
+        public void run() {
+          waitAtDepth(STACK_DEPTH, started);
+        }
+      };
+      thread.setDaemon(true);
+      thread.start();
+      threads.add(thread);
+    }
+    started.await();
+  }
+
+  @Override
+  protected void tearDown() throws Exception {
+    release.countDown();
+    for (Thread thread : threads) {
+      thread.join();
+    }
+    threads = null;
+    retained = null;
+  }
+
+  private void waitAtDepth(int depth, CountDownLatch started) {
+    if (depth > 0) {
+      waitAtDepth(depth - 1, started);
+      return;
+    }
+    started.countDown();
+    while (true) {
+      try {
+        release.await();
+        return;
+      } catch (InterruptedException e) {
+        // Keep waiting.
+      }
+    }
+  }
+
+  public void timeLoadClass(int reps) throws Exception {
+    for (int i = 0; i < reps; i++) {
+      XposedHooks.loadFreshCopy(Target.class).getDeclaredMethod("target", int.class);
+    }
+  }
+
+  public void timeLoadClassAndHook(int reps) throws Exception {
+    for (int i = 0; i < reps; i++) {
+      XposedHooks.hookMethod(
+          XposedHooks.loadFreshCopy(Target.class).getDeclaredMethod("target", int.class));
+    }
+  }
+}
@@ -0,0 +1,36 @@
+import dalvik.system.PathClassLoader;
+
+import java.lang.reflect.Member;
+
+/** Native helpers shared by the Xposed benchmarks in this directory. */
+public class XposedHooks {
+  static native void hookMethod(Member method);
+
+  // Calls the original method of a hooked method like XposedBridge.invokeOriginalMethodNative(),
+  // and like it did before it skipped reflection.
+  static native Object invokeOriginalMethod(Member method, Object receiver, Object[] args);
+  static native Object invokeOriginalMethodViaReflection(Member method, Object receiver,
+      Object[] args);
+
+  // Invalidates the compiled callers of the method, as done when hooking it.
+  static native void invalidateCallers(Member method);
+
+  // Replacement for XposedBridge.handleHookedMethod(). Returns the first argument, so hooked
+  // methods must return the type of their first parameter, or void.
+  static Object handleHookedMethod(Member method, int originalMethodId, Object additionalInfo,
+      Object thisObject, Object[] args) {
+    return (args != null && args.length > 0) ? args[0] : null;
+  }
+
+  // Loads the class again in a new class loader, which also registers another copy of the dex
+  // file. None of the methods of the new class are hooked yet.
+  static Class<?> loadFreshCopy(Class<?> klass) throws ClassNotFoundException {
+    ClassLoader loader = new PathClassLoader(System.getProperty("java.class.path"),
+        XposedHooks.class.getClassLoader().getParent());
+    return Class.forName(klass.getName(), true, loader);
+  }
+
+  static {
+    System.loadLibrary("artbenchmark");
+  }
+}
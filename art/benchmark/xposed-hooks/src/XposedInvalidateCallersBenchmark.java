@@ -0,0 +1,54 @@
+import com.google.caliper.Param;
+import com.google.caliper.SimpleBenchmark;
+
+import java.lang.reflect.Member;
+import java.util.ArrayList;
+import java.util.List;
+
+/**
+ * Measures looking up and invalidating the compiled callers of a method, as done for each hook,
+ * depending on the number of loaded oat dex files. The "local" callee has a single caller in
+ * this dex file, the "boot" callee has many callers in the boot image.
+ */
+public class XposedInvalidateCallersBenchmark extends SimpleBenchmark {
+  @Param({"0", "8", "32"}) int extraDexFiles;
+  @Param({"local", "boot"}) String callee;
+
+  private Member method;
+  private List<Class<?>> loaded;
+
+  public static class Filler {
+    public static int filler(int a) {
+      return a + 1;
+    }
+  }
+
+  static int localCallee(int a) {
+    return a + 1;
+  }
+
+  static int localCaller(int a) {
+    return localCallee(a);
+  }
+
+  @Override
+  protected void setUp() throws Exception {
+    loaded = new ArrayList<Class<?>>();
+    for (int i = 0; i < extraDexFiles; i++) {
+      loaded.add(XposedHooks.loadFreshCopy(Filler.class));
+    }
+    if (callee.equals("local")) {
+      method = XposedInvalidateCallersBenchmark.class.getDeclaredMethod("localCallee", int.class);
+    } else if (callee.equals("boot")) {
+      method = ArrayList.class.getDeclaredMethod("size");
+    } else {
+      throw new IllegalArgumentException(callee);
+    }
+  }
+
+  public void timeInvalidateCallers(int reps) {
+    for (int i = 0; i < reps; i++) {
+      XposedHooks.invalidateCallers(method);
+    }
+  }
+}
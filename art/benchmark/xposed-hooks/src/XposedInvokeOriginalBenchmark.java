@@ -0,0 +1,68 @@
+import com.google.caliper.Param;
+import com.google.caliper.SimpleBenchmark;
+
+import java.lang.reflect.Member;
+
+/**
+ * Measures calling the original method of a hooked method with boxed arguments, as done by
+ * XposedBridge.invokeOriginalMethodNative(), for different signatures.
+ */
+public class XposedInvokeOriginalBenchmark extends SimpleBenchmark {
+  private static final Object OBJECT = new Object();
+  private static final Object[] NO_ARGS = new Object[0];
+
+  @Param({"noArgs", "intArgs", "longDoubleArgs", "booleanArg", "objectArg", "instanceObjectArg"})
+  String signature;
+
+  private Member method;
+  private Object receiver;
+  private Object[] args;
+
+  static void noArgs() {}
+  static int intArgs(int a, int b) { return a + b; }
+  static long longDoubleArgs(long a, double b) { return a; }
+  static boolean booleanArg(boolean a) { return a; }
+  static Object objectArg(Object a) { return a; }
+  Object instanceObjectArg(Object a) { return a; }
+
+  @Override
+  protected void setUp() throws Exception {
+    Class<?> klass = XposedInvokeOriginalBenchmark.class;
+    receiver = null;
+    if (signature.equals("noArgs")) {
+      method = klass.getDeclaredMethod("noArgs");
+      args = NO_ARGS;
+    } else if (signature.equals("intArgs")) {
+      method = klass.getDeclaredMethod("intArgs", int.class, int.class);
+      args = new Object[] { 1, 2 };
+    } else if (signature.equals("longDoubleArgs")) {
+      method = klass.getDeclaredMethod("longDoubleArgs", long.class, double.class);
+      args = new Object[] { 1L, 2.0 };
+    } else if (signature.equals("booleanArg")) {
+      method = klass.getDeclaredMethod("booleanArg", boolean.class);
+      args = new Object[] { true };
+    } else if (signature.equals("objectArg")) {
+      method = klass.getDeclaredMethod("objectArg", Object.class);
+      args = new Object[] { OBJECT };
+    } else if (signature.equals("instanceObjectArg")) {
+      method = klass.getDeclaredMethod("instanceObjectArg", Object.class);
+      receiver = this;
+      args = new Object[] { OBJECT };
+    } else {
+      throw new IllegalArgumentException(signature);
+    }
+    XposedHooks.hookMethod(method);
+  }
+
+  public void timeInvokeOriginal(int reps) {
+    for (int i = 0; i < reps; i++) {
+      XposedHooks.invokeOriginalMethod(method, receiver, args);
+    }
+  }
+
+  public void timeInvokeOriginalViaReflection(int reps) {
+    for (int i = 0; i < reps; i++) {
+      XposedHooks.invokeOriginalMethodViaReflection(method, receiver, args);
+    }
+  }
+}
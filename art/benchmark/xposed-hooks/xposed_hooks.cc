@@ -0,0 +1,62 @@
+#include "jni.h"
+#include "art_method-inl.h"
+#include "class_linker.h"
+#include "gc/scoped_gc_critical_section.h"
+#include "jit/jit.h"
+#include "reflection.h"
+#include "runtime.h"
+#include "scoped_thread_state_change.h"
+#include "thread_list.h"
+#include "xposed-common/xposed_benchmark_hooks.h"
+
+namespace art {
+
+namespace {
+
+extern "C" JNIEXPORT void JNICALL Java_XposedHooks_hookMethod(JNIEnv* env,
+                                                              jclass klass,
+                                                              jobject reflected_method) {
+  // Route hooked calls to XposedHooks.handleHookedMethod().
+  HookMethodForBenchmark(env, klass, reflected_method);
+}
+
+// Same as XposedBridge.invokeOriginalMethodNative() for a hooked method.
+extern "C" JNIEXPORT jobject JNICALL Java_XposedHooks_invokeOriginalMethod(JNIEnv* env,
+                                                                           jclass,
+                                                                           jobject reflected_method,
+                                                                           jobject receiver,
+                                                                           jobjectArray args) {
+  ScopedObjectAccess soa(env);
+  ArtMethod* method = ArtMethod::FromReflectedMethod(soa, reflected_method);
+  return InvokeXposedOriginalMethod(soa, method->GetXposedHookInfo(), receiver, args);
+}
+
+// The previous implementation of invokeOriginalMethodNative(), reflection on the backup.
+extern "C" JNIEXPORT jobject JNICALL Java_XposedHooks_invokeOriginalMethodViaReflection(
+    JNIEnv* env,
+    jclass,
+    jobject reflected_method,
+    jobject receiver,
+    jobjectArray args) {
+  ScopedObjectAccess soa(env);
+  ArtMethod* method = ArtMethod::FromReflectedMethod(soa, reflected_method);
+  return InvokeMethod(soa, method->GetXposedHookInfo()->reflected_method, receiver, args);
+}
+
+extern "C" JNIEXPORT void JNICALL Java_XposedHooks_invalidateCallers(JNIEnv* env,
+                                                                     jclass,
+                                                                     jobject reflected_method) {
+  ScopedObjectAccess soa(env);
+  ArtMethod* method = ArtMethod::FromReflectedMethod(soa, reflected_method);
+  // Stop the world like EnableXposedHooks() does, which also frees the replaced snapshots of the
+  // hooked methods right away.
+  ScopedThreadSuspension sts(soa.Self(), kSuspended);
+  jit::ScopedJitSuspend sjs;
+  gc::ScopedGCCriticalSection gcs(soa.Self(), gc::kGcCauseXposed, gc::kCollectorTypeXposed);
+  ScopedSuspendAll ssa(__FUNCTION__);
+  Runtime::Current()->GetClassLinker()->InvalidateCallersForMethod(soa.Self(), method);
+}
+
+}  // namespace
+
+}  // namespace art
@@ -249,6 +249,7 @@ RUNTIME_GTEST_COMMON_SRC_FILES := \
   runtime/monitor_test.cc \
   runtime/oat_file_test.cc \
   runtime/oat_file_assistant_test.cc \
+  runtime/oat_xposed_test.cc \
   runtime/parsed_options_test.cc \
   runtime/prebuilt_tools_test.cc \
   runtime/reference_table_test.cc \
@@ -259,6 +260,7 @@ RUNTIME_GTEST_COMMON_SRC_FILES := \
   runtime/utils_test.cc \
   runtime/verifier/method_verifier_test.cc \
   runtime/verifier/reg_type_test.cc \
+  runtime/xposed_hook_stats_test.cc \
   runtime/zip_archive_test.cc
 
 COMPILER_GTEST_COMMON_SRC_FILES := \
@@ -376,7 +376,7 @@ class CompiledMethod FINAL : public CompiledCode {
                  const size_t frame_size_in_bytes,
                  const uint32_t core_spill_mask,
                  const uint32_t fp_spill_mask,
-                 const ArrayRef<const uint32_t>& called_methods,
+                 const ArrayRef<const uint64_t>& called_methods,
                  const ArrayRef<const SrcMapElem>& src_mapping_table,
                  const ArrayRef<const uint8_t>& vmap_table,
                  const ArrayRef<const uint8_t>& cfi_info,
@@ -391,7 +391,7 @@ class CompiledMethod FINAL : public CompiledCode {
       const size_t frame_size_in_bytes,
       const uint32_t core_spill_mask,
       const uint32_t fp_spill_mask,
-      const ArrayRef<const uint32_t>& called_methods,
+      const ArrayRef<const uint64_t>& called_methods,
       const ArrayRef<const SrcMapElem>& src_mapping_table,
       const ArrayRef<const uint8_t>& vmap_table,
       const ArrayRef<const uint8_t>& cfi_info,
@@ -411,7 +411,7 @@ class CompiledMethod FINAL : public CompiledCode {
     return fp_spill_mask_;
   }
 
-  ArrayRef<const uint32_t> GetCalledMethods() const {
+  ArrayRef<const uint64_t> GetCalledMethods() const {
     return GetArray(called_methods_);
   }
 
@@ -438,8 +438,8 @@ class CompiledMethod FINAL : public CompiledCode {
   const uint32_t core_spill_mask_;
   // For quick code, a bit mask describing spilled FPR callee-save registers.
   const uint32_t fp_spill_mask_;
-  // For quick code, the hashes of called methods.
-  const LengthPrefixedArray<uint32_t>* const called_methods_;
+  // For quick code, the sorted identities (see DexFile::GetMethodIdentity()) of called methods.
+  const LengthPrefixedArray<uint64_t>* const called_methods_;
   // For quick code, a set of pairs (PC, DEX) mapping from native PC offset to DEX offset.
   const LengthPrefixedArray<SrcMapElem>* const src_mapping_table_;
   // For quick code, a uleb128 encoded map from GPR/FPR register to dex register. Size prefixed.
@@ -173,7 +173,7 @@ CompiledMethodStorage::CompiledMethodStorage(int swap_fd)
       dedupe_enabled_(true),
       dedupe_code_("dedupe code", LengthPrefixedArrayAlloc<uint8_t>(swap_space_.get())),
       dedupe_called_methods_("dedupe called methods",
-                               LengthPrefixedArrayAlloc<uint32_t>(swap_space_.get())),
+                               LengthPrefixedArrayAlloc<uint64_t>(swap_space_.get())),
       dedupe_src_mapping_table_("dedupe source mapping table",
                                 LengthPrefixedArrayAlloc<SrcMapElem>(swap_space_.get())),
       dedupe_vmap_table_("dedupe vmap table",
@@ -210,12 +210,12 @@ void CompiledMethodStorage::ReleaseCode(const LengthPrefixedArray<uint8_t>* code
   ReleaseArrayIfNotDeduplicated(code);
 }
 
-const LengthPrefixedArray<uint32_t>* CompiledMethodStorage::DeduplicateCalledMethods(
-    const ArrayRef<const uint32_t>& table) {
+const LengthPrefixedArray<uint64_t>* CompiledMethodStorage::DeduplicateCalledMethods(
+    const ArrayRef<const uint64_t>& table) {
   return AllocateOrDeduplicateArray(table, &dedupe_called_methods_);
 }
 
-void CompiledMethodStorage::ReleaseCalledMethods(const LengthPrefixedArray<uint32_t>* table) {
+void CompiledMethodStorage::ReleaseCalledMethods(const LengthPrefixedArray<uint64_t>* table) {
   ReleaseArrayIfNotDeduplicated(table);
 }
 
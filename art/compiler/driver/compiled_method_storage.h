@@ -52,8 +52,8 @@ class CompiledMethodStorage {
   const LengthPrefixedArray<uint8_t>* DeduplicateCode(const ArrayRef<const uint8_t>& code);
   void ReleaseCode(const LengthPrefixedArray<uint8_t>* code);
 
-  const LengthPrefixedArray<uint32_t>* DeduplicateCalledMethods(const ArrayRef<const uint32_t>& table);
-  void ReleaseCalledMethods(const LengthPrefixedArray<uint32_t>* table);
+  const LengthPrefixedArray<uint64_t>* DeduplicateCalledMethods(const ArrayRef<const uint64_t>& table);
+  void ReleaseCalledMethods(const LengthPrefixedArray<uint64_t>* table);
 
   const LengthPrefixedArray<SrcMapElem>* DeduplicateSrcMappingTable(
       const ArrayRef<const SrcMapElem>& src_map);
@@ -99,7 +99,7 @@ class CompiledMethodStorage {
   bool dedupe_enabled_;
 
   ArrayDedupeSet<uint8_t> dedupe_code_;
-  ArrayDedupeSet<uint32_t> dedupe_called_methods_;
+  ArrayDedupeSet<uint64_t> dedupe_called_methods_;
   ArrayDedupeSet<SrcMapElem> dedupe_src_mapping_table_;
   ArrayDedupeSet<uint8_t> dedupe_vmap_table_;
   ArrayDedupeSet<uint8_t> dedupe_cfi_info_;
@@ -16,6 +16,7 @@
 
 #include "compiler_driver.h"
 
+#include <algorithm>
 #include <unordered_set>
 #include <vector>
 #include <unistd.h>
@@ -481,6 +482,8 @@ void CompilerDriver::CompileAll(jobject class_loader,
   // 3) Attempt to verify all classes
   // 4) Attempt to initialize image classes, and trivially initialized classes
   PreCompile(class_loader, dex_files, timings);
+  // Find the references to methods declared as hooked, now that the verifier resolved them.
+  ResolveHookedMethods(dex_files, timings);
   // Compile:
   // 1) Compile all classes and methods enabled for compilation. May fall back to dex-to-dex
   //    compilation.
@@ -974,6 +977,70 @@ bool CompilerDriver::IsMethodToCompile(const MethodReference& method_ref) const
   return methods_to_compile_->find(tmp.c_str()) != methods_to_compile_->end();
 }
 
+bool CompilerDriver::IsHookedMethodReference(const MethodReference& method_ref) const {
+  return !hooked_method_references_.empty() &&
+      hooked_method_references_.find(method_ref) != hooked_method_references_.end();
+}
+
+void CompilerDriver::ResolveHookedMethods(const std::vector<const DexFile*>& dex_files,
+                                          TimingLogger* timings) {
+  const std::unordered_set<std::string>* hooked_methods = compiler_options_->GetHookedMethods();
+  if (hooked_methods == nullptr) {
+    return;
+  }
+  TimingLogger::ScopedTiming t("Resolve hooked methods", timings);
+
+  // Entries look like "void java.lang.Object.<init>()", the name is between the last dot before
+  // the parameters and the opening parenthesis. Most method ids can be skipped by their name.
+  std::unordered_set<std::string> names;
+  for (const std::string& pretty_method : *hooked_methods) {
+    size_t paren = pretty_method.find('(');
+    size_t dot = (paren != std::string::npos) ? pretty_method.rfind('.', paren) : std::string::npos;
+    if (dot == std::string::npos) {
+      LOG(WARNING) << "Ignoring malformed hooked method '" << pretty_method << "'";
+      continue;
+    }
+    names.insert(pretty_method.substr(dot + 1, paren - dot - 1));
+  }
+
+  // Methods inlined from the boot class path can call hooked methods as well.
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  std::vector<const DexFile*> all_dex_files = class_linker->GetBootClassPath();
+  for (const DexFile* dex_file : dex_files) {
+    if (std::find(all_dex_files.begin(), all_dex_files.end(), dex_file) == all_dex_files.end()) {
+      all_dex_files.push_back(dex_file);
+    }
+  }
+
+  ScopedObjectAccess soa(Thread::Current());
+  for (const DexFile* dex_file : all_dex_files) {
+    mirror::DexCache* dex_cache = class_linker->FindDexCache(soa.Self(), *dex_file, true);
+    for (size_t method_idx = 0; method_idx < dex_file->NumMethodIds(); ++method_idx) {
+      const char* name = dex_file->GetMethodName(dex_file->GetMethodId(method_idx));
+      if (names.find(name) == names.end()) {
+        continue;
+      }
+      MethodReference method_ref(dex_file, method_idx);
+      if (hooked_methods->find(PrettyMethod(method_idx, *dex_file)) != hooked_methods->end()) {
+        hooked_method_references_.insert(method_ref);
+        continue;
+      }
+      // A call can refer to a hooked method through a subclass, or the hooked method can be
+      // declared in another dex file. Unresolved references are only matched by their name.
+      ArtMethod* method = (dex_cache != nullptr)
+          ? dex_cache->GetResolvedMethod(method_idx, class_linker->GetImagePointerSize())
+          : nullptr;
+      if (method != nullptr && hooked_methods->find(PrettyMethod(method)) != hooked_methods->end()) {
+        hooked_method_references_.insert(method_ref);
+        hooked_method_references_.insert(
+            MethodReference(method->GetDexFile(), method->GetDexMethodIndex()));
+      }
+    }
+  }
+  VLOG(compiler) << "Found " << hooked_method_references_.size()
+                 << " references to hooked methods";
+}
+
 bool CompilerDriver::ShouldCompileBasedOnProfile(const MethodReference& method_ref) const {
   if (profile_compilation_info_ == nullptr) {
     // If we miss profile information it means that we don't do a profile guided compilation.
@@ -174,7 +174,7 @@ class CompilerDriver {
 
   typedef SafeMap<const MethodReference, CompiledMethod*, MethodReferenceComparator> MethodTable;
 
-  MethodTable GetCompiledMethods() const SHARED_REQUIRES(compiled_methods_lock_) {
+  const MethodTable& GetCompiledMethods() const SHARED_REQUIRES(compiled_methods_lock_) {
     return compiled_methods_;
   }
 
@@ -444,6 +444,11 @@ class CompilerDriver {
   // according to the profile file.
   bool ShouldVerifyClassBasedOnProfile(const DexFile& dex_file, uint16_t class_idx) const;
 
+  // Checks whether the method reference refers to a method declared as hooked via
+  // --hooked-methods, by its name or through the method it resolves to. Calls to such methods
+  // must go through their ArtMethod, so they are never inlined, intrinsified or called directly.
+  bool IsHookedMethodReference(const MethodReference& method_ref) const;
+
   void RecordClassStatus(ClassReference ref, mirror::Class::Status status)
       REQUIRES(!compiled_classes_lock_);
 
@@ -610,6 +615,10 @@ class CompilerDriver {
       REQUIRES(!Locks::mutator_lock_, !compiled_classes_lock_);
 
   void UpdateImageClasses(TimingLogger* timings) REQUIRES(!Locks::mutator_lock_);
+
+  // Collects the references to methods declared as hooked, see IsHookedMethodReference().
+  void ResolveHookedMethods(const std::vector<const DexFile*>& dex_files, TimingLogger* timings)
+      REQUIRES(!Locks::mutator_lock_);
   static void FindClinitImageClassesCallback(mirror::Object* object, void* arg)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
@@ -681,6 +690,10 @@ class CompilerDriver {
   // This option may be restricted to the boot image, depending on a flag in the implementation.
   std::unique_ptr<std::unordered_set<std::string>> methods_to_compile_;
 
+  // References to methods declared as hooked, in the compiled and the boot class path dex files.
+  // Filled before compilation starts and only read afterwards, so it doesn't need a lock.
+  std::set<MethodReference, MethodReferenceComparator> hooked_method_references_;
+
   bool had_hard_verifier_failure_;
 
   // A thread pool that can (potentially) run tasks in parallel.
@@ -47,7 +47,8 @@ CompilerOptions::CompilerOptions()
       dump_cfg_file_name_(""),
       dump_cfg_append_(false),
       force_determinism_(false),
-      xposed_only_(false) {
+      xposed_only_(false),
+      hooked_methods_(nullptr) {
 }
 
 CompilerOptions::~CompilerOptions() {
@@ -103,7 +104,8 @@ CompilerOptions::CompilerOptions(CompilerFilter::Filter compiler_filter,
     dump_cfg_file_name_(dump_cfg_file_name),
     dump_cfg_append_(dump_cfg_append),
     force_determinism_(force_determinism),
-    xposed_only_(false) {
+    xposed_only_(false),
+    hooked_methods_(nullptr) {
 }
 
 void CompilerOptions::ParseHugeMethodMax(const StringPiece& option, UsageFn Usage) {
@@ -19,6 +19,7 @@
 
 #include <ostream>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "base/macros.h"
@@ -249,6 +250,12 @@ class CompilerOptions FINAL {
     return xposed_only_;
   }
 
+  // Pretty methods (with signature) declared as hooked via --hooked-methods, or null. The
+  // CompilerDriver resolves them, see CompilerDriver::IsHookedMethodReference().
+  const std::unordered_set<std::string>* GetHookedMethods() const {
+    return hooked_methods_;
+  }
+
  private:
   void ParseDumpInitFailures(const StringPiece& option, UsageFn Usage);
   void ParseDumpCfgPasses(const StringPiece& option, UsageFn Usage);
@@ -305,6 +312,8 @@ class CompilerOptions FINAL {
   // Whether only Xposed data needs to be collected.
   bool xposed_only_;
 
+  const std::unordered_set<std::string>* hooked_methods_;
+
   friend class Dex2Oat;
 
   DISALLOW_COPY_AND_ASSIGN(CompilerOptions);
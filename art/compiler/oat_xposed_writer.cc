@@ -1,13 +1,17 @@
 #include "oat_xposed_writer.h"
 
+#include <algorithm>
+
 #include "base/allocator.h"
 #include "base/timing_logger.h"
 #include "compiled_method.h"
 #include "dex_file.h"
 #include "driver/compiler_driver.h"
+#include "driver/compiler_options.h"
 #include "linker/output_stream.h"
 #include "oat_xposed.h"
 #include "thread-inl.h"
+#include "thread_pool.h"
 
 namespace art {
 
@@ -19,9 +23,8 @@ OatXposedWriter::OatXposedWriter(const CompilerDriver* compiler,
     dex_files_(dex_files),
     oat_file_checksum_(oat_file_checksum),
     timings_(timings),
+    data_(dex_files.size()),
     total_calls_(0) {
-  xposed_.reserve(dex_files_.size());
-  foreign_hashes_.reserve(dex_files_.size());
 }
 
 static bool EnsureAligned(OutputStream* out, size_t* offset, size_t alignment) {
@@ -40,36 +43,142 @@ static bool EnsureAligned(OutputStream* out, size_t* offset, size_t alignment) {
   return true;
 }
 
+class OatXposedWriter::PrepareDexFileTask : public SelfDeletingTask {
+ public:
+  PrepareDexFileTask(OatXposedWriter* writer, size_t dex_num)
+    : writer_(writer), dex_num_(dex_num) {}
+
+  void Run(Thread* self ATTRIBUTE_UNUSED) OVERRIDE {
+    writer_->PrepareDexFile(dex_num_);
+  }
+
+ private:
+  OatXposedWriter* const writer_;
+  const size_t dex_num_;
+};
+
 void OatXposedWriter::Prepare() {
   TimingLogger::ScopedTiming split("Prepare Xposed data", timings_);
+  Thread* self = Thread::Current();
 
-  MutexLock mu(Thread::Current(), compiler_driver_->compiled_methods_lock_);
-  CompilerDriver::MethodTable compiled_methods = compiler_driver_->GetCompiledMethods();
+  {
+    // The method table is ordered by dex file first, so the methods of each dex file form a
+    // contiguous range. Split them up in a single pass, the compiled methods themselves stay
+    // alive until the driver is destroyed.
+    MutexLock mu(self, compiler_driver_->compiled_methods_lock_);
+    const CompilerDriver::MethodTable& compiled_methods = compiler_driver_->GetCompiledMethods();
+    for (size_t i = 0; i < dex_files_.size(); ++i) {
+      const DexFile* dex_file = dex_files_[i];
+      auto it = compiled_methods.lower_bound(MethodReference(dex_file, 0u));
+      for (; it != compiled_methods.end() && it->first.dex_file == dex_file; ++it) {
+        data_[i].methods.emplace_back(it->first.dex_method_index, it->second);
+      }
+    }
+  }
 
-  for (const DexFile* dex_file : dex_files_) {
-    // Calculate the hashes for all methods in this DexFile.
-    const size_t num_methods = dex_file->NumMethodIds();
-    std::vector<uint32_t> hashes(num_methods);
-    for (size_t i = 0; i < num_methods; ++i) {
-      hashes.push_back(dex_file->GetMethodHash(i));
+  size_t num_threads = std::min(compiler_driver_->GetThreadCount(), dex_files_.size());
+  if (num_threads <= 1) {
+    for (size_t i = 0; i < dex_files_.size(); ++i) {
+      PrepareDexFile(i);
     }
-    std::sort(hashes.begin(), hashes.end());
-
-    // Now check this against the called method hashes.
-    std::vector<uint32_t> foreign_hashes;
-    for (auto& pair : compiled_methods) {
-      if (pair.first.dex_file == dex_file) {
-        const auto called_methods = pair.second->GetCalledMethods();
-        total_calls_ += called_methods.size();
-        for (uint32_t hash : called_methods) {
-          if (!std::binary_search(hashes.begin(), hashes.end(), hash)) {
-            foreign_hashes.push_back(hash);
-          }
+  } else {
+    // The calling thread does work as well.
+    ThreadPool thread_pool("Xposed writer thread pool", num_threads - 1);
+    for (size_t i = 0; i < dex_files_.size(); ++i) {
+      thread_pool.AddTask(self, new PrepareDexFileTask(this, i));
+    }
+    thread_pool.StartWorkers(self);
+    thread_pool.Wait(self, true, false);
+  }
+
+  for (const DexFileData& data : data_) {
+    total_calls_ += data.num_calls;
+  }
+}
+
+void OatXposedWriter::PrepareDexFile(size_t dex_num) {
+  const DexFile* dex_file = dex_files_[dex_num];
+  DexFileData& data = data_[dex_num];
+
+  // Calculate the hashes for all methods in this DexFile.
+  const size_t num_methods = dex_file->NumMethodIds();
+  std::vector<uint32_t> hashes;
+  hashes.reserve(num_methods);
+  for (size_t i = 0; i < num_methods; ++i) {
+    hashes.push_back(dex_file->GetMethodHash(i));
+  }
+  std::sort(hashes.begin(), hashes.end());
+
+  // Now check this against the called method hashes.
+  data.num_called_methods.resize(num_methods);
+  // The called method identities are sorted, so identities sharing a hash are adjacent. Only the
+  // distinct hashes go into the per-method lists.
+  std::vector<std::pair<uint64_t, uint16_t>> calls;
+  for (const auto& method : data.methods) {
+    const auto called_methods = method.second->GetCalledMethods();
+    uint16_t num_hashes = 0;
+    for (size_t i = 0; i < called_methods.size(); ++i) {
+      uint32_t hash = DexFile::GetMethodHashFromIdentity(called_methods[i]);
+      if (i == 0 || hash != DexFile::GetMethodHashFromIdentity(called_methods[i - 1])) {
+        ++num_hashes;
+        if (!std::binary_search(hashes.begin(), hashes.end(), hash)) {
+          data.foreign_hashes.push_back(hash);
         }
       }
+      calls.emplace_back(called_methods[i], method.first);
+    }
+    data.num_called_methods[method.first] = num_hashes;
+    data.num_calls += num_hashes;
+  }
+  STLSortAndRemoveDuplicates(&data.foreign_hashes);
+
+  // Build the inverted index, one entry per callee identity. Sorting the (callee, caller) pairs
+  // also sorts the callers of each callee, which the runtime relies on.
+  std::sort(calls.begin(), calls.end());
+  data.callers.reserve(calls.size());
+  for (size_t i = 0; i < calls.size(); ++i) {
+    if (i == 0 || calls[i].first != calls[i - 1].first) {
+      data.callee_hashes.push_back(DexFile::GetMethodHashFromIdentity(calls[i].first));
+      data.callee_secondary_hashes.push_back(static_cast<uint32_t>(calls[i].first));
+      data.callers_index.push_back(data.callers.size());
+    }
+    data.callers.push_back(calls[i].second);
+  }
+  data.callers_index.push_back(data.callers.size());
+
+  // Merge the callers of colliding identities, so that the callers of a hash are sorted and unique
+  // as well.
+  const size_t num_callees = data.callee_hashes.size();
+  for (size_t first = 0, last; first < num_callees; first = last) {
+    last = first + 1;
+    while (last < num_callees && data.callee_hashes[last] == data.callee_hashes[first]) {
+      ++last;
+    }
+    if (last - first > 1) {
+      std::vector<uint16_t> merged(data.callers.begin() + data.callers_index[first],
+                                   data.callers.begin() + data.callers_index[last]);
+      STLSortAndRemoveDuplicates(&merged);
+      data.colliding_hashes.push_back(data.callee_hashes[first]);
+      data.colliding_callers_index.push_back(data.callers.size());
+      data.callers.insert(data.callers.end(), merged.begin(), merged.end());
+    }
+  }
+  data.colliding_callers_index.push_back(data.callers.size());
+
+  // Record the methods which were declared as hooked. Calls to them weren't inlined or bound to
+  // their code, so the runtime doesn't need to look for callers in this dex file.
+  if (compiler_driver_->GetCompilerOptions().GetHookedMethods() != nullptr) {
+    std::vector<uint64_t> hook_safe_identities;
+    for (size_t i = 0; i < num_methods; ++i) {
+      if (compiler_driver_->IsHookedMethodReference(MethodReference(dex_file, i))) {
+        hook_safe_identities.push_back(dex_file->GetMethodIdentity(i));
+      }
+    }
+    STLSortAndRemoveDuplicates(&hook_safe_identities);
+    for (uint64_t identity : hook_safe_identities) {
+      data.hook_safe_hashes.push_back(DexFile::GetMethodHashFromIdentity(identity));
+      data.hook_safe_secondary_hashes.push_back(static_cast<uint32_t>(identity));
     }
-    STLSortAndRemoveDuplicates<std::vector<uint32_t>>(&foreign_hashes);
-    foreign_hashes_.emplace_back(foreign_hashes);
   }
 }
 
@@ -78,7 +187,16 @@ size_t OatXposedWriter::GetSize() {
   required_size += total_calls_ * sizeof(uint32_t);
   for (size_t i = 0; i < dex_files_.size(); ++i) {
     required_size += RoundUp(dex_files_[i]->NumMethodIds() * sizeof(uint16_t), sizeof(uint32_t));
-    required_size += foreign_hashes_[i].size() * sizeof(uint32_t);
+    const DexFileData& data = data_[i];
+    required_size += data.foreign_hashes.size() * sizeof(uint32_t);
+    required_size += data.callee_hashes.size() * sizeof(uint32_t);
+    required_size += data.callee_secondary_hashes.size() * sizeof(uint32_t);
+    required_size += data.callers_index.size() * sizeof(uint32_t);
+    required_size += RoundUp(data.callers.size() * sizeof(uint16_t), sizeof(uint32_t));
+    required_size += data.hook_safe_hashes.size() * sizeof(uint32_t);
+    required_size += data.hook_safe_secondary_hashes.size() * sizeof(uint32_t);
+    required_size += data.colliding_hashes.size() * sizeof(uint32_t);
+    required_size += data.colliding_callers_index.size() * sizeof(uint32_t);
   }
   return required_size;
 }
@@ -86,9 +204,6 @@ size_t OatXposedWriter::GetSize() {
 size_t OatXposedWriter::Write(OutputStream* out) {
   TimingLogger::ScopedTiming split("Write Xposed data", timings_);
 
-  MutexLock mu(Thread::Current(), compiler_driver_->compiled_methods_lock_);
-  CompilerDriver::MethodTable compiled_methods = compiler_driver_->GetCompiledMethods();
-
   off_t start_offset = out->Seek(0, kSeekCurrent);
   if (start_offset == static_cast<off_t>(-1)) {
     PLOG(ERROR) << "Failed to get current offset from " << out->GetLocation();
@@ -102,9 +217,9 @@ size_t OatXposedWriter::Write(OutputStream* out) {
   }
 
   OatXposedDexFile dex_file_headers[dex_files_.size()];
-  size_t dex_num = 0;
-  for (const DexFile* dex_file : dex_files_) {
-    const size_t num_methods = dex_file->NumMethodIds();
+  for (size_t dex_num = 0; dex_num < dex_files_.size(); ++dex_num) {
+    const DexFileData& data = data_[dex_num];
+    const size_t num_methods = data.num_called_methods.size();
     dex_file_headers[dex_num].num_methods = num_methods;
 
     // Write called methods hashes.
@@ -112,34 +227,78 @@ size_t OatXposedWriter::Write(OutputStream* out) {
       return false;
     }
     dex_file_headers[dex_num].called_methods_offset = relative_offset;
-    std::vector<uint16_t> num_called_methods(num_methods);
-    for (auto& pair : compiled_methods) {
-      if (pair.first.dex_file == dex_file) {
-        const auto called_methods = pair.second->GetCalledMethods();
-
-        num_called_methods[pair.first.dex_method_index] = called_methods.size();
-
-        size_t bytes = called_methods.size() * sizeof(uint32_t);
-        out->WriteFully(called_methods.data(), bytes);
-        relative_offset += bytes;
+    std::vector<uint32_t> called_hashes;
+    for (const auto& method : data.methods) {
+      called_hashes.clear();
+      for (uint64_t identity : method.second->GetCalledMethods()) {
+        uint32_t hash = DexFile::GetMethodHashFromIdentity(identity);
+        if (called_hashes.empty() || called_hashes.back() != hash) {
+          called_hashes.push_back(hash);
+        }
       }
+      DCHECK_EQ(called_hashes.size(), data.num_called_methods[method.first]);
+      size_t bytes = called_hashes.size() * sizeof(uint32_t);
+      out->WriteFully(called_hashes.data(), bytes);
+      relative_offset += bytes;
     }
 
     // Write array with number of called methods.
     dex_file_headers[dex_num].called_methods_num_offset = relative_offset;
-    out->WriteFully(num_called_methods.data(), num_methods * sizeof(uint16_t));
+    out->WriteFully(data.num_called_methods.data(), num_methods * sizeof(uint16_t));
     relative_offset += num_methods * sizeof(uint16_t);
 
     // Write foreign hashes.
     if (!EnsureAligned(out, &relative_offset, sizeof(uint32_t))) {
       return false;
     }
-    dex_file_headers[dex_num].called_methods_foreign_hashes_num = foreign_hashes_[dex_num].size();
+    dex_file_headers[dex_num].called_methods_foreign_hashes_num = data.foreign_hashes.size();
     dex_file_headers[dex_num].called_methods_foreign_hashes_offset = relative_offset;
-    out->WriteFully(foreign_hashes_[dex_num].data(), foreign_hashes_[dex_num].size() * sizeof(uint32_t));
-    relative_offset += foreign_hashes_[dex_num].size() * sizeof(uint32_t);
+    out->WriteFully(data.foreign_hashes.data(), data.foreign_hashes.size() * sizeof(uint32_t));
+    relative_offset += data.foreign_hashes.size() * sizeof(uint32_t);
+
+    // Write the inverted index (callee hash -> callers).
+    dex_file_headers[dex_num].callee_hashes_num = data.callee_hashes.size();
+    dex_file_headers[dex_num].callee_hashes_offset = relative_offset;
+    out->WriteFully(data.callee_hashes.data(), data.callee_hashes.size() * sizeof(uint32_t));
+    relative_offset += data.callee_hashes.size() * sizeof(uint32_t);
+
+    dex_file_headers[dex_num].callee_secondary_hashes_offset = relative_offset;
+    out->WriteFully(data.callee_secondary_hashes.data(),
+                    data.callee_secondary_hashes.size() * sizeof(uint32_t));
+    relative_offset += data.callee_secondary_hashes.size() * sizeof(uint32_t);
+
+    dex_file_headers[dex_num].callers_index_offset = relative_offset;
+    out->WriteFully(data.callers_index.data(), data.callers_index.size() * sizeof(uint32_t));
+    relative_offset += data.callers_index.size() * sizeof(uint32_t);
+
+    dex_file_headers[dex_num].callers_offset = relative_offset;
+    out->WriteFully(data.callers.data(), data.callers.size() * sizeof(uint16_t));
+    relative_offset += data.callers.size() * sizeof(uint16_t);
+    if (!EnsureAligned(out, &relative_offset, sizeof(uint32_t))) {
+      return false;
+    }
+
+    // Write the hook-safe method identities.
+    dex_file_headers[dex_num].hook_safe_methods_num = data.hook_safe_hashes.size();
+    dex_file_headers[dex_num].hook_safe_hashes_offset = relative_offset;
+    out->WriteFully(data.hook_safe_hashes.data(), data.hook_safe_hashes.size() * sizeof(uint32_t));
+    relative_offset += data.hook_safe_hashes.size() * sizeof(uint32_t);
+
+    dex_file_headers[dex_num].hook_safe_secondary_hashes_offset = relative_offset;
+    out->WriteFully(data.hook_safe_secondary_hashes.data(),
+                    data.hook_safe_secondary_hashes.size() * sizeof(uint32_t));
+    relative_offset += data.hook_safe_secondary_hashes.size() * sizeof(uint32_t);
+
+    // Write the merged callers index of colliding hashes.
+    dex_file_headers[dex_num].colliding_hashes_num = data.colliding_hashes.size();
+    dex_file_headers[dex_num].colliding_hashes_offset = relative_offset;
+    out->WriteFully(data.colliding_hashes.data(), data.colliding_hashes.size() * sizeof(uint32_t));
+    relative_offset += data.colliding_hashes.size() * sizeof(uint32_t);
 
-    ++dex_num;
+    dex_file_headers[dex_num].colliding_callers_index_offset = relative_offset;
+    out->WriteFully(data.colliding_callers_index.data(),
+                    data.colliding_callers_index.size() * sizeof(uint32_t));
+    relative_offset += data.colliding_callers_index.size() * sizeof(uint32_t);
   }
 
   if (out->Seek(start_offset, kSeekSet) == static_cast<off_t>(-1)) {
@@ -2,12 +2,14 @@
 #define ART_COMPILER_OAT_XPOSED_WRITER_H_
 
 #include <stdint.h>
+#include <utility>
 #include <vector>
 
 #include "base/macros.h"
 
 namespace art {
 
+class CompiledMethod;
 class CompilerDriver;
 class DexFile;
 class OutputStream;
@@ -33,15 +35,57 @@ class OatXposedWriter {
     uint32_t called_methods_offset;
     uint32_t called_methods_foreign_hashes_num;
     uint32_t called_methods_foreign_hashes_offset;
+    uint32_t callee_hashes_num;
+    uint32_t callee_hashes_offset;
+    uint32_t callers_index_offset;
+    uint32_t callers_offset;
+    uint32_t callee_secondary_hashes_offset;
+    uint32_t hook_safe_methods_num;
+    uint32_t hook_safe_hashes_offset;
+    uint32_t hook_safe_secondary_hashes_offset;
+    uint32_t colliding_hashes_num;
+    uint32_t colliding_hashes_offset;
+    uint32_t colliding_callers_index_offset;
   };
 
+  // Everything written for a single dex file, collected by Prepare() so that Write() can stream
+  // it without going through the compiled methods table again.
+  struct DexFileData {
+    // Compiled methods of the dex file, in ascending method index order.
+    std::vector<std::pair<uint32_t, const CompiledMethod*>> methods;
+    std::vector<uint16_t> num_called_methods;
+    size_t num_calls = 0;
+    std::vector<uint32_t> foreign_hashes;
+    // Inverted call graph: for each sorted unique callee identity (hash and secondary hash), the
+    // start offset of its callers in `callers` (plus one final entry), and the caller method
+    // indexes.
+    std::vector<uint32_t> callee_hashes;
+    std::vector<uint32_t> callee_secondary_hashes;
+    std::vector<uint32_t> callers_index;
+    std::vector<uint16_t> callers;
+    // Hashes shared by several callee identities, and the start offsets of the sorted, unique
+    // union of their callers, which is appended to `callers`.
+    std::vector<uint32_t> colliding_hashes;
+    std::vector<uint32_t> colliding_callers_index;
+    // Sorted identities of the methods declared as hooked (--hooked-methods), split like the
+    // callee identities.
+    std::vector<uint32_t> hook_safe_hashes;
+    std::vector<uint32_t> hook_safe_secondary_hashes;
+  };
+
+  class PrepareDexFileTask;
+
+  // Computes the foreign hashes, the caller index and the hook-safe methods for
+  // dex_files_[dex_num]. Only touches
+  // data_[dex_num], so it can run concurrently for different dex files.
+  void PrepareDexFile(size_t dex_num);
+
   const CompilerDriver* compiler_driver_;
   const std::vector<const DexFile*>& dex_files_;
   const uint32_t oat_file_checksum_;
   TimingLogger* timings_;
 
-  std::vector<OatXposedDexFile> xposed_;
-  std::vector<std::vector<uint32_t>> foreign_hashes_;
+  std::vector<DexFileData> data_;
   size_t total_calls_;
 
   DISALLOW_COPY_AND_ASSIGN(OatXposedWriter);
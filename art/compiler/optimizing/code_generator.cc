@@ -1312,36 +1312,38 @@ void CodeGenerator::AddCalledMethod(const DexFile& dex_file, uint32_t dex_method
     }
   }
 
-  called_methods_.insert(dex_file.GetMethodHash(dex_method_index));
+  called_methods_.insert(dex_file.GetMethodIdentity(dex_method_index));
 }
 
-void CodeGenerator::ComputeCalledMethods() {
-  DCHECK(block_order_ != nullptr);
-  for (HBasicBlock* block : *block_order_) {
+void CodeGenerator::ComputeCalledMethods(const CompilerDriver& compiler_driver) {
+  // The order doesn't matter, so don't depend on the linear order from register allocation.
+  for (HBasicBlock* block : GetGraph()->GetReversePostOrder()) {
     for (HInstructionIterator it(block->GetInstructions()); !it.Done(); it.Advance()) {
       HInstruction* instruction = it.Current();
       HInvoke* invoke = instruction->AsInvoke();
       if (invoke != nullptr) {
         HInvokeStaticOrDirect* direct = instruction->AsInvokeStaticOrDirect();
-        if (direct != nullptr) {
-          MethodReference target = direct->GetTargetMethod();
+        MethodReference target = (direct != nullptr)
+            ? direct->GetTargetMethod()
+            : MethodReference(&invoke->GetDexFile(), invoke->GetDexMethodIndex());
+        // Calls to methods declared as hooked always go through the ArtMethod (see HSharpening),
+        // so hooking them doesn't require invalidating the caller.
+        if (!compiler_driver.IsHookedMethodReference(target)) {
           AddCalledMethod(*target.dex_file, target.dex_method_index);
-        } else {
-          AddCalledMethod(invoke->GetDexFile(), invoke->GetDexMethodIndex());
         }
       }
     }
   }
 }
 
-const ArrayRef<const uint32_t> CodeGenerator::GetCalledMethods() {
+const ArrayRef<const uint64_t> CodeGenerator::GetCalledMethods() {
   if (called_methods_.empty()) {
-    return ArrayRef<const uint32_t>();
+    return ArrayRef<const uint64_t>();
   }
-  ArenaVector<uint32_t> called_methods(called_methods_.begin(),
+  ArenaVector<uint64_t> called_methods(called_methods_.begin(),
                                        called_methods_.end(),
                                        graph_->GetArena()->Adapter(kArenaAllocCodeGenerator));
-  return ArrayRef<const uint32_t>(called_methods);
+  return ArrayRef<const uint64_t>(called_methods);
 }
 
 }  // namespace art
@@ -466,9 +466,9 @@ class CodeGenerator : public DeletableArenaObject<kArenaAllocCodeGenerator> {
 
   void AddCalledMethod(const DexFile& dex_file, uint32_t dex_method_index);
 
-  void ComputeCalledMethods();
+  void ComputeCalledMethods(const CompilerDriver& compiler_driver);
 
-  const ArrayRef<const uint32_t> GetCalledMethods();
+  const ArrayRef<const uint64_t> GetCalledMethods();
 
  protected:
   // Method patch info used for recording locations of required linker patches and
@@ -640,8 +640,8 @@ class CodeGenerator : public DeletableArenaObject<kArenaAllocCodeGenerator> {
   // Whether an instruction in the graph accesses the current method.
   bool requires_current_method_;
 
-  // Hashes of methods called by this method.
-  ArenaSet<uint32_t> called_methods_;
+  // Identities of methods called by this method.
+  ArenaSet<uint64_t> called_methods_;
 
   friend class OptimizingCFITest;
 
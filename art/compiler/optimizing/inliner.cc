@@ -762,6 +762,13 @@ bool HInliner::TryBuildAndInline(HInvoke* invoke_instruction,
     return false;
   }
 
+  if (compiler_driver_->IsHookedMethodReference(
+          MethodReference(method->GetDexFile(), method->GetDexMethodIndex()))) {
+    VLOG(compiler) << "Method " << PrettyMethod(method)
+                   << " is not inlined because it is declared as hooked";
+    return false;
+  }
+
   // Check whether we're allowed to inline. The outermost compilation unit is the relevant
   // dex file here (though the transitivity of an inline chain would allow checking the calller).
   if (!compiler_driver_->MayInline(method->GetDexFile(),
@@ -582,7 +582,12 @@ void IntrinsicsRecognizer::Run() {
           Intrinsics intrinsic = GetIntrinsic(method);
 
           if (intrinsic != Intrinsics::kNone) {
-            if (!CheckInvokeType(intrinsic, invoke, dex_file)) {
+            if (driver_->IsHookedMethodReference(
+                    MethodReference(&dex_file, invoke->GetDexMethodIndex()))) {
+              // Intrinsics don't call the method, so a hook would be bypassed.
+              VLOG(compiler) << "Not intrinsifying hooked method "
+                  << PrettyMethod(invoke->GetDexMethodIndex(), invoke->GetDexFile());
+            } else if (!CheckInvokeType(intrinsic, invoke, dex_file)) {
               LOG(WARNING) << "Found an intrinsic with unexpected invoke type: "
                   << intrinsic << " for "
                   << PrettyMethod(invoke->GetDexMethodIndex(), invoke->GetDexFile())
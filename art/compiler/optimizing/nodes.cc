@@ -2426,6 +2426,24 @@ std::ostream& operator<<(std::ostream& os, HInvokeStaticOrDirect::MethodLoadKind
   }
 }
 
+std::ostream& operator<<(std::ostream& os, HInvokeStaticOrDirect::CodePtrLocation rhs) {
+  switch (rhs) {
+    case HInvokeStaticOrDirect::CodePtrLocation::kCallSelf:
+      return os << "self";
+    case HInvokeStaticOrDirect::CodePtrLocation::kCallPCRelative:
+      return os << "pc_relative";
+    case HInvokeStaticOrDirect::CodePtrLocation::kCallDirect:
+      return os << "direct";
+    case HInvokeStaticOrDirect::CodePtrLocation::kCallDirectWithFixup:
+      return os << "direct_fixup";
+    case HInvokeStaticOrDirect::CodePtrLocation::kCallArtMethod:
+      return os << "art_method";
+    default:
+      LOG(FATAL) << "Unknown CodePtrLocation: " << static_cast<int>(rhs);
+      UNREACHABLE();
+  }
+}
+
 std::ostream& operator<<(std::ostream& os, HInvokeStaticOrDirect::ClinitCheckRequirement rhs) {
   switch (rhs) {
     case HInvokeStaticOrDirect::ClinitCheckRequirement::kExplicit:
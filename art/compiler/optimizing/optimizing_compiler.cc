@@ -561,7 +561,6 @@ static void RunOptimizations(HGraph* graph,
   RunOptimizations(optimizations2, arraysize(optimizations2), pass_observer);
 
   RunArchOptimizations(driver->GetInstructionSet(), graph, codegen, stats, pass_observer);
-  AllocateRegisters(graph, codegen, pass_observer);
 }
 
 static ArenaVector<LinkerPatch> EmitAndSortLinkerPatches(CodeGenerator* codegen) {
@@ -582,10 +581,13 @@ CompiledMethod* OptimizingCompiler::Emit(ArenaAllocator* arena,
                                          CodeGenerator* codegen,
                                          CompilerDriver* compiler_driver,
                                          const DexFile::CodeItem* code_item) const {
-  ArenaVector<LinkerPatch> linker_patches = EmitAndSortLinkerPatches(codegen);
+  ArenaVector<LinkerPatch> linker_patches(arena->Adapter());
   ArenaVector<uint8_t> stack_map(arena->Adapter(kArenaAllocStackMaps));
-  stack_map.resize(codegen->ComputeStackMapsSize());
-  codegen->BuildStackMaps(MemoryRegion(stack_map.data(), stack_map.size()), *code_item);
+  if (!compiler_driver->GetCompilerOptions().IsXposedAnalysisOnly()) {
+    linker_patches = EmitAndSortLinkerPatches(codegen);
+    stack_map.resize(codegen->ComputeStackMapsSize());
+    codegen->BuildStackMaps(MemoryRegion(stack_map.data(), stack_map.size()), *code_item);
+  }
 
   CompiledMethod* compiled_method = CompiledMethod::SwapAllocCompiledMethod(
       compiler_driver,
@@ -778,7 +780,13 @@ CodeGenerator* OptimizingCompiler::TryCompile(ArenaAllocator* arena,
                      &pass_observer,
                      &handles);
 
-    codegen->ComputeCalledMethods();
+    // For Xposed analysis, only the invokes left after the optimizations matter, so register
+    // allocation and code generation can be skipped.
+    if (!compiler_options.IsXposedAnalysisOnly()) {
+      AllocateRegisters(graph, codegen.get(), &pass_observer);
+    }
+
+    codegen->ComputeCalledMethods(*compiler_driver);
 
     if (!compiler_options.IsXposedAnalysisOnly()) {
       codegen->Compile(code_allocator);
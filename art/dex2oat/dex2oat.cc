@@ -389,6 +389,12 @@ NO_RETURN static void Usage(const char* fmt, ...) {
   UsageError("      The data will be written to the output file (e.g. given via --oat-file).");
   UsageError("      Only .oat files are accepted as input (--dex-file).");
   UsageError("");
+  UsageError("  --hooked-methods=<file>: specify a file with methods that are expected to be");
+  UsageError("      hooked by Xposed, one per line, in the same format as --compiled-methods.");
+  UsageError("      Calls to these methods are never inlined or bound directly to their code, so");
+  UsageError("      callers can keep their compiled code when the methods are hooked.");
+  UsageError("      Example: --hooked-methods=/system/etc/xposed-hooked-methods");
+  UsageError("");
   std::cerr << "See log for usage error information\n";
   exit(EXIT_FAILURE);
 }
@@ -528,6 +534,7 @@ class Dex2Oat FINAL {
       compiled_classes_filename_(nullptr),
       compiled_methods_zip_filename_(nullptr),
       compiled_methods_filename_(nullptr),
+      hooked_methods_filename_(nullptr),
       app_image_(false),
       boot_image_(false),
       multi_image_(false),
@@ -1116,6 +1123,8 @@ class Dex2Oat FINAL {
         compiled_classes_zip_filename_ = option.substr(strlen("--compiled-classes-zip=")).data();
       } else if (option.starts_with("--compiled-methods=")) {
         compiled_methods_filename_ = option.substr(strlen("--compiled-methods=")).data();
+      } else if (option.starts_with("--hooked-methods=")) {
+        hooked_methods_filename_ = option.substr(strlen("--hooked-methods=")).data();
       } else if (option.starts_with("--compiled-methods-zip=")) {
         compiled_methods_zip_filename_ = option.substr(strlen("--compiled-methods-zip=")).data();
       } else if (option.starts_with("--base=")) {
@@ -1323,7 +1332,8 @@ class Dex2Oat FINAL {
     TimingLogger::ScopedTiming t("dex2oat Setup", timings_);
     art::MemMap::Init();  // For ZipEntry::ExtractToMemMap.
 
-    if (!PrepareImageClasses() || !PrepareCompiledClasses() || !PrepareCompiledMethods()) {
+    if (!PrepareImageClasses() || !PrepareCompiledClasses() || !PrepareCompiledMethods() ||
+        !PrepareHookedMethods()) {
       return false;
     }
 
@@ -2187,6 +2197,21 @@ class Dex2Oat FINAL {
     return true;
   }
 
+  bool PrepareHookedMethods() {
+    // If --hooked-methods was specified, read the methods which must stay hookable.
+    if (hooked_methods_filename_ != nullptr) {
+      hooked_methods_.reset(ReadCommentedInputFromFile(hooked_methods_filename_,
+                                                       nullptr));             // No post-processing.
+      if (hooked_methods_.get() == nullptr) {
+        LOG(ERROR) << "Failed to create list of hooked methods from '"
+            << hooked_methods_filename_ << "'";
+        return false;
+      }
+      compiler_options_->hooked_methods_ = hooked_methods_.get();
+    }
+    return true;
+  }
+
   void PruneNonExistentDexFiles() {
     DCHECK_EQ(dex_filenames_.size(), dex_locations_.size());
     size_t kept = 0u;
@@ -2563,9 +2588,11 @@ class Dex2Oat FINAL {
   const char* compiled_classes_filename_;
   const char* compiled_methods_zip_filename_;
   const char* compiled_methods_filename_;
+  const char* hooked_methods_filename_;
   std::unique_ptr<std::unordered_set<std::string>> image_classes_;
   std::unique_ptr<std::unordered_set<std::string>> compiled_classes_;
   std::unique_ptr<std::unordered_set<std::string>> compiled_methods_;
+  std::unique_ptr<std::unordered_set<std::string>> hooked_methods_;
   bool app_image_;
   bool boot_image_;
   bool multi_image_;
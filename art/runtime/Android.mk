@@ -59,6 +59,7 @@ LIBART_COMMON_SRC_FILES := \
   gc/accounting/heap_bitmap.cc \
   gc/accounting/mod_union_table.cc \
   gc/accounting/remembered_set.cc \
+  gc/accounting/scan_kernels.cc \
   gc/accounting/space_bitmap.cc \
   gc/collector/concurrent_copying.cc \
   gc/collector/garbage_collector.cc \
@@ -194,6 +195,7 @@ LIBART_COMMON_SRC_FILES := \
   verifier/reg_type_cache.cc \
   verifier/register_line.cc \
   well_known_classes.cc \
+  xposed_hook_stats.cc \
   zip_archive.cc
 
 LIBART_COMMON_SRC_FILES += \
@@ -520,46 +520,57 @@ void ArtMethod::InvalidateCompiledCode() {
   Runtime* runtime = Runtime::Current();
   if (runtime->UseJitCompilation()) {
     runtime->GetJit()->GetCodeCache()->InvalidateCompiledCodeFor(this);
+    runtime->GetJit()->ScheduleRecompilation(this);
   } else {
     SetEntryPointFromQuickCompiledCode(GetQuickToInterpreterBridge());
   }
 }
 
-static void StackReplaceMethodAndInstallInstrumentation(Thread* thread, void* arg)
+// Maps hooked methods to their backups, sorted by the hooked method.
+typedef std::vector<std::pair<ArtMethod*, ArtMethod*>> XposedReplacements;
+
+static void StackReplaceMethodsAndInstallInstrumentation(Thread* thread, void* arg)
     REQUIRES(Locks::mutator_lock_) {
   struct StackReplaceMethodVisitor FINAL : public StackVisitor {
-    StackReplaceMethodVisitor(Thread* thread_in, ArtMethod* search, ArtMethod* replace)
+    StackReplaceMethodVisitor(Thread* thread_in, const XposedReplacements& replacements)
         : StackVisitor(thread_in, nullptr, StackVisitor::StackWalkKind::kIncludeInlinedFramesNoResolve),
-          search_(search), replace_(replace) {};
+          replacements_(replacements) {};
 
     bool VisitFrame() REQUIRES(Locks::mutator_lock_) {
-      if (GetMethod() == search_) {
-        SetMethod(replace_);
+      ArtMethod* method = GetMethod();
+      auto it = std::lower_bound(replacements_.begin(), replacements_.end(),
+                                 std::make_pair(method, static_cast<ArtMethod*>(nullptr)));
+      if (it != replacements_.end() && it->first == method) {
+        SetMethod(it->second);
       }
       return true;
     }
 
-    ArtMethod* search_;
-    ArtMethod* replace_;
+    const XposedReplacements& replacements_;
   };
 
-  ArtMethod* search = reinterpret_cast<ArtMethod*>(arg);
-  StackReplaceMethodVisitor visitor(thread, search, search->GetXposedOriginalMethod());
+  const XposedReplacements* replacements = reinterpret_cast<const XposedReplacements*>(arg);
+  StackReplaceMethodVisitor visitor(thread, *replacements);
   visitor.WalkStack();
 
-  Runtime::Current()->GetInstrumentation()->InstrumentThreadStack(thread);
+  // Only the frames returning to invalidated callers need to go through the exit stub.
+  Runtime::Current()->GetInstrumentation()->InstrumentInvalidatedCallerFrames(thread);
 }
 
-void ArtMethod::EnableXposedHook(ScopedObjectAccess& soa, jobject additional_info) {
-  if (UNLIKELY(IsXposedHookedMethod())) {
-    // Already hooked
-    return;
-  } else if (UNLIKELY(IsXposedOriginalMethod())) {
-    // This should never happen
-    ThrowIllegalArgumentException(StringPrintf("Cannot hook the method backup: %s", PrettyMethod(this).c_str()).c_str());
-    return;
+ArtMethod* ArtMethod::GetXposedHookedMethod() {
+  DCHECK(IsXposedOriginalMethod());
+  ArtMethod* hooked_method = GetDexCacheResolvedMethod(GetDexMethodIndex(), sizeof(void*));
+  if (hooked_method == nullptr ||
+      !hooked_method->IsXposedHookedMethod() ||
+      hooked_method->GetXposedOriginalMethod() != this) {
+    return nullptr;
   }
+  return hooked_method;
+}
 
+XposedHookInfo* ArtMethod::PrepareXposedHook(ScopedObjectAccess& soa,
+                                             jobject reflected_method,
+                                             jobject additional_info) {
   // Create a backup of the ArtMethod object
   auto* cl = Runtime::Current()->GetClassLinker();
   auto* linear_alloc = cl->GetAllocatorForClassLoader(GetClassLoader());
@@ -567,45 +578,127 @@ void ArtMethod::EnableXposedHook(ScopedObjectAccess& soa, jobject additional_inf
   backup_method->CopyFrom(this, cl->GetImagePointerSize());
   backup_method->SetAccessFlags(backup_method->GetAccessFlags() | kAccXposedOriginalMethod);
 
-  // Create a Method/Constructor object for the backup ArtMethod object
-  mirror::AbstractMethod* reflected_method;
-  if (IsConstructor()) {
-    reflected_method = mirror::Constructor::CreateFromArtMethod(soa.Self(), backup_method);
-  } else {
-    reflected_method = mirror::Method::CreateFromArtMethod(soa.Self(), backup_method);
-  }
-  reflected_method->SetAccessible<false>(true);
+  // Point the Method/Constructor object to the backup ArtMethod object
+  soa.Decode<mirror::AbstractMethod*>(reflected_method)->CreateFromArtMethod(backup_method);
 
   // Save extra information in a separate structure, stored instead of the native method
   XposedHookInfo* hook_info = reinterpret_cast<XposedHookInfo*>(linear_alloc->Alloc(soa.Self(), sizeof(XposedHookInfo)));
-  hook_info->reflected_method = soa.Vm()->AddGlobalRef(soa.Self(), reflected_method);
+  hook_info->reflected_method = reflected_method;
   hook_info->additional_info = soa.Env()->NewGlobalRef(additional_info);
   hook_info->original_method = backup_method;
+  hook_info->return_type.StoreRelaxed(nullptr);
+  hook_info->parameter_types = GetParameterTypeList();
+  hook_info->stats.StoreRelaxed(nullptr);
+  return hook_info;
+}
 
-  ScopedThreadSuspension sts(soa.Self(), kSuspended);
-  jit::ScopedJitSuspend sjs;
-  gc::ScopedGCCriticalSection gcs(soa.Self(),
-                                  gc::kGcCauseXposed,
-                                  gc::kCollectorTypeXposed);
-  ScopedSuspendAll ssa(__FUNCTION__);
-
-  cl->InvalidateCallersForMethod(soa.Self(), this);
-
+void ArtMethod::CommitXposedHook(XposedHookInfo* hook_info) {
   jit::Jit* jit = art::Runtime::Current()->GetJit();
   if (jit != nullptr) {
-    jit->GetCodeCache()->MoveObsoleteMethod(this, backup_method);
+    jit->GetCodeCache()->MoveObsoleteMethod(this, hook_info->original_method);
   }
 
   SetEntryPointFromJniPtrSize(reinterpret_cast<uint8_t*>(hook_info), sizeof(void*));
   SetEntryPointFromQuickCompiledCode(GetQuickProxyInvokeHandler());
   SetCodeItemOffset(0);
 
+  // Resolving the method index in its own dex file yields this method anyway. Doing it now lets
+  // GetXposedHookedMethod() find the hooked method for the backup, which shares the dex cache.
+  // Proxy and copied methods don't own their method index, so they are looked up the slow way.
+  if (!GetDeclaringClass()->IsProxyClass() && !IsCopied()) {
+    SetDexCacheResolvedMethod(GetDexMethodIndex(), this, sizeof(void*));
+  }
+
   // Adjust access flags.
   const uint32_t kRemoveFlags = kAccNative | kAccSynchronized | kAccAbstract | kAccDefault | kAccDefaultConflict;
   SetAccessFlags((GetAccessFlags() & ~kRemoveFlags) | kAccXposedHookedMethod);
+}
+
+void ArtMethod::EnableXposedHook(ScopedObjectAccess& soa, jobject additional_info) {
+  EnableXposedHooks(soa, std::vector<ArtMethod*>({ this }), std::vector<jobject>({ additional_info }));
+}
+
+void ArtMethod::EnableXposedHooks(ScopedObjectAccess& soa,
+                                  const std::vector<ArtMethod*>& methods,
+                                  const std::vector<jobject>& additional_infos) {
+  DCHECK_EQ(methods.size(), additional_infos.size());
+
+  // Check all methods and create the Method/Constructor objects for their backups first. Don't
+  // hook anything if one of them fails, the backups live in the LinearAlloc and can't be freed.
+  std::vector<ArtMethod*> hooked_methods;
+  std::vector<jobject> reflected_methods;
+  std::vector<jobject> hooked_additional_infos;
+  for (size_t i = 0; i < methods.size(); ++i) {
+    ArtMethod* method = methods[i];
+    if (std::find(hooked_methods.begin(), hooked_methods.end(), method) != hooked_methods.end()) {
+      continue;
+    } else if (UNLIKELY(method->IsXposedHookedMethod())) {
+      // Already hooked
+      continue;
+    }
 
-  MutexLock mu(soa.Self(), *Locks::thread_list_lock_);
-  Runtime::Current()->GetThreadList()->ForEach(StackReplaceMethodAndInstallInstrumentation, this);
+    mirror::AbstractMethod* reflected_method = nullptr;
+    if (UNLIKELY(method->IsXposedOriginalMethod())) {
+      // This should never happen
+      ThrowIllegalArgumentException(StringPrintf("Cannot hook the method backup: %s", PrettyMethod(method).c_str()).c_str());
+    } else if (method->IsConstructor()) {
+      reflected_method = mirror::Constructor::CreateFromArtMethod(soa.Self(), method);
+    } else {
+      reflected_method = mirror::Method::CreateFromArtMethod(soa.Self(), method);
+    }
+    if (UNLIKELY(reflected_method == nullptr)) {
+      for (jobject prepared : reflected_methods) {
+        soa.Vm()->DeleteGlobalRef(soa.Self(), prepared);
+      }
+      return;
+    }
+    reflected_method->SetAccessible<false>(true);
+
+    hooked_methods.push_back(method);
+    reflected_methods.push_back(soa.Vm()->AddGlobalRef(soa.Self(), reflected_method));
+    hooked_additional_infos.push_back(additional_infos[i]);
+  }
+  if (hooked_methods.empty()) {
+    return;
+  }
+
+  // Create all backups before stopping the world. Nothing can fail anymore.
+  std::vector<XposedHookInfo*> hook_infos;
+  hook_infos.reserve(hooked_methods.size());
+  for (size_t i = 0; i < hooked_methods.size(); ++i) {
+    hook_infos.push_back(
+        hooked_methods[i]->PrepareXposedHook(soa, reflected_methods[i], hooked_additional_infos[i]));
+  }
+
+  auto* cl = Runtime::Current()->GetClassLinker();
+  {
+    ScopedThreadSuspension sts(soa.Self(), kSuspended);
+    jit::ScopedJitSuspend sjs;
+    gc::ScopedGCCriticalSection gcs(soa.Self(),
+                                    gc::kGcCauseXposed,
+                                    gc::kCollectorTypeXposed);
+    ScopedSuspendAll ssa(__FUNCTION__);
+
+    cl->InvalidateCallersForMethods(soa.Self(), hooked_methods);
+
+    XposedReplacements replacements;
+    replacements.reserve(hooked_methods.size());
+    for (size_t i = 0; i < hooked_methods.size(); ++i) {
+      hooked_methods[i]->CommitXposedHook(hook_infos[i]);
+      replacements.emplace_back(hooked_methods[i], hook_infos[i]->original_method);
+    }
+    std::sort(replacements.begin(), replacements.end());
+
+    MutexLock mu(soa.Self(), *Locks::thread_list_lock_);
+    Runtime::Current()->GetThreadList()->ForEach(StackReplaceMethodsAndInstallInstrumentation,
+                                                 &replacements);
+  }
+
+  // The hooks are in place now, so the invalidated callers can be compiled again.
+  jit::Jit* jit = Runtime::Current()->GetJit();
+  if (jit != nullptr) {
+    jit->CompileScheduledMethods(soa.Self());
+  }
 }
 
 }  // namespace art
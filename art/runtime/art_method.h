@@ -17,6 +17,7 @@
 #ifndef ART_RUNTIME_ART_METHOD_H_
 #define ART_RUNTIME_ART_METHOD_H_
 
+#include "atomic.h"
 #include "base/bit_utils.h"
 #include "base/casts.h"
 #include "dex_file.h"
@@ -39,10 +40,20 @@ class ScopedObjectAccessAlreadyRunnable;
 class StringPiece;
 class ShadowFrame;
 
+class XposedHookStats;
+
 struct XposedHookInfo {
   jobject reflected_method;
   jobject additional_info;
   ArtMethod* original_method;
+  // Global reference to the resolved return type of methods returning a reference.
+  // Set lazily by the first call returning a non-null value.
+  mutable Atomic<jclass> return_type;
+  // Parameter types of the hooked method, cached to build the arguments for the
+  // original method without going through reflection.
+  const DexFile::TypeList* parameter_types;
+  // Call statistics, created by the first call while they are enabled.
+  mutable Atomic<XposedHookStats*> stats;
 };
 
 namespace mirror {
@@ -745,6 +756,13 @@ class ArtMethod FINAL {
   void EnableXposedHook(ScopedObjectAccess& soa, jobject additional_info)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
+  // Hooks multiple methods with a single suspend-all, caller invalidation and stack walk.
+  // Methods which are already hooked or listed twice are skipped.
+  static void EnableXposedHooks(ScopedObjectAccess& soa,
+                                const std::vector<ArtMethod*>& methods,
+                                const std::vector<jobject>& additional_infos)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
   const XposedHookInfo* GetXposedHookInfo() {
     DCHECK(IsXposedHookedMethod());
     return reinterpret_cast<const XposedHookInfo*>(GetEntryPointFromJniPtrSize(sizeof(void*)));
@@ -754,15 +772,35 @@ class ArtMethod FINAL {
     return GetXposedHookInfo()->original_method;
   }
 
+  // Returns the hooked method for a backup created by EnableXposedHook(), or null if it can't be
+  // found without a search.
+  ArtMethod* GetXposedHookedMethod() SHARED_REQUIRES(Locks::mutator_lock_);
+
   uint32_t GetHash() SHARED_REQUIRES(Locks::mutator_lock_) {
     return GetDexFile()->GetMethodHash(GetDexMethodIndex());
   }
 
+  uint64_t GetIdentity() SHARED_REQUIRES(Locks::mutator_lock_) {
+    return GetDexFile()->GetMethodIdentity(GetDexMethodIndex());
+  }
+
   void InvalidateCompiledCode() SHARED_REQUIRES(Locks::mutator_lock_);
 
   static jclass xposed_callback_class;
   static jmethodID xposed_callback_method;
 
+ private:
+  // Creates the backup method and hook info. The reflected method is a global reference to a
+  // Method/Constructor object, which is pointed to the backup.
+  XposedHookInfo* PrepareXposedHook(ScopedObjectAccess& soa,
+                                    jobject reflected_method,
+                                    jobject additional_info)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Replaces the method with the hook. All other threads must be suspended.
+  void CommitXposedHook(XposedHookInfo* hook_info)
+      REQUIRES(Locks::mutator_lock_);
+
  protected:
   // Field order required by test "ValidateFieldOrderOfJavaCppUnionClasses".
   // The class we are a part of.
@@ -30,6 +30,7 @@
 
 #include "art_field-inl.h"
 #include "art_method-inl.h"
+#include "barrier.h"
 #include "base/arena_allocator.h"
 #include "base/casts.h"
 #include "base/logging.h"
@@ -89,6 +90,7 @@
 #include "ScopedLocalRef.h"
 #include "scoped_thread_state_change.h"
 #include "thread-inl.h"
+#include "thread_list.h"
 #include "trace.h"
 #include "utils.h"
 #include "utils/dex_cache_arrays_layout-inl.h"
@@ -313,6 +315,9 @@ ClassLinker::ClassLinker(InternTable* intern_table)
     // dex_lock_ is recursive as it may be used in stack dumping.
     : dex_lock_("ClassLinker dex lock", kDefaultMutexLevel),
       hooked_methods_lock_("ClassLinker hooked methods lock", kDefaultMutexLevel),
+      hooked_methods_(nullptr),
+      xposed_invalidated_callers_(0),
+      xposed_skipped_callers_(0),
       dex_cache_boot_image_class_lookup_required_(false),
       failed_dex_cache_class_lookups_(0),
       class_roots_(nullptr),
@@ -2047,6 +2052,7 @@ void ClassLinker::VisitClassesWithoutClassesLock(ClassVisitor* visitor) {
 }
 
 ClassLinker::~ClassLinker() {
+  delete hooked_methods_.LoadRelaxed();
   mirror::Class::ResetClass();
   mirror::Constructor::ResetClass();
   mirror::Field::ResetClass();
@@ -2083,6 +2089,7 @@ void ClassLinker::DeleteClassLoader(Thread* self, const ClassLoaderData& data) {
     if (code_cache != nullptr) {
       code_cache->RemoveMethodsIn(self, *data.allocator);
     }
+    runtime->GetJit()->RemoveScheduledMethodsIn(self, *data.allocator);
   }
   delete data.allocator;
   delete data.class_table;
@@ -3034,24 +3041,86 @@ ArtMethod* ClassLinker::FindArtMethodForIdx(mirror::DexCache* dex_cache,
 }
 
 void ClassLinker::InvalidateCallersForMethod(Thread* self, ArtMethod* method) {
-  const DexFile* method_dex_file = method->GetDexFile();
-  uint32_t dex_method_index = method->GetDexMethodIndex();
-  uint32_t hash = method->GetHash();
+  InvalidateCallersForMethods(self, std::vector<ArtMethod*>({ method }));
+}
+
+template <typename T>
+static void InsertSorted(std::vector<T>* sorted, const std::vector<T>& values) {
+  size_t old_size = sorted->size();
+  sorted->insert(sorted->end(), values.begin(), values.end());
+  auto middle = sorted->begin() + old_size;
+  std::sort(middle, sorted->end());
+  std::inplace_merge(sorted->begin(), middle, sorted->end());
+}
+
+constexpr size_t ClassLinker::HookedMethods::kFilterBits;
+
+ClassLinker::HookedMethods::HookedMethods(const HookedMethods* previous) {
+  if (previous != nullptr) {
+    hashes = previous->hashes;
+    identities = previous->identities;
+    memcpy(filter, previous->filter, sizeof(filter));
+  } else {
+    memset(filter, 0, sizeof(filter));
+  }
+}
+
+void ClassLinker::HookedMethods::Add(const std::vector<uint32_t>& new_hashes,
+                                     const std::vector<uint64_t>& new_identities) {
+  InsertSorted(&hashes, new_hashes);
+  InsertSorted(&identities, new_identities);
+  for (uint32_t hash : new_hashes) {
+    SetFilterBit(hash);
+    SetFilterBit(SecondFilterBit(hash));
+  }
+}
+
+void ClassLinker::InvalidateCallersForMethods(Thread* self, const std::vector<ArtMethod*>& methods) {
+  if (methods.empty()) {
+    return;
+  }
+
+  std::vector<uint64_t> identities;
+  std::vector<uint32_t> hashes;
+  identities.reserve(methods.size());
+  hashes.reserve(methods.size());
+  for (ArtMethod* method : methods) {
+    identities.push_back(method->GetIdentity());
+    hashes.push_back(DexFile::GetMethodHashFromIdentity(identities.back()));
+  }
 
+  size_t invalidated = 0;
+  size_t skipped = 0;
   Runtime* runtime = Runtime::Current();
   if (runtime->UseJitCompilation()) {
-    for (ArtMethod* caller : runtime->GetJit()->GetCodeCache()->GetCallers(hash)) {
-      caller->InvalidateCompiledCode();
+    jit::JitCodeCache* code_cache = runtime->GetJit()->GetCodeCache();
+    for (uint64_t identity : identities) {
+      for (ArtMethod* caller : code_cache->GetCallers(identity)) {
+        caller->InvalidateCompiledCode();
+        ++invalidated;
+      }
     }
   }
 
+  const HookedMethods* old_hooked_methods;
   {
-    // Remember the hash for callers which aren't initialized yet. When loading further methods,
+    // Remember the hashes for callers which aren't initialized yet. When loading further methods,
     // we'll check whether they call a hooked methods and invalidate their code immediately.
     WriterMutexLock mu(self, hooked_methods_lock_);
-    hooked_methods_hashes_.insert(
-        std::upper_bound(hooked_methods_hashes_.begin(), hooked_methods_hashes_.end(), hash),
-        hash);
+    old_hooked_methods = hooked_methods_.LoadRelaxed();
+    HookedMethods* new_hooked_methods = new HookedMethods(old_hooked_methods);
+    new_hooked_methods->Add(hashes, identities);
+    // Release ordering makes the contents visible to readers which load the new pointer.
+    hooked_methods_.StoreRelease(new_hooked_methods);
+  }
+  if (old_hooked_methods != nullptr) {
+    // Readers hold the mutator lock, so none of them can see the old snapshot if we hold it
+    // exclusively, which is the case when installing hooks. Otherwise wait until every thread
+    // passed a suspend point, readers don't keep the snapshot across one.
+    if (!Locks::mutator_lock_->IsExclusiveHeld(self)) {
+      WaitForHookedMethodsReaders(self);
+    }
+    delete old_hooked_methods;
   }
 
   std::vector<const DexFile*> loaded_dex_files;
@@ -3076,36 +3145,113 @@ void ClassLinker::InvalidateCallersForMethod(Thread* self, ArtMethod* method) {
       continue;
     }
 
-    // Check whether the method could have possibly been called from this DexFile.
-    // All callees which aren't declared explicitly are listed in the foreign hashes.
-    if (dex_file != method_dex_file) {
-      if (FindMethodInOtherDexFile(*method_dex_file, dex_method_index, *dex_file) == DexFile::kDexNoIndex) {
-        if (!oat_xposed_dex_file->HasForeignHash(hash)) {
-          continue;
+    // Only look up the DexCache if any of the methods is called from this DexFile.
+    mirror::DexCache* dex_cache = nullptr;
+    bool dex_cache_missing = false;
+    // Hashes of the hooked methods and their real callers, to count the callers which only call
+    // other methods with the same hash. A caller can call several hooked methods with that hash.
+    std::vector<uint32_t> matched_hashes;
+    std::vector<std::pair<uint32_t, uint16_t>> matched_callers;
+    for (size_t i = 0; i < methods.size(); ++i) {
+      const DexFile* method_dex_file = methods[i]->GetDexFile();
+      uint32_t dex_method_index = methods[i]->GetDexMethodIndex();
+      uint32_t hash = hashes[i];
+
+      // Methods declared as hooked at compile time are always called through their ArtMethod.
+      if (oat_xposed_dex_file->IsHookSafe(identities[i])) {
+        continue;
+      }
+
+      // Check whether the method could have possibly been called from this DexFile.
+      // All callees which aren't declared explicitly are listed in the foreign hashes.
+      if (dex_file != method_dex_file) {
+        if (FindMethodInOtherDexFile(*method_dex_file, dex_method_index, *dex_file) == DexFile::kDexNoIndex) {
+          if (!oat_xposed_dex_file->HasForeignHash(hash)) {
+            continue;
+          }
+        }
+      }
+
+      ArraySlice<const uint16_t> callers = oat_xposed_dex_file->GetCallersOfIdentity(identities[i]);
+      matched_hashes.push_back(hash);
+      for (uint16_t caller_idx : callers) {
+        matched_callers.emplace_back(hash, caller_idx);
+      }
+      if (callers.size() == 0) {
+        continue;
+      }
+
+      // Get DexCache.
+      if (dex_cache == nullptr) {
+        dex_cache = FindDexCache(self, *dex_file, true);
+        if (dex_cache == nullptr) {
+          dex_cache_missing = true;
+          break;
+        }
+      }
+
+      // Check for callers of this method and invalidate them.
+      for (uint32_t caller_idx : callers) {
+        ArtMethod* caller = FindArtMethodForIdx(dex_cache, dex_file, caller_idx, image_pointer_size_);
+        if (caller != nullptr) {
+          if (UNLIKELY(caller->IsXposedHookedMethod())) {
+            caller = caller->GetXposedOriginalMethod();
+          }
+          caller->InvalidateCompiledCode();
+          ++invalidated;
         }
       }
     }
 
-    // Get DexCache.
-    mirror::DexCache* dex_cache = FindDexCache(self, *dex_file, true);
-    if (dex_cache == nullptr) {
+    // The callers of the remaining methods weren't collected, don't count this DexFile.
+    if (dex_cache_missing) {
       continue;
     }
 
-    // Check for callers of this method and invalidate them.
-    for (uint32_t caller_idx : oat_xposed_dex_file->GetCallers(hash)) {
-      ArtMethod* caller = FindArtMethodForIdx(dex_cache, dex_file, caller_idx, image_pointer_size_);
-      if (caller != nullptr) {
-        if (UNLIKELY(caller->IsXposedHookedMethod())) {
-          caller = caller->GetXposedOriginalMethod();
-        }
-        caller->InvalidateCompiledCode();
-      }
+    STLSortAndRemoveDuplicates(&matched_hashes);
+    STLSortAndRemoveDuplicates(&matched_callers);
+    for (uint32_t hash : matched_hashes) {
+      auto first = std::lower_bound(matched_callers.begin(),
+                                    matched_callers.end(),
+                                    std::make_pair(hash, static_cast<uint16_t>(0u)));
+      auto last = std::upper_bound(first,
+                                   matched_callers.end(),
+                                   std::make_pair(hash, static_cast<uint16_t>(0xffffu)));
+      skipped += oat_xposed_dex_file->GetCallers(hash).size() - (last - first);
     }
   }
+
+  xposed_invalidated_callers_.FetchAndAddRelaxed(invalidated);
+  xposed_skipped_callers_.FetchAndAddRelaxed(skipped);
 }
 
-bool ClassLinker::ShouldIgnoreAotCode(Thread* self, const DexFile& dex_file, uint32_t dex_method_idx) const {
+class EmptyCheckpointClosure FINAL : public Closure {
+ public:
+  explicit EmptyCheckpointClosure(Barrier* barrier) : barrier_(barrier) {}
+
+  void Run(Thread* thread ATTRIBUTE_UNUSED) OVERRIDE {
+    barrier_->Pass(Thread::Current());
+  }
+
+ private:
+  Barrier* const barrier_;
+};
+
+void ClassLinker::WaitForHookedMethodsReaders(Thread* self) {
+  Barrier barrier(0);
+  EmptyCheckpointClosure closure(&barrier);
+  size_t threads_running_checkpoint = Runtime::Current()->GetThreadList()->RunCheckpoint(&closure);
+  // Now that we have run our checkpoint, move to a suspended state and wait
+  // for other threads to run the checkpoint.
+  ScopedThreadSuspension sts(self, kSuspended);
+  if (threads_running_checkpoint != 0) {
+    barrier.Increment(self, threads_running_checkpoint);
+  }
+}
+
+bool ClassLinker::ShouldIgnoreAotCode(Thread* self ATTRIBUTE_UNUSED,
+                                      const DexFile& dex_file,
+                                      uint32_t dex_method_idx) const {
   const OatDexFile* oat_dex_file = dex_file.GetOatDexFile();
   if (oat_dex_file == nullptr) {
     // The method isn't compiled, so we don't care.
@@ -3118,12 +3264,32 @@ bool ClassLinker::ShouldIgnoreAotCode(Thread* self, const DexFile& dex_file, uin
     return true;
   }
 
+  // No lock needed, see InvalidateCallersForMethods(). Most called methods aren't hooked, the
+  // Bloom filter sorts them out without touching the sorted arrays.
+  const HookedMethods* hooked_methods = hooked_methods_.LoadAcquire();
+  if (hooked_methods == nullptr) {
+    return false;
+  }
+
   ArraySlice<const uint32_t> called_methods = oat_xposed_dex_file->GetCalledMethods(dex_method_idx);
   if (called_methods.size() != 0) {
-    ReaderMutexLock mu(self, hooked_methods_lock_);
     for (uint32_t hash : called_methods) {
-      if (std::binary_search(hooked_methods_hashes_.begin(), hooked_methods_hashes_.end(), hash)) {
-        return true;
+      if (!hooked_methods->ContainsHash(hash)) {
+        continue;
+      }
+
+      // The hash matches, check whether one of the hooked methods with this hash is really called.
+      // For version 001 files, all callers of the hash are returned, including this method.
+      const std::vector<uint64_t>& identities = hooked_methods->identities;
+      auto it = std::lower_bound(identities.begin(),
+                                 identities.end(),
+                                 static_cast<uint64_t>(hash) << 32);
+      for (; it != identities.end() &&
+             DexFile::GetMethodHashFromIdentity(*it) == hash; ++it) {
+        ArraySlice<const uint16_t> callers = oat_xposed_dex_file->GetCallersOfIdentity(*it);
+        if (std::binary_search(callers.begin(), callers.end(), dex_method_idx)) {
+          return true;
+        }
       }
     }
   }
@@ -8199,6 +8365,8 @@ void ClassLinker::DumpForSigQuit(std::ostream& os) {
   ReaderMutexLock mu(soa.Self(), *Locks::classlinker_classes_lock_);
   os << "Zygote loaded classes=" << NumZygoteClasses() << " post zygote classes="
      << NumNonZygoteClasses() << "\n";
+  os << "Xposed invalidated callers=" << xposed_invalidated_callers_.LoadRelaxed()
+     << " skipped callers with colliding hashes=" << xposed_skipped_callers_.LoadRelaxed() << "\n";
 }
 
 class CountClassesVisitor : public ClassLoaderVisitor {
@@ -24,6 +24,7 @@
 #include <utility>
 #include <vector>
 
+#include "atomic.h"
 #include "base/allocator.h"
 #include "base/hash_set.h"
 #include "base/macros.h"
@@ -680,8 +681,16 @@ class ClassLinker {
       REQUIRES(!hooked_methods_lock_)
       REQUIRES(!dex_lock_);
 
+  // Same as above for multiple methods, but visits each loaded dex file only once.
+  void InvalidateCallersForMethods(Thread* self, const std::vector<ArtMethod*>& methods)
+      SHARED_REQUIRES(Locks::mutator_lock_)
+      REQUIRES(!hooked_methods_lock_)
+      REQUIRES(!dex_lock_);
+
+  // Returns whether the AOT code of the method calls a hooked method. Lock-free, the mutator lock
+  // keeps the hooked methods snapshot alive.
   bool ShouldIgnoreAotCode(Thread* self, const DexFile& dex_file, uint32_t dex_method_idx) const
-      REQUIRES(!hooked_methods_lock_);
+      SHARED_REQUIRES(Locks::mutator_lock_);
 
   struct DexCacheData {
     // Weak root to the DexCache. Note: Do not decode this unnecessarily or else class unloading may
@@ -714,6 +723,12 @@ class ClassLinker {
   static void DeleteClassLoader(Thread* self, const ClassLoaderData& data)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
+  // Runs an empty checkpoint on all threads, after which no reader can still use a replaced
+  // hooked methods snapshot.
+  void WaitForHookedMethodsReaders(Thread* self)
+      SHARED_REQUIRES(Locks::mutator_lock_)
+      REQUIRES(!hooked_methods_lock_);
+
   void VisitClassLoaders(ClassLoaderVisitor* visitor) const
       SHARED_REQUIRES(Locks::classlinker_classes_lock_, Locks::mutator_lock_);
 
@@ -1178,9 +1193,58 @@ class ClassLinker {
   std::list<ClassLoaderData> class_loaders_
       GUARDED_BY(Locks::classlinker_classes_lock_);
 
+  // An immutable snapshot of the methods which have been hooked. Whenever hooks are added, a new
+  // snapshot is published, so that ShouldIgnoreAotCode() can read it without taking a lock.
+  struct HookedMethods {
+    static constexpr size_t kFilterBits = 16 * KB;
+
+    explicit HookedMethods(const HookedMethods* previous);
+
+    void Add(const std::vector<uint32_t>& new_hashes, const std::vector<uint64_t>& new_identities);
+
+    // Bloom filter with two probes. False means that no method with this hash has been hooked.
+    bool MightContainHash(uint32_t hash) const {
+      return TestFilterBit(hash) && TestFilterBit(SecondFilterBit(hash));
+    }
+
+    bool ContainsHash(uint32_t hash) const {
+      return MightContainHash(hash) && std::binary_search(hashes.begin(), hashes.end(), hash);
+    }
+
+    // The hashes of all methods which have been hooked. Always sorted.
+    std::vector<uint32_t> hashes;
+    // The identities of all methods which have been hooked, to verify matches of the hashes
+    // above against oat files with callee identities. Always sorted.
+    std::vector<uint64_t> identities;
+    uint32_t filter[kFilterBits / 32];
+
+   private:
+    static uint32_t SecondFilterBit(uint32_t hash) {
+      return (hash * 0x9e3779b1u) >> 16;
+    }
+
+    bool TestFilterBit(uint32_t bit) const {
+      bit %= kFilterBits;
+      return (filter[bit / 32] & (1u << (bit % 32))) != 0;
+    }
+
+    void SetFilterBit(uint32_t bit) {
+      bit %= kFilterBits;
+      filter[bit / 32] |= 1u << (bit % 32);
+    }
+  };
+
+  // Serializes the publication of new hooked methods snapshots.
   mutable ReaderWriterMutex hooked_methods_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
-  // The hashes of all methods which have been hooked. Will always be sorted.
-  std::vector<uint32_t> hooked_methods_hashes_ GUARDED_BY(hooked_methods_lock_);
+  // The current snapshot, null until the first method is hooked.
+  Atomic<const HookedMethods*> hooked_methods_;
+
+  // Number of methods invalidated because they call a hooked method.
+  Atomic<size_t> xposed_invalidated_callers_;
+  // Number of methods which only call a method with the same hash as a hooked method, and would
+  // have been invalidated unnecessarily without the callee identities. Only counted when hooks
+  // are installed, not when methods are linked later.
+  Atomic<size_t> xposed_skipped_callers_;
 
   // Boot class path table. Since the class loader for this is null.
   ClassTable boot_class_table_ GUARDED_BY(Locks::classlinker_classes_lock_);
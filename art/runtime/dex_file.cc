@@ -1578,6 +1578,24 @@ uint32_t DexFile::GetMethodHash(uint32_t idx) const {
       + ComputeModifiedUtf8Hash(GetMethodSignature(method).ToString().c_str());
 }
 
+// 32-bit FNV-1a, continuing from the given hash. Including the terminating null keeps
+// ("ab", "c") and ("a", "bc") apart.
+static uint32_t ComputeFnvHash(const char* chars, uint32_t hash) {
+  do {
+    hash = (hash ^ static_cast<uint8_t>(*chars)) * 16777619u;
+  } while (*chars++ != '\0');
+  return hash;
+}
+
+uint64_t DexFile::GetMethodIdentity(uint32_t idx) const {
+  const MethodId& method = GetMethodId(idx);
+  uint32_t secondary_hash = 2166136261u;
+  secondary_hash = ComputeFnvHash(GetMethodDeclaringClassDescriptor(method), secondary_hash);
+  secondary_hash = ComputeFnvHash(GetMethodName(method), secondary_hash);
+  secondary_hash = ComputeFnvHash(GetMethodSignature(method).ToString().c_str(), secondary_hash);
+  return (static_cast<uint64_t>(GetMethodHash(idx)) << 32) | secondary_hash;
+}
+
 mirror::ObjectArray<mirror::String>* DexFile::GetSignatureAnnotationForClass(
     Handle<mirror::Class> klass) const {
   const AnnotationSetItem* annotation_set = FindAnnotationSetForClass(klass);
@@ -661,6 +661,14 @@ class DexFile {
   // Returns a hash for the method, based on its class, name and signature.
   uint32_t GetMethodHash(uint32_t idx) const;
 
+  // Returns a 64-bit identity for the method. The upper half is GetMethodHash(), the lower half is
+  // an independent hash of the same strings, used to tell apart methods with colliding hashes.
+  uint64_t GetMethodIdentity(uint32_t idx) const;
+
+  static constexpr uint32_t GetMethodHashFromIdentity(uint64_t identity) {
+    return static_cast<uint32_t>(identity >> 32);
+  }
+
   // Returns the prototype of a method id.
   const ProtoId& GetMethodPrototype(const MethodId& method_id) const {
     return GetProtoId(method_id.proto_idx_);
@@ -234,6 +234,57 @@ JValue InvokeProxyInvocationHandler(ScopedObjectAccessAlreadyRunnable& soa, cons
   }
 }
 
+// Shared Object[0] for hooked methods without arguments, to maintain Dalvik bug compatibility
+// without allocating an array for each call.
+static Atomic<jobjectArray> xposed_empty_args(nullptr);
+
+static jobjectArray GetXposedEmptyArgs(ScopedObjectAccessAlreadyRunnable& soa)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
+  jobjectArray empty_args = xposed_empty_args.LoadRelaxed();
+  if (LIKELY(empty_args != nullptr)) {
+    return empty_args;
+  }
+  jobjectArray local = soa.Env()->NewObjectArray(0, WellKnownClasses::java_lang_Object, nullptr);
+  if (local == nullptr) {
+    CHECK(soa.Self()->IsExceptionPending());
+    return nullptr;
+  }
+  empty_args = reinterpret_cast<jobjectArray>(soa.Env()->NewGlobalRef(local));
+  soa.Env()->DeleteLocalRef(local);
+  if (!xposed_empty_args.CompareExchangeStrongSequentiallyConsistent(nullptr, empty_args)) {
+    soa.Env()->DeleteGlobalRef(empty_args);
+    empty_args = xposed_empty_args.LoadRelaxed();
+  }
+  return empty_args;
+}
+
+// Returns the resolved return type of a hooked method, caching it in the hook info.
+static mirror::Class* GetXposedReturnType(ScopedObjectAccessAlreadyRunnable& soa,
+                                          const char* shorty,
+                                          jmethodID method,
+                                          const XposedHookInfo* hook_info)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
+  if (shorty[0] != 'L') {
+    // Primitive classes are class roots, no need to resolve anything.
+    return Runtime::Current()->GetClassLinker()->FindPrimitiveClass(shorty[0]);
+  }
+  jclass return_type = hook_info->return_type.LoadRelaxed();
+  if (LIKELY(return_type != nullptr)) {
+    return soa.Decode<mirror::Class*>(return_type);
+  }
+  // This can cause thread suspension.
+  size_t pointer_size = Runtime::Current()->GetClassLinker()->GetImagePointerSize();
+  mirror::Class* result_type = soa.DecodeMethod(method)->GetReturnType(true /* resolve */, pointer_size);
+  if (result_type == nullptr) {
+    return nullptr;
+  }
+  return_type = reinterpret_cast<jclass>(soa.Vm()->AddGlobalRef(soa.Self(), result_type));
+  if (!hook_info->return_type.CompareExchangeStrongSequentiallyConsistent(nullptr, return_type)) {
+    soa.Vm()->DeleteGlobalRef(soa.Self(), return_type);
+  }
+  return result_type;
+}
+
 JValue InvokeXposedHandleHookedMethod(ScopedObjectAccessAlreadyRunnable& soa, const char* shorty,
                                       jobject rcvr_jobj, jmethodID method,
                                       std::vector<jvalue>& args) {
@@ -241,27 +292,35 @@ JValue InvokeXposedHandleHookedMethod(ScopedObjectAccessAlreadyRunnable& soa, co
   soa.Self()->AssertThreadSuspensionIsAllowable();
   jobjectArray args_jobj = nullptr;
   const JValue zero;
-  int32_t target_sdk_version = Runtime::Current()->GetTargetSdkVersion();
-  // Do not create empty arrays unless needed to maintain Dalvik bug compatibility.
-  if (args.size() > 0 || (target_sdk_version > 0 && target_sdk_version <= 21)) {
+  if (args.size() > 0) {
     args_jobj = soa.Env()->NewObjectArray(args.size(), WellKnownClasses::java_lang_Object, nullptr);
     if (args_jobj == nullptr) {
       CHECK(soa.Self()->IsExceptionPending());
       return zero;
     }
     for (size_t i = 0; i < args.size(); ++i) {
+      mirror::Object* val;
       if (shorty[i + 1] == 'L') {
-        jobject val = args.at(i).l;
-        soa.Env()->SetObjectArrayElement(args_jobj, i, val);
+        val = soa.Decode<mirror::Object*>(args[i].l);
       } else {
+        // Boxing goes through the valueOf() caches, so small values don't allocate.
         JValue jv;
-        jv.SetJ(args.at(i).j);
-        mirror::Object* val = BoxPrimitive(Primitive::GetType(shorty[i + 1]), jv);
+        jv.SetJ(args[i].j);
+        val = BoxPrimitive(Primitive::GetType(shorty[i + 1]), jv);
         if (val == nullptr) {
           CHECK(soa.Self()->IsExceptionPending());
           return zero;
         }
-        soa.Decode<mirror::ObjectArray<mirror::Object>* >(args_jobj)->Set<false>(i, val);
+      }
+      soa.Decode<mirror::ObjectArray<mirror::Object>* >(args_jobj)->Set<false>(i, val);
+    }
+  } else {
+    // Do not create empty arrays unless needed to maintain Dalvik bug compatibility.
+    int32_t target_sdk_version = Runtime::Current()->GetTargetSdkVersion();
+    if (target_sdk_version > 0 && target_sdk_version <= 21) {
+      args_jobj = GetXposedEmptyArgs(soa);
+      if (args_jobj == nullptr) {
+        return zero;
       }
     }
   }
@@ -270,31 +329,32 @@ JValue InvokeXposedHandleHookedMethod(ScopedObjectAccessAlreadyRunnable& soa, co
 
   // Call XposedBridge.handleHookedMethod(Member method, int originalMethodId, Object additionalInfoObj,
   //                                      Object thisObject, Object[] args)
+  // We are already runnable, so call it directly instead of going through the JNI functions.
   jvalue invocation_args[5];
   invocation_args[0].l = hook_info->reflected_method;
   invocation_args[1].i = 1;
   invocation_args[2].l = hook_info->additional_info;
   invocation_args[3].l = rcvr_jobj;
   invocation_args[4].l = args_jobj;
-  jobject result =
-      soa.Env()->CallStaticObjectMethodA(ArtMethod::xposed_callback_class,
-                                         ArtMethod::xposed_callback_method,
-                                         invocation_args);
-
+  JValue result = InvokeWithJValues(soa, nullptr, ArtMethod::xposed_callback_method, invocation_args);
 
   // Unbox the result if necessary and return it.
   if (UNLIKELY(soa.Self()->IsExceptionPending())) {
     return zero;
   } else {
-    if (shorty[0] == 'V' || (shorty[0] == 'L' && result == nullptr)) {
+    if (shorty[0] == 'V' || (shorty[0] == 'L' && result.GetL() == nullptr)) {
       return zero;
     }
+    StackHandleScope<1> hs(soa.Self());
+    Handle<mirror::Object> result_ref(hs.NewHandle(result.GetL()));
     // This can cause thread suspension.
-    size_t pointer_size = Runtime::Current()->GetClassLinker()->GetImagePointerSize();
-    mirror::Class* result_type = soa.DecodeMethod(method)->GetReturnType(true /* resolve */, pointer_size);
-    mirror::Object* result_ref = soa.Decode<mirror::Object*>(result);
+    mirror::Class* result_type = GetXposedReturnType(soa, shorty, method, hook_info);
+    if (result_type == nullptr) {
+      DCHECK(soa.Self()->IsExceptionPending());
+      return zero;
+    }
     JValue result_unboxed;
-    if (!UnboxPrimitiveForResult(result_ref, result_type, &result_unboxed)) {
+    if (!UnboxPrimitiveForResult(result_ref.Get(), result_type, &result_unboxed)) {
       DCHECK(soa.Self()->IsExceptionPending());
       return zero;
     }
@@ -15,6 +15,7 @@
  */
 
 #include "art_method-inl.h"
+#include "base/time_utils.h"
 #include "callee_save_frame.h"
 #include "common_throws.h"
 #include "dex_file-inl.h"
@@ -36,6 +37,7 @@
 #include "scoped_thread_state_change.h"
 #include "stack.h"
 #include "debugger.h"
+#include "xposed_hook_stats.h"
 
 namespace art {
 
@@ -870,6 +872,7 @@ extern "C" uint64_t artQuickProxyInvokeHandler(
   std::vector<jvalue> args;
   uint32_t shorty_len = 0;
   const char* shorty = non_proxy_method->GetShorty(&shorty_len);
+  args.reserve(shorty_len);
   BuildQuickArgumentVisitor local_ref_visitor(sp, is_static, shorty, shorty_len, &soa, &args);
 
   local_ref_visitor.VisitArguments();
@@ -881,7 +884,13 @@ extern "C" uint64_t artQuickProxyInvokeHandler(
   if (is_xposed) {
     jmethodID proxy_methodid = soa.EncodeMethod(proxy_method);
     self->EndAssertNoThreadSuspension(old_cause);
+    XposedHookStats* stats =
+        XposedHookStats::ForHook(proxy_method, proxy_method->GetXposedHookInfo());
+    const uint64_t start_ns = (stats != nullptr) ? NanoTime() : 0u;
     JValue result = InvokeXposedHandleHookedMethod(soa, shorty, rcvr_jobj, proxy_methodid, args);
+    if (stats != nullptr) {
+      stats->AddCall(NanoTime() - start_ns);
+    }
     local_ref_visitor.FixupReferences();
     return result.GetJ();
   }
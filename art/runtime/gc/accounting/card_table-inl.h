@@ -22,6 +22,7 @@
 #include "base/logging.h"
 #include "card_table.h"
 #include "mem_map.h"
+#include "scan_kernels.h"
 #include "space_bitmap.h"
 
 namespace art {
@@ -61,64 +62,14 @@ inline size_t CardTable::Scan(ContinuousSpaceBitmap* bitmap, uint8_t* scan_begin
   CheckCardValid(card_end);
   size_t cards_scanned = 0;
 
-  // Handle any unaligned cards at the start.
-  while (!IsAligned<sizeof(intptr_t)>(card_cur) && card_cur < card_end) {
-    if (*card_cur >= minimum_age) {
-      uintptr_t start = reinterpret_cast<uintptr_t>(AddrFromCard(card_cur));
-      bitmap->VisitMarkedRange(start, start + kCardSize, visitor);
-      ++cards_scanned;
-      if (kClearCard) {
-        *card_cur = 0;
-      }
-    }
-    ++card_cur;
-  }
-
-  uint8_t* aligned_end = card_end -
-      (reinterpret_cast<uintptr_t>(card_end) & (sizeof(uintptr_t) - 1));
-
-  uintptr_t* word_end = reinterpret_cast<uintptr_t*>(aligned_end);
-  for (uintptr_t* word_cur = reinterpret_cast<uintptr_t*>(card_cur); word_cur < word_end;
-      ++word_cur) {
-    while (LIKELY(*word_cur == 0)) {
-      ++word_cur;
-      if (UNLIKELY(word_cur >= word_end)) {
-        goto exit_for;
-      }
-    }
-
-    // Find the first dirty card.
-    uintptr_t start_word = *word_cur;
-    uintptr_t start = reinterpret_cast<uintptr_t>(AddrFromCard(reinterpret_cast<uint8_t*>(word_cur)));
-    // TODO: Investigate if processing continuous runs of dirty cards with a single bitmap visit is
-    // more efficient.
-    for (size_t i = 0; i < sizeof(uintptr_t); ++i) {
-      if (static_cast<uint8_t>(start_word) >= minimum_age) {
-        auto* card = reinterpret_cast<uint8_t*>(word_cur) + i;
-        DCHECK(*card == static_cast<uint8_t>(start_word) || *card == kCardDirty)
-            << "card " << static_cast<size_t>(*card) << " intptr_t " << (start_word & 0xFF);
-        bitmap->VisitMarkedRange(start, start + kCardSize, visitor);
-        ++cards_scanned;
-        if (kClearCard) {
-          *card = 0;
-        }
-      }
-      start_word >>= 8;
-      start += kCardSize;
-    }
-  }
-  exit_for:
-
-  // Handle any unaligned cards at the end.
-  card_cur = reinterpret_cast<uint8_t*>(word_end);
-  while (card_cur < card_end) {
-    if (*card_cur >= minimum_age) {
-      uintptr_t start = reinterpret_cast<uintptr_t>(AddrFromCard(card_cur));
-      bitmap->VisitMarkedRange(start, start + kCardSize, visitor);
-      ++cards_scanned;
-      if (kClearCard) {
-        *card_cur = 0;
-      }
+  // TODO: Investigate if processing continuous runs of dirty cards with a single bitmap visit is
+  // more efficient.
+  while ((card_cur = ScanKernels::FindCard(card_cur, card_end, minimum_age)) < card_end) {
+    uintptr_t start = reinterpret_cast<uintptr_t>(AddrFromCard(card_cur));
+    bitmap->VisitMarkedRange(start, start + kCardSize, visitor);
+    ++cards_scanned;
+    if (kClearCard) {
+      *card_cur = 0;
     }
     ++card_cur;
   }
@@ -183,6 +134,13 @@ inline void CardTable::ModifyCardsAtomic(uint8_t* scan_begin, uint8_t* scan_end,
 
   // TODO: Parallelize.
   while (word_cur < word_end) {
+    // Skip ahead to the word of the next card that isn't clean.
+    word_cur = AlignDown(reinterpret_cast<uintptr_t*>(ScanKernels::FindCard(
+        reinterpret_cast<uint8_t*>(word_cur), reinterpret_cast<uint8_t*>(word_end), 1)),
+        sizeof(uintptr_t));
+    if (word_cur >= word_end) {
+      break;
+    }
     while (true) {
       expected_word = *word_cur;
       if (LIKELY(expected_word == 0)) {
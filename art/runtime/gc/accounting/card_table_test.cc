@@ -17,13 +17,17 @@
 #include "card_table-inl.h"
 
 #include <string>
+#include <vector>
 
 #include "atomic.h"
+#include "base/time_utils.h"
 #include "common_runtime_test.h"
 #include "handle_scope-inl.h"
 #include "mirror/class-inl.h"
 #include "mirror/string-inl.h"  // Strings are easiest to allocate
+#include "scan_kernels.h"
 #include "scoped_thread_state_change.h"
+#include "space_bitmap-inl.h"
 #include "thread_pool.h"
 #include "utils.h"
 
@@ -144,7 +148,134 @@ TEST_F(CardTableTest, TestModifyCardsAtomic) {
   }
 }
 
-// TODO: Add test for CardTable::Scan.
+class CountVisitor {
+ public:
+  explicit CountVisitor(size_t* count) : count_(count) {}
+
+  void operator()(mirror::Object* obj ATTRIBUTE_UNUSED) const {
+    ++*count_;
+  }
+
+ private:
+  size_t* const count_;
+};
+
+// Like the visitor that Heap uses to age the cards.
+class AgeCardVisitor {
+ public:
+  uint8_t operator()(uint8_t card) const {
+    return (card == CardTable::kCardDirty) ? card - 1 : 0;
+  }
+  void operator()(uint8_t* /*card*/, uint8_t /*expected_value*/, uint8_t /*new_value*/) const {
+  }
+};
+
+static const ScanKernels::Kind kAllScanKernels[] = {
+  ScanKernels::kScalar, ScanKernels::kSse41, ScanKernels::kAvx2, ScanKernels::kNeon
+};
+
+TEST_F(CardTableTest, TestScan) {
+  CommonSetup();
+  std::unique_ptr<ContinuousSpaceBitmap> bitmap(
+      ContinuousSpaceBitmap::Create("test bitmap", HeapBegin(), HeapLimit() - HeapBegin()));
+  // One object at the start of every card.
+  for (uint8_t* addr = HeapBegin(); addr < HeapLimit(); addr += CardTable::kCardSize) {
+    bitmap->Set(reinterpret_cast<mirror::Object*>(addr));
+  }
+  const uint8_t minimum_age = CardTable::kCardDirty;
+  for (ScanKernels::Kind kind : kAllScanKernels) {
+    if (!ScanKernels::Select(kind)) {
+      continue;
+    }
+    for (size_t offset = 0; offset < 64 * CardTable::kCardSize; offset += 3 * kObjectAlignment) {
+      uint8_t* start = HeapBegin() + offset;
+      uint8_t* end = HeapLimit() - offset;
+      uint8_t* card_begin = card_table_->CardFromAddr(start);
+      uint8_t* card_end = card_table_->CardFromAddr(AlignUp(end, CardTable::kCardSize));
+      FillRandom();
+      size_t expected = 0;
+      for (uint8_t* card = card_begin; card < card_end; ++card) {
+        if (*card >= minimum_age) {
+          ++expected;
+        }
+      }
+      size_t visited = 0;
+      EXPECT_EQ(expected, card_table_->Scan<true>(bitmap.get(), start, end,
+                                                  CountVisitor(&visited), minimum_age))
+          << ScanKernels::GetKindName(kind);
+      EXPECT_EQ(expected, visited) << ScanKernels::GetKindName(kind);
+      // The scanned cards are cleared, the others are left alone.
+      for (uint8_t* addr = HeapBegin(); addr < HeapLimit(); addr += CardTable::kCardSize) {
+        uint8_t* card = card_table_->CardFromAddr(addr);
+        uint8_t value = PseudoRandomCard(addr);
+        bool scanned = card >= card_begin && card < card_end && value >= minimum_age;
+        EXPECT_EQ(scanned ? 0 : value, *card);
+      }
+    }
+  }
+  ScanKernels::Init();
+}
+
+// Throughput of card scanning and aging for a 512 MB heap with a few dirty cards, which is the
+// common case for sticky and partial collections.
+// Too slow for every run, use --gtest_also_run_disabled_tests.
+TEST_F(CardTableTest, DISABLED_ScanKernelThroughput) {
+  uint8_t* heap_begin = reinterpret_cast<uint8_t*>(0x10000000);
+  const size_t heap_capacity = 512 * MB;
+  std::unique_ptr<CardTable> card_table(CardTable::Create(heap_begin, heap_capacity));
+  ASSERT_TRUE(card_table.get() != nullptr);
+  std::unique_ptr<ContinuousSpaceBitmap> bitmap(
+      ContinuousSpaceBitmap::Create("test bitmap", heap_begin, heap_capacity));
+  const size_t num_cards = heap_capacity / CardTable::kCardSize;
+  // Dirty about one card in a thousand, in small runs.
+  std::vector<uint8_t*> dirty_cards;
+  for (size_t i = 0; i < num_cards; i += 997 * 4) {
+    for (size_t j = 0; j < 4 && i + j < num_cards; ++j) {
+      uint8_t* addr = heap_begin + (i + j) * CardTable::kCardSize;
+      bitmap->Set(reinterpret_cast<mirror::Object*>(addr));
+      dirty_cards.push_back(card_table->CardFromAddr(addr));
+    }
+  }
+
+  static constexpr size_t kIterations = 10;
+  size_t expected_scanned = 0;
+  for (ScanKernels::Kind kind : kAllScanKernels) {
+    if (!ScanKernels::Select(kind)) {
+      continue;
+    }
+    for (uint8_t* card : dirty_cards) {
+      *card = CardTable::kCardDirty;
+    }
+    size_t scanned = 0;
+    size_t visited = 0;
+    uint64_t start = NanoTime();
+    for (size_t i = 0; i < kIterations; ++i) {
+      scanned = card_table->Scan<false>(bitmap.get(), heap_begin, heap_begin + heap_capacity,
+                                        CountVisitor(&visited));
+    }
+    uint64_t scan_time = (NanoTime() - start) / kIterations;
+    // The first aging leaves aged cards, the later ones clear them.
+    AgeCardVisitor age_visitor;
+    start = NanoTime();
+    for (size_t i = 0; i < kIterations; ++i) {
+      card_table->ModifyCardsAtomic(heap_begin, heap_begin + heap_capacity, age_visitor,
+                                    age_visitor);
+    }
+    uint64_t age_time = (NanoTime() - start) / kIterations;
+    for (uint8_t* card : dirty_cards) {
+      EXPECT_EQ(CardTable::kCardClean, *card);
+    }
+    if (kind == ScanKernels::kScalar) {
+      expected_scanned = scanned;
+    }
+    EXPECT_EQ(dirty_cards.size(), scanned) << ScanKernels::GetKindName(kind);
+    EXPECT_EQ(expected_scanned, scanned) << ScanKernels::GetKindName(kind);
+    LOG(INFO) << ScanKernels::GetKindName(kind) << ": Scan " << PrettyDuration(scan_time)
+              << ", ModifyCardsAtomic " << PrettyDuration(age_time);
+  }
+  ScanKernels::Init();
+}
+
 }  // namespace accounting
 }  // namespace gc
 }  // namespace art
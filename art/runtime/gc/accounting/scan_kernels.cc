@@ -0,0 +1,439 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "scan_kernels.h"
+
+#include <initializer_list>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define ART_SCAN_KERNELS_X86 1
+#elif defined(__aarch64__) || defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ART_SCAN_KERNELS_NEON 1
+#endif
+
+#include "base/bit_utils.h"
+#include "base/logging.h"
+
+namespace art {
+namespace gc {
+namespace accounting {
+
+constexpr ptrdiff_t ScanKernels::kMinVectorWords;
+
+ScanKernels::Kind ScanKernels::kind_ = ScanKernels::kScalar;
+ScanKernels::FindCardFunction* ScanKernels::find_card_ = &ScanKernels::FindCardScalar;
+ScanKernels::FindNonZeroWordFunction* ScanKernels::find_non_zero_word_ =
+    &ScanKernels::FindNonZeroWordScalar;
+ScanKernels::FindGarbageWordFunction* ScanKernels::find_garbage_word_ =
+    &ScanKernels::FindGarbageWordScalar;
+
+uint8_t* ScanKernels::FindCardScalar(uint8_t* begin, uint8_t* end, uint8_t minimum_age) {
+  if (minimum_age == 0) {
+    return begin;
+  }
+  uint8_t* cur = begin;
+  while (!IsAligned<sizeof(uintptr_t)>(cur) && cur < end) {
+    if (*cur >= minimum_age) {
+      return cur;
+    }
+    ++cur;
+  }
+  // Clean cards are zero, so whole words of them can be skipped.
+  uint8_t* aligned_end = AlignDown(end, sizeof(uintptr_t));
+  for (; cur < aligned_end; cur += sizeof(uintptr_t)) {
+    if (*reinterpret_cast<uintptr_t*>(cur) != 0) {
+      for (size_t i = 0; i < sizeof(uintptr_t); ++i) {
+        if (cur[i] >= minimum_age) {
+          return cur + i;
+        }
+      }
+    }
+  }
+  for (; cur < end; ++cur) {
+    if (*cur >= minimum_age) {
+      return cur;
+    }
+  }
+  return end;
+}
+
+// The vector variants skip ahead in blocks of four vectors while everything is zero and then
+// narrow down to a single vector. The exact card or word is found by the scalar variants, which
+// also handle what is left at the end.
+
+#ifdef ART_SCAN_KERNELS_X86
+
+__attribute__((target("sse4.1")))
+static uint8_t* FindCardSse41(uint8_t* begin, uint8_t* end, uint8_t minimum_age) {
+  if (minimum_age == 0) {
+    return begin;
+  }
+  constexpr size_t kVectorSize = sizeof(__m128i);
+  const __m128i min = _mm_set1_epi8(static_cast<char>(minimum_age));
+  uint8_t* cur = begin;
+  while (static_cast<size_t>(end - cur) >= 4 * kVectorSize) {
+    __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur));
+    __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur + kVectorSize));
+    __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur + 2 * kVectorSize));
+    __m128i v3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur + 3 * kVectorSize));
+    __m128i any = _mm_or_si128(_mm_or_si128(v0, v1), _mm_or_si128(v2, v3));
+    if (!_mm_testz_si128(any, any)) {
+      break;
+    }
+    cur += 4 * kVectorSize;
+  }
+  while (static_cast<size_t>(end - cur) >= kVectorSize) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur));
+    // Unsigned v >= min if max(v, min) == v.
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, min), v));
+    if (mask != 0) {
+      return cur + CTZ(static_cast<uint32_t>(mask));
+    }
+    cur += kVectorSize;
+  }
+  return ScanKernels::FindCardScalar(cur, end, minimum_age);
+}
+
+__attribute__((target("sse4.1")))
+static const uintptr_t* FindNonZeroWordSse41(const uintptr_t* begin, const uintptr_t* end) {
+  constexpr size_t kVectorWords = sizeof(__m128i) / sizeof(uintptr_t);
+  const uintptr_t* cur = begin;
+  while (static_cast<size_t>(end - cur) >= 4 * kVectorWords) {
+    const __m128i* v = reinterpret_cast<const __m128i*>(cur);
+    __m128i any = _mm_or_si128(_mm_or_si128(_mm_loadu_si128(v), _mm_loadu_si128(v + 1)),
+                               _mm_or_si128(_mm_loadu_si128(v + 2), _mm_loadu_si128(v + 3)));
+    if (!_mm_testz_si128(any, any)) {
+      break;
+    }
+    cur += 4 * kVectorWords;
+  }
+  while (static_cast<size_t>(end - cur) >= kVectorWords) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur));
+    if (!_mm_testz_si128(v, v)) {
+      break;
+    }
+    cur += kVectorWords;
+  }
+  return ScanKernels::FindNonZeroWordScalar(cur, end);
+}
+
+__attribute__((target("sse4.1")))
+static const uintptr_t* FindGarbageWordSse41(const uintptr_t* live,
+                                             const uintptr_t* live_end,
+                                             const uintptr_t* mark) {
+  constexpr size_t kVectorWords = sizeof(__m128i) / sizeof(uintptr_t);
+  while (static_cast<size_t>(live_end - live) >= 4 * kVectorWords) {
+    const __m128i* l = reinterpret_cast<const __m128i*>(live);
+    const __m128i* m = reinterpret_cast<const __m128i*>(mark);
+    __m128i garbage = _mm_or_si128(
+        _mm_or_si128(_mm_andnot_si128(_mm_loadu_si128(m), _mm_loadu_si128(l)),
+                     _mm_andnot_si128(_mm_loadu_si128(m + 1), _mm_loadu_si128(l + 1))),
+        _mm_or_si128(_mm_andnot_si128(_mm_loadu_si128(m + 2), _mm_loadu_si128(l + 2)),
+                     _mm_andnot_si128(_mm_loadu_si128(m + 3), _mm_loadu_si128(l + 3))));
+    if (!_mm_testz_si128(garbage, garbage)) {
+      break;
+    }
+    live += 4 * kVectorWords;
+    mark += 4 * kVectorWords;
+  }
+  while (static_cast<size_t>(live_end - live) >= kVectorWords) {
+    // The carry flag of PTEST is set if (~mark & live) == 0.
+    if (!_mm_testc_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(mark)),
+                         _mm_loadu_si128(reinterpret_cast<const __m128i*>(live)))) {
+      break;
+    }
+    live += kVectorWords;
+    mark += kVectorWords;
+  }
+  return ScanKernels::FindGarbageWordScalar(live, live_end, mark);
+}
+
+__attribute__((target("avx2")))
+static uint8_t* FindCardAvx2(uint8_t* begin, uint8_t* end, uint8_t minimum_age) {
+  if (minimum_age == 0) {
+    return begin;
+  }
+  constexpr size_t kVectorSize = sizeof(__m256i);
+  const __m256i min = _mm256_set1_epi8(static_cast<char>(minimum_age));
+  uint8_t* cur = begin;
+  while (static_cast<size_t>(end - cur) >= 4 * kVectorSize) {
+    __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cur));
+    __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cur + kVectorSize));
+    __m256i v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cur + 2 * kVectorSize));
+    __m256i v3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cur + 3 * kVectorSize));
+    __m256i any = _mm256_or_si256(_mm256_or_si256(v0, v1), _mm256_or_si256(v2, v3));
+    if (!_mm256_testz_si256(any, any)) {
+      break;
+    }
+    cur += 4 * kVectorSize;
+  }
+  while (static_cast<size_t>(end - cur) >= kVectorSize) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cur));
+    uint32_t mask = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(v, min), v)));
+    if (mask != 0) {
+      return cur + CTZ(mask);
+    }
+    cur += kVectorSize;
+  }
+  return ScanKernels::FindCardScalar(cur, end, minimum_age);
+}
+
+__attribute__((target("avx2")))
+static const uintptr_t* FindNonZeroWordAvx2(const uintptr_t* begin, const uintptr_t* end) {
+  constexpr size_t kVectorWords = sizeof(__m256i) / sizeof(uintptr_t);
+  const uintptr_t* cur = begin;
+  while (static_cast<size_t>(end - cur) >= 4 * kVectorWords) {
+    const __m256i* v = reinterpret_cast<const __m256i*>(cur);
+    __m256i any = _mm256_or_si256(
+        _mm256_or_si256(_mm256_loadu_si256(v), _mm256_loadu_si256(v + 1)),
+        _mm256_or_si256(_mm256_loadu_si256(v + 2), _mm256_loadu_si256(v + 3)));
+    if (!_mm256_testz_si256(any, any)) {
+      break;
+    }
+    cur += 4 * kVectorWords;
+  }
+  while (static_cast<size_t>(end - cur) >= kVectorWords) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cur));
+    if (!_mm256_testz_si256(v, v)) {
+      break;
+    }
+    cur += kVectorWords;
+  }
+  return ScanKernels::FindNonZeroWordScalar(cur, end);
+}
+
+__attribute__((target("avx2")))
+static const uintptr_t* FindGarbageWordAvx2(const uintptr_t* live,
+                                            const uintptr_t* live_end,
+                                            const uintptr_t* mark) {
+  constexpr size_t kVectorWords = sizeof(__m256i) / sizeof(uintptr_t);
+  while (static_cast<size_t>(live_end - live) >= 4 * kVectorWords) {
+    const __m256i* l = reinterpret_cast<const __m256i*>(live);
+    const __m256i* m = reinterpret_cast<const __m256i*>(mark);
+    __m256i garbage = _mm256_or_si256(
+        _mm256_or_si256(_mm256_andnot_si256(_mm256_loadu_si256(m), _mm256_loadu_si256(l)),
+                        _mm256_andnot_si256(_mm256_loadu_si256(m + 1), _mm256_loadu_si256(l + 1))),
+        _mm256_or_si256(_mm256_andnot_si256(_mm256_loadu_si256(m + 2), _mm256_loadu_si256(l + 2)),
+                        _mm256_andnot_si256(_mm256_loadu_si256(m + 3), _mm256_loadu_si256(l + 3))));
+    if (!_mm256_testz_si256(garbage, garbage)) {
+      break;
+    }
+    live += 4 * kVectorWords;
+    mark += 4 * kVectorWords;
+  }
+  while (static_cast<size_t>(live_end - live) >= kVectorWords) {
+    if (!_mm256_testc_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(mark)),
+                            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(live)))) {
+      break;
+    }
+    live += kVectorWords;
+    mark += kVectorWords;
+  }
+  return ScanKernels::FindGarbageWordScalar(live, live_end, mark);
+}
+
+static bool CpuHasSse41() {
+  unsigned int eax, ebx, ecx, edx;
+  if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0) {
+    return false;
+  }
+  return (ecx & bit_SSE4_1) != 0;
+}
+
+static bool CpuHasAvx2() {
+  unsigned int eax, ebx, ecx, edx;
+  if (__get_cpuid_max(0, nullptr) < 7 || __get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0) {
+    return false;
+  }
+  // The OS has to save the YMM registers on context switches.
+  if ((ecx & bit_OSXSAVE) == 0 || (ecx & bit_AVX) == 0) {
+    return false;
+  }
+  uint32_t xcr0_low, xcr0_high;
+  __asm__ volatile("xgetbv" : "=a"(xcr0_low), "=d"(xcr0_high) : "c"(0));
+  if ((xcr0_low & 0x6) != 0x6) {
+    return false;
+  }
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  return (ebx & bit_AVX2) != 0;
+}
+
+#endif  // ART_SCAN_KERNELS_X86
+
+#ifdef ART_SCAN_KERNELS_NEON
+
+static ALWAYS_INLINE bool IsZero(uint8x16_t v) {
+  uint64x2_t v64 = vreinterpretq_u64_u8(v);
+  return (vgetq_lane_u64(v64, 0) | vgetq_lane_u64(v64, 1)) == 0;
+}
+
+static uint8_t* FindCardNeon(uint8_t* begin, uint8_t* end, uint8_t minimum_age) {
+  if (minimum_age == 0) {
+    return begin;
+  }
+  constexpr size_t kVectorSize = sizeof(uint8x16_t);
+  const uint8x16_t min = vdupq_n_u8(minimum_age);
+  uint8_t* cur = begin;
+  while (static_cast<size_t>(end - cur) >= 4 * kVectorSize) {
+    uint8x16_t any = vorrq_u8(vorrq_u8(vld1q_u8(cur), vld1q_u8(cur + kVectorSize)),
+                              vorrq_u8(vld1q_u8(cur + 2 * kVectorSize),
+                                       vld1q_u8(cur + 3 * kVectorSize)));
+    if (!IsZero(any)) {
+      break;
+    }
+    cur += 4 * kVectorSize;
+  }
+  while (static_cast<size_t>(end - cur) >= kVectorSize) {
+    if (!IsZero(vcgeq_u8(vld1q_u8(cur), min))) {
+      break;
+    }
+    cur += kVectorSize;
+  }
+  return ScanKernels::FindCardScalar(cur, end, minimum_age);
+}
+
+static const uintptr_t* FindNonZeroWordNeon(const uintptr_t* begin, const uintptr_t* end) {
+  constexpr size_t kVectorWords = sizeof(uint8x16_t) / sizeof(uintptr_t);
+  const uintptr_t* cur = begin;
+  while (static_cast<size_t>(end - cur) >= 4 * kVectorWords) {
+    const uint8_t* v = reinterpret_cast<const uint8_t*>(cur);
+    uint8x16_t any = vorrq_u8(vorrq_u8(vld1q_u8(v), vld1q_u8(v + 16)),
+                              vorrq_u8(vld1q_u8(v + 32), vld1q_u8(v + 48)));
+    if (!IsZero(any)) {
+      break;
+    }
+    cur += 4 * kVectorWords;
+  }
+  while (static_cast<size_t>(end - cur) >= kVectorWords) {
+    if (!IsZero(vld1q_u8(reinterpret_cast<const uint8_t*>(cur)))) {
+      break;
+    }
+    cur += kVectorWords;
+  }
+  return ScanKernels::FindNonZeroWordScalar(cur, end);
+}
+
+static const uintptr_t* FindGarbageWordNeon(const uintptr_t* live,
+                                            const uintptr_t* live_end,
+                                            const uintptr_t* mark) {
+  constexpr size_t kVectorWords = sizeof(uint8x16_t) / sizeof(uintptr_t);
+  while (static_cast<size_t>(live_end - live) >= 4 * kVectorWords) {
+    const uint8_t* l = reinterpret_cast<const uint8_t*>(live);
+    const uint8_t* m = reinterpret_cast<const uint8_t*>(mark);
+    // vbic(l, m) is l & ~m.
+    uint8x16_t garbage = vorrq_u8(
+        vorrq_u8(vbicq_u8(vld1q_u8(l), vld1q_u8(m)),
+                 vbicq_u8(vld1q_u8(l + 16), vld1q_u8(m + 16))),
+        vorrq_u8(vbicq_u8(vld1q_u8(l + 32), vld1q_u8(m + 32)),
+                 vbicq_u8(vld1q_u8(l + 48), vld1q_u8(m + 48))));
+    if (!IsZero(garbage)) {
+      break;
+    }
+    live += 4 * kVectorWords;
+    mark += 4 * kVectorWords;
+  }
+  return ScanKernels::FindGarbageWordScalar(live, live_end, mark);
+}
+
+#endif  // ART_SCAN_KERNELS_NEON
+
+bool ScanKernels::IsSupported(Kind kind) {
+  switch (kind) {
+    case kScalar:
+      return true;
+#ifdef ART_SCAN_KERNELS_X86
+    case kSse41:
+      return CpuHasSse41();
+    case kAvx2:
+      return CpuHasAvx2();
+#endif
+#ifdef ART_SCAN_KERNELS_NEON
+    // NEON is part of the ABI on arm64 and of the arm variants we build with it.
+    case kNeon:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+bool ScanKernels::Select(Kind kind) {
+  if (!IsSupported(kind)) {
+    return false;
+  }
+  switch (kind) {
+    case kScalar:
+      find_card_ = &FindCardScalar;
+      find_non_zero_word_ = &FindNonZeroWordScalar;
+      find_garbage_word_ = &FindGarbageWordScalar;
+      break;
+#ifdef ART_SCAN_KERNELS_X86
+    case kSse41:
+      find_card_ = &FindCardSse41;
+      find_non_zero_word_ = &FindNonZeroWordSse41;
+      find_garbage_word_ = &FindGarbageWordSse41;
+      break;
+    case kAvx2:
+      find_card_ = &FindCardAvx2;
+      find_non_zero_word_ = &FindNonZeroWordAvx2;
+      find_garbage_word_ = &FindGarbageWordAvx2;
+      break;
+#endif
+#ifdef ART_SCAN_KERNELS_NEON
+    case kNeon:
+      find_card_ = &FindCardNeon;
+      find_non_zero_word_ = &FindNonZeroWordNeon;
+      find_garbage_word_ = &FindGarbageWordNeon;
+      break;
+#endif
+    default:
+      LOG(FATAL) << "Unsupported scan kernels " << GetKindName(kind);
+      UNREACHABLE();
+  }
+  kind_ = kind;
+  return true;
+}
+
+void ScanKernels::Init() {
+  for (Kind kind : { kAvx2, kSse41, kNeon }) {
+    if (Select(kind)) {
+      break;
+    }
+  }
+  VLOG(heap) << "Card and bitmap scans use " << GetKindName(kind_) << " kernels";
+}
+
+const char* ScanKernels::GetKindName(Kind kind) {
+  switch (kind) {
+    case kScalar:
+      return "scalar";
+    case kSse41:
+      return "SSE4.1";
+    case kAvx2:
+      return "AVX2";
+    case kNeon:
+      return "NEON";
+  }
+  return "unknown";
+}
+
+}  // namespace accounting
+}  // namespace gc
+}  // namespace art
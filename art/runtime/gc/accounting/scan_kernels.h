@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_GC_ACCOUNTING_SCAN_KERNELS_H_
+#define ART_RUNTIME_GC_ACCOUNTING_SCAN_KERNELS_H_
+
+#include <stdint.h>
+
+#include "base/macros.h"
+
+namespace art {
+namespace gc {
+namespace accounting {
+
+// Searches over card table bytes and bitmap words, which are mostly zero. They are used by
+// CardTable and SpaceBitmap to skip clean cards and empty bitmap words. Vectorized variants are
+// selected at runtime depending on the CPU, the scalar ones are used until Init() is called.
+class ScanKernels {
+ public:
+  enum Kind {
+    kScalar,
+    kSse41,
+    kAvx2,
+    kNeon,
+  };
+
+  // Selects the best kind that is supported by the CPU.
+  static void Init();
+
+  // Selects the given kind, returns false if it isn't supported by the CPU. Used by tests.
+  static bool Select(Kind kind);
+
+  static bool IsSupported(Kind kind);
+
+  static Kind GetKind() {
+    return kind_;
+  }
+
+  static const char* GetKindName(Kind kind);
+
+  // Returns the first card in [begin, end) whose value is at least minimum_age, or end.
+  ALWAYS_INLINE static uint8_t* FindCard(uint8_t* begin, uint8_t* end, uint8_t minimum_age) {
+    // Dirty cards often come in runs, check the next one before searching.
+    if (begin >= end || *begin >= minimum_age) {
+      return begin;
+    }
+    return find_card_(begin + 1, end, minimum_age);
+  }
+
+  // Returns the first non-zero word in [begin, end), or end.
+  ALWAYS_INLINE static const uintptr_t* FindNonZeroWord(const uintptr_t* begin,
+                                                        const uintptr_t* end) {
+    if (end - begin < kMinVectorWords) {
+      return FindNonZeroWordScalar(begin, end);
+    }
+    return find_non_zero_word_(begin, end);
+  }
+
+  // Returns the first word of live in [live, live_end) with a bit that isn't set in the
+  // corresponding word of mark, or live_end.
+  ALWAYS_INLINE static const uintptr_t* FindGarbageWord(const uintptr_t* live,
+                                                        const uintptr_t* live_end,
+                                                        const uintptr_t* mark) {
+    if (live_end - live < kMinVectorWords) {
+      return FindGarbageWordScalar(live, live_end, mark);
+    }
+    return find_garbage_word_(live, live_end, mark);
+  }
+
+  static uint8_t* FindCardScalar(uint8_t* begin, uint8_t* end, uint8_t minimum_age);
+
+  ALWAYS_INLINE static const uintptr_t* FindNonZeroWordScalar(const uintptr_t* begin,
+                                                              const uintptr_t* end) {
+    while (begin < end && *begin == 0) {
+      ++begin;
+    }
+    return begin;
+  }
+
+  ALWAYS_INLINE static const uintptr_t* FindGarbageWordScalar(const uintptr_t* live,
+                                                              const uintptr_t* live_end,
+                                                              const uintptr_t* mark) {
+    while (live < live_end && (*live & ~*mark) == 0) {
+      ++live;
+      ++mark;
+    }
+    return live;
+  }
+
+ private:
+  // Shorter ranges, like the bitmap words of a single card, aren't worth the indirect call.
+  static constexpr ptrdiff_t kMinVectorWords = 8;
+
+  typedef uint8_t* FindCardFunction(uint8_t* begin, uint8_t* end, uint8_t minimum_age);
+  typedef const uintptr_t* FindNonZeroWordFunction(const uintptr_t* begin, const uintptr_t* end);
+  typedef const uintptr_t* FindGarbageWordFunction(const uintptr_t* live,
+                                                   const uintptr_t* live_end,
+                                                   const uintptr_t* mark);
+
+  static Kind kind_;
+  static FindCardFunction* find_card_;
+  static FindNonZeroWordFunction* find_non_zero_word_;
+  static FindGarbageWordFunction* find_garbage_word_;
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(ScanKernels);
+};
+
+}  // namespace accounting
+}  // namespace gc
+}  // namespace art
+
+#endif  // ART_RUNTIME_GC_ACCOUNTING_SCAN_KERNELS_H_
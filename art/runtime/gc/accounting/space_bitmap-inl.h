@@ -24,6 +24,7 @@
 #include "atomic.h"
 #include "base/bit_utils.h"
 #include "base/logging.h"
+#include "scan_kernels.h"
 
 namespace art {
 namespace gc {
@@ -115,16 +116,18 @@ inline void SpaceBitmap<kAlignment>::VisitMarkedRange(uintptr_t visit_begin, uin
     }
 
     // Traverse the middle, full part.
-    for (size_t i = index_start + 1; i < index_end; ++i) {
-      uintptr_t w = bitmap_begin_[i];
-      if (w != 0) {
-        const uintptr_t ptr_base = IndexToOffset(i) + heap_begin_;
-        do {
-          const size_t shift = CTZ(w);
-          mirror::Object* obj = reinterpret_cast<mirror::Object*>(ptr_base + shift * kAlignment);
-          visitor(obj);
-          w ^= (static_cast<uintptr_t>(1)) << shift;
-        } while (w != 0);
+    const uintptr_t* const middle_end = &bitmap_begin_[index_end];
+    for (const uintptr_t* cur = &bitmap_begin_[index_start + 1];
+         (cur = ScanKernels::FindNonZeroWord(cur, middle_end)) < middle_end;
+         ++cur) {
+      // Reload the word, it may have changed since it was found if marking is concurrent.
+      uintptr_t w = *cur;
+      const uintptr_t ptr_base = IndexToOffset<uintptr_t>(cur - bitmap_begin_) + heap_begin_;
+      while (w != 0) {
+        const size_t shift = CTZ(w);
+        mirror::Object* obj = reinterpret_cast<mirror::Object*>(ptr_base + shift * kAlignment);
+        visitor(obj);
+        w ^= (static_cast<uintptr_t>(1)) << shift;
       }
     }
 
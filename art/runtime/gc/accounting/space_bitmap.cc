@@ -101,6 +101,24 @@ void SpaceBitmap<kAlignment>::Clear() {
   }
 }
 
+template<size_t kAlignment>
+void SpaceBitmap<kAlignment>::ClearRange(const mirror::Object* begin, const mirror::Object* end) {
+  uintptr_t begin_offset = reinterpret_cast<uintptr_t>(begin) - heap_begin_;
+  uintptr_t end_offset = reinterpret_cast<uintptr_t>(end) - heap_begin_;
+  // Clear the partial words at both ends bit by bit.
+  while (begin_offset < end_offset && (begin_offset / kAlignment) % kBitsPerIntPtrT != 0) {
+    Clear(reinterpret_cast<mirror::Object*>(heap_begin_ + begin_offset));
+    begin_offset += kAlignment;
+  }
+  while (begin_offset < end_offset && (end_offset / kAlignment) % kBitsPerIntPtrT != 0) {
+    end_offset -= kAlignment;
+    Clear(reinterpret_cast<mirror::Object*>(heap_begin_ + end_offset));
+  }
+  const uintptr_t start_index = OffsetToIndex(begin_offset);
+  const uintptr_t end_index = OffsetToIndex(end_offset);
+  std::fill(bitmap_begin_ + start_index, bitmap_begin_ + end_index, 0);
+}
+
 template<size_t kAlignment>
 void SpaceBitmap<kAlignment>::CopyFrom(SpaceBitmap* source_bitmap) {
   DCHECK_EQ(Size(), source_bitmap->Size());
@@ -160,23 +178,25 @@ void SpaceBitmap<kAlignment>::SweepWalk(const SpaceBitmap<kAlignment>& live_bitm
   size_t start = OffsetToIndex(sweep_begin - live_bitmap.heap_begin_);
   size_t end = OffsetToIndex(sweep_end - live_bitmap.heap_begin_ - 1);
   CHECK_LT(end, live_bitmap.Size() / sizeof(intptr_t));
-  uintptr_t* live = live_bitmap.bitmap_begin_;
-  uintptr_t* mark = mark_bitmap.bitmap_begin_;
-  for (size_t i = start; i <= end; i++) {
+  const uintptr_t* live = live_bitmap.bitmap_begin_;
+  const uintptr_t* mark = mark_bitmap.bitmap_begin_;
+  const uintptr_t* const live_end = &live[end + 1];
+  for (const uintptr_t* cur = &live[start];
+       (cur = ScanKernels::FindGarbageWord(cur, live_end, &mark[cur - live])) < live_end;
+       ++cur) {
+    const size_t i = cur - live;
     uintptr_t garbage = live[i] & ~mark[i];
-    if (UNLIKELY(garbage != 0)) {
-      uintptr_t ptr_base = IndexToOffset(i) + live_bitmap.heap_begin_;
-      do {
-        const size_t shift = CTZ(garbage);
-        garbage ^= (static_cast<uintptr_t>(1)) << shift;
-        *pb++ = reinterpret_cast<mirror::Object*>(ptr_base + shift * kAlignment);
-      } while (garbage != 0);
-      // Make sure that there are always enough slots available for an
-      // entire word of one bits.
-      if (pb >= &pointer_buf[buffer_size - kBitsPerIntPtrT]) {
-        (*callback)(pb - &pointer_buf[0], &pointer_buf[0], arg);
-        pb = &pointer_buf[0];
-      }
+    uintptr_t ptr_base = IndexToOffset(i) + live_bitmap.heap_begin_;
+    while (garbage != 0) {
+      const size_t shift = CTZ(garbage);
+      garbage ^= (static_cast<uintptr_t>(1)) << shift;
+      *pb++ = reinterpret_cast<mirror::Object*>(ptr_base + shift * kAlignment);
+    }
+    // Make sure that there are always enough slots available for an
+    // entire word of one bits.
+    if (pb >= &pointer_buf[buffer_size - kBitsPerIntPtrT]) {
+      (*callback)(pb - &pointer_buf[0], &pointer_buf[0], arg);
+      pb = &pointer_buf[0];
     }
   }
   if (pb > &pointer_buf[0]) {
@@ -19,9 +19,12 @@
 #include <stdint.h>
 #include <memory>
 
+#include "base/time_utils.h"
 #include "common_runtime_test.h"
 #include "globals.h"
+#include "scan_kernels.h"
 #include "space_bitmap-inl.h"
+#include "utils.h"
 
 namespace art {
 namespace gc {
@@ -87,6 +90,33 @@ TEST_F(SpaceBitmapTest, ScanRange) {
   }
 }
 
+TEST_F(SpaceBitmapTest, ClearRange) {
+  uint8_t* heap_begin = reinterpret_cast<uint8_t*>(0x10000000);
+  size_t heap_capacity = 16 * MB;
+
+  std::unique_ptr<ContinuousSpaceBitmap> space_bitmap(
+      ContinuousSpaceBitmap::Create("test bitmap", heap_begin, heap_capacity));
+  EXPECT_TRUE(space_bitmap.get() != nullptr);
+
+  // Try ranges that start and end inside a word as well as word-aligned ones.
+  const size_t kNumBits = kBitsPerIntPtrT * 4;
+  for (size_t i = 0; i < static_cast<size_t>(kBitsPerIntPtrT) + 1; ++i) {
+    for (size_t j = i; j < kNumBits; j += 7) {
+      for (size_t k = 0; k < kNumBits; ++k) {
+        space_bitmap->Set(reinterpret_cast<mirror::Object*>(heap_begin + k * kObjectAlignment));
+      }
+      space_bitmap->ClearRange(
+          reinterpret_cast<mirror::Object*>(heap_begin + i * kObjectAlignment),
+          reinterpret_cast<mirror::Object*>(heap_begin + j * kObjectAlignment));
+      for (size_t k = 0; k < kNumBits; ++k) {
+        const mirror::Object* obj =
+            reinterpret_cast<mirror::Object*>(heap_begin + k * kObjectAlignment);
+        EXPECT_EQ(k < i || k >= j, space_bitmap->Test(obj)) << i << " " << j << " " << k;
+      }
+    }
+  }
+}
+
 class SimpleCounter {
  public:
   explicit SimpleCounter(size_t* counter) : count_(counter) {}
@@ -165,6 +195,135 @@ TEST_F(SpaceBitmapTest, VisitorPageAlignment) {
   RunTest<kPageSize>();
 }
 
+static const ScanKernels::Kind kAllScanKernels[] = {
+  ScanKernels::kScalar, ScanKernels::kSse41, ScanKernels::kAvx2, ScanKernels::kNeon
+};
+
+TEST_F(SpaceBitmapTest, VisitorAllScanKernels) {
+  for (ScanKernels::Kind kind : kAllScanKernels) {
+    if (ScanKernels::Select(kind)) {
+      RunTest<kObjectAlignment>();
+    }
+  }
+  ScanKernels::Init();
+}
+
+static void SweepCounter(size_t num_ptrs, mirror::Object** ptrs ATTRIBUTE_UNUSED, void* arg) {
+  *reinterpret_cast<size_t*>(arg) += num_ptrs;
+}
+
+TEST_F(SpaceBitmapTest, SweepWalk) {
+  uint8_t* heap_begin = reinterpret_cast<uint8_t*>(0x10000000);
+  size_t heap_capacity = 16 * MB;
+  std::unique_ptr<ContinuousSpaceBitmap> live_bitmap(
+      ContinuousSpaceBitmap::Create("test live bitmap", heap_begin, heap_capacity));
+  std::unique_ptr<ContinuousSpaceBitmap> mark_bitmap(
+      ContinuousSpaceBitmap::Create("test mark bitmap", heap_begin, heap_capacity));
+
+  // Clusters of live objects, most of them marked.
+  RandGen r(0x1234);
+  size_t garbage = 0;
+  for (int i = 0; i < 2000; ++i) {
+    size_t offset = RoundDown(r.next() % heap_capacity, kObjectAlignment);
+    for (size_t j = 0; j < 16 && offset < heap_capacity; ++j, offset += kObjectAlignment) {
+      const mirror::Object* obj = reinterpret_cast<mirror::Object*>(heap_begin + offset);
+      if (live_bitmap->Set(obj)) {
+        continue;
+      }
+      if (r.next() % 8 == 0) {
+        ++garbage;
+      } else {
+        mark_bitmap->Set(obj);
+      }
+    }
+  }
+
+  for (ScanKernels::Kind kind : kAllScanKernels) {
+    if (!ScanKernels::Select(kind)) {
+      continue;
+    }
+    // Sweep ranges that start and end at odd offsets.
+    for (size_t begin_offset = 0; begin_offset < 3 * KB; begin_offset += 520) {
+      size_t count = 0;
+      uintptr_t sweep_begin = reinterpret_cast<uintptr_t>(heap_begin) + begin_offset;
+      uintptr_t sweep_end = reinterpret_cast<uintptr_t>(heap_begin) + heap_capacity - begin_offset;
+      ContinuousSpaceBitmap::SweepWalk(*live_bitmap, *mark_bitmap, sweep_begin, sweep_end,
+                                       SweepCounter, &count);
+      size_t manual = 0;
+      for (uintptr_t k = sweep_begin; k < sweep_end; k += kObjectAlignment) {
+        const mirror::Object* obj = reinterpret_cast<mirror::Object*>(k);
+        if (live_bitmap->Test(obj) && !mark_bitmap->Test(obj)) {
+          manual++;
+        }
+      }
+      EXPECT_EQ(manual, count) << ScanKernels::GetKindName(kind);
+      if (begin_offset == 0) {
+        EXPECT_EQ(garbage, count);
+      }
+    }
+  }
+  ScanKernels::Init();
+}
+
+// Throughput of the scans over the bitmaps of a 512 MB heap with sparsely marked objects, as in
+// the card scans and sweeps of young collections.
+// Too slow for every run, use --gtest_also_run_disabled_tests.
+TEST_F(SpaceBitmapTest, DISABLED_ScanKernelThroughput) {
+  uint8_t* heap_begin = reinterpret_cast<uint8_t*>(0x10000000);
+  size_t heap_capacity = 512 * MB;
+  std::unique_ptr<ContinuousSpaceBitmap> live_bitmap(
+      ContinuousSpaceBitmap::Create("test live bitmap", heap_begin, heap_capacity));
+  std::unique_ptr<ContinuousSpaceBitmap> mark_bitmap(
+      ContinuousSpaceBitmap::Create("test mark bitmap", heap_begin, heap_capacity));
+  RandGen r(0x1234);
+  for (int i = 0; i < 20000; ++i) {
+    const mirror::Object* obj = reinterpret_cast<mirror::Object*>(
+        heap_begin + RoundDown(r.next() % heap_capacity, kObjectAlignment));
+    live_bitmap->Set(obj);
+    if (i % 4 != 0) {
+      mark_bitmap->Set(obj);
+    }
+  }
+
+  static constexpr size_t kIterations = 10;
+  size_t expected_visited = 0;
+  size_t expected_garbage = 0;
+  for (ScanKernels::Kind kind : kAllScanKernels) {
+    if (!ScanKernels::Select(kind)) {
+      continue;
+    }
+    size_t visited = 0;
+    size_t garbage = 0;
+    uint64_t start = NanoTime();
+    for (size_t i = 0; i < kIterations; ++i) {
+      visited = 0;
+      live_bitmap->VisitMarkedRange(reinterpret_cast<uintptr_t>(heap_begin),
+                                    reinterpret_cast<uintptr_t>(heap_begin) + heap_capacity,
+                                    SimpleCounter(&visited));
+    }
+    uint64_t visit_time = (NanoTime() - start) / kIterations;
+    start = NanoTime();
+    for (size_t i = 0; i < kIterations; ++i) {
+      garbage = 0;
+      // Only counts, the live bitmap isn't modified.
+      ContinuousSpaceBitmap::SweepWalk(*live_bitmap, *mark_bitmap,
+                                       reinterpret_cast<uintptr_t>(heap_begin),
+                                       reinterpret_cast<uintptr_t>(heap_begin) + heap_capacity,
+                                       SweepCounter, &garbage);
+    }
+    uint64_t sweep_time = (NanoTime() - start) / kIterations;
+    if (kind == ScanKernels::kScalar) {
+      expected_visited = visited;
+      expected_garbage = garbage;
+    }
+    EXPECT_EQ(expected_visited, visited) << ScanKernels::GetKindName(kind);
+    EXPECT_EQ(expected_garbage, garbage) << ScanKernels::GetKindName(kind);
+    LOG(INFO) << ScanKernels::GetKindName(kind) << ": VisitMarkedRange "
+              << PrettyDuration(visit_time) << ", SweepWalk " << PrettyDuration(sweep_time);
+  }
+  ScanKernels::Init();
+}
+
 }  // namespace accounting
 }  // namespace gc
 }  // namespace art
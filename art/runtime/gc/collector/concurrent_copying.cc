@@ -19,6 +19,7 @@
 #include "art_field-inl.h"
 #include "base/stl_util.h"
 #include "debugger.h"
+#include "gc/accounting/card_table-inl.h"
 #include "gc/accounting/heap_bitmap-inl.h"
 #include "gc/accounting/space_bitmap-inl.h"
 #include "gc/reference_processor.h"
@@ -31,6 +32,7 @@
 #include "scoped_thread_state_change.h"
 #include "thread-inl.h"
 #include "thread_list.h"
+#include "thread_pool.h"
 #include "well_known_classes.h"
 
 namespace art {
@@ -39,15 +41,17 @@ namespace collector {
 
 static constexpr size_t kDefaultGcMarkStackSize = 2 * MB;
 
-ConcurrentCopying::ConcurrentCopying(Heap* heap, const std::string& name_prefix)
+ConcurrentCopying::ConcurrentCopying(Heap* heap, bool young_gen, const std::string& name_prefix)
     : GarbageCollector(heap,
                        name_prefix + (name_prefix.empty() ? "" : " ") +
                        "concurrent copying + mark sweep"),
-      region_space_(nullptr), gc_barrier_(new Barrier(0)),
+      young_gen_(young_gen), region_space_(nullptr), gc_barrier_(new Barrier(0)),
       gc_mark_stack_(accounting::ObjectStack::Create("concurrent copying gc mark stack",
                                                      kDefaultGcMarkStackSize,
                                                      kDefaultGcMarkStackSize)),
       mark_stack_lock_("concurrent copying mark stack lock", kMarkSweepMarkStackLock),
+      parallel_mark_cond_("concurrent copying parallel mark condition", mark_stack_lock_),
+      parallel_mark_workers_(0), parallel_mark_idle_workers_(0), parallel_mark_count_(0),
       thread_running_gc_(nullptr),
       is_marking_(false), is_active_(false), is_asserting_to_space_invariant_(false),
       heap_mark_bitmap_(nullptr), live_stack_freeze_size_(0), mark_stack_mode_(kMarkStackModeOff),
@@ -147,12 +151,24 @@ void ConcurrentCopying::BindBitmaps() {
       cc_heap_bitmap_->AddContinuousSpaceBitmap(bitmap);
       cc_bitmaps_.push_back(bitmap);
     } else if (space == region_space_) {
-      accounting::ContinuousSpaceBitmap* bitmap =
-          accounting::ContinuousSpaceBitmap::Create("cc region space bitmap",
-                                                    space->Begin(), space->Capacity());
-      cc_heap_bitmap_->AddContinuousSpaceBitmap(bitmap);
-      cc_bitmaps_.push_back(bitmap);
-      region_space_bitmap_ = bitmap;
+      // The region space keeps its bitmap across collections. A young collection relies on it to
+      // find the live objects in the promoted regions, a full one marks everything again.
+      region_space_bitmap_ = region_space_->GetRegionMarkBitmap();
+      if (!young_gen_) {
+        region_space_bitmap_->Clear();
+      }
+      cc_heap_bitmap_->AddContinuousSpaceBitmap(region_space_bitmap_);
+    } else if (young_gen_ && space->IsContinuousMemMapAllocSpace() &&
+               space->GetGcRetentionPolicy() == space::kGcRetentionPolicyAlwaysCollect) {
+      // Like StickyMarkSweep, consider the objects that survived the previous collection marked
+      // by binding the live bitmap to the mark bitmap. Only a full collection sweeps them.
+      space->AsContinuousMemMapAllocSpace()->BindLiveToMarkBitmap();
+    }
+  }
+  if (young_gen_) {
+    for (const auto& space : heap_->GetDiscontinuousSpaces()) {
+      CHECK(space->IsLargeObjectSpace());
+      space->AsLargeObjectSpace()->CopyLiveToMarked();
     }
   }
 }
@@ -238,15 +254,21 @@ class ConcurrentCopying::FlipCallback : public Closure {
     Thread* self = Thread::Current();
     CHECK(thread == self);
     Locks::mutator_lock_->AssertExclusiveHeld(self);
-    cc->region_space_->SetFromSpace(cc->rb_table_, cc->force_evacuate_all_);
+    cc->region_space_->SetFromSpace(cc->rb_table_, cc->force_evacuate_all_, cc->young_gen_);
     cc->SwapStacks();
     if (ConcurrentCopying::kEnableFromSpaceAccountingCheck) {
       cc->RecordLiveStackFreezeSize(self);
-      cc->from_space_num_objects_at_first_pause_ = cc->region_space_->GetObjectsAllocated();
-      cc->from_space_num_bytes_at_first_pause_ = cc->region_space_->GetBytesAllocated();
+      // The promoted regions that a young collection keeps in the to-space don't count.
+      cc->from_space_num_objects_at_first_pause_ =
+          cc->region_space_->GetObjectsAllocatedInFromSpace() +
+          cc->region_space_->GetObjectsAllocatedInUnevacFromSpace();
+      cc->from_space_num_bytes_at_first_pause_ =
+          cc->region_space_->GetBytesAllocatedInFromSpace() +
+          cc->region_space_->GetBytesAllocatedInUnevacFromSpace();
     }
     cc->is_marking_ = true;
     cc->mark_stack_mode_.StoreRelaxed(ConcurrentCopying::kMarkStackModeThreadLocal);
+    cc->ProcessCards();
     if (UNLIKELY(Runtime::Current()->IsActiveTransaction())) {
       CHECK(Runtime::Current()->IsAotCompiler());
       TimingLogger::ScopedTiming split2("(Paused)VisitTransactionRoots", cc->GetTimings());
@@ -296,6 +318,61 @@ void ConcurrentCopying::RecordLiveStackFreezeSize(Thread* self) {
   live_stack_freeze_size_ = heap_->GetLiveStack()->Size();
 }
 
+// Used to gray the objects on dirty cards for a young collection.
+class ConcurrentCopying::DirtyCardVisitor {
+ public:
+  explicit DirtyCardVisitor(ConcurrentCopying* cc) : collector_(cc) {}
+
+  void operator()(mirror::Object* obj) const REQUIRES(Locks::mutator_lock_)
+      SHARED_REQUIRES(Locks::heap_bitmap_lock_) {
+    DCHECK(obj != nullptr);
+    DCHECK(!collector_->region_space_->IsInFromSpace(obj)) << obj;
+    // The object may already be gray if it's also a new non-moving object.
+    if (kUseBakerReadBarrier &&
+        !obj->AtomicSetReadBarrierPointer(ReadBarrier::WhitePtr(), ReadBarrier::GrayPtr())) {
+      return;
+    }
+    collector_->PushOntoMarkStack(obj);
+  }
+
+ private:
+  ConcurrentCopying* const collector_;
+};
+
+void ConcurrentCopying::ProcessCards() {
+  if (!heap_->UseGenerationalConcurrentCopying()) {
+    // Only young collections need the cards.
+    return;
+  }
+  TimingLogger::ScopedTiming split("(Paused)ProcessCards", GetTimings());
+  accounting::CardTable* card_table = heap_->GetCardTable();
+  space::ContinuousMemMapAllocSpace* non_moving_space = heap_->non_moving_space_;
+  if (young_gen_) {
+    ReaderMutexLock mu(Thread::Current(), *Locks::heap_bitmap_lock_);
+    // The objects allocated in the non-moving space since the previous collection may have
+    // references that were stored without dirtying a card. Mark them all, they are only freed by
+    // a full collection. The new large objects have no references.
+    accounting::ObjectStack* live_stack = GetLiveStack();
+    for (auto* it = live_stack->Begin(), *end = live_stack->End(); it < end; ++it) {
+      mirror::Object* obj = it->AsMirrorPtr();
+      if (obj != nullptr && non_moving_space->HasAddress(obj)) {
+        MarkNonMoving(obj);
+      }
+    }
+    // The older objects were scanned by an earlier collection and only the ones that were
+    // written to since then may refer to the regions that are evacuated now.
+    DirtyCardVisitor visitor(this);
+    card_table->Scan<false>(region_space_bitmap_, region_space_->Begin(), region_space_->Limit(),
+                            visitor);
+    card_table->Scan<false>(non_moving_space->GetLiveBitmap(), non_moving_space->Begin(),
+                            non_moving_space->End(), visitor);
+  }
+  // A full collection scans everything anyway. The cards dirtied from now on are for the next
+  // young collection.
+  card_table->ClearCardRange(region_space_->Begin(), region_space_->Limit());
+  card_table->ClearCardRange(non_moving_space->Begin(), non_moving_space->Limit());
+}
+
 // Used to visit objects in the immune spaces.
 class ConcurrentCopying::ImmuneSpaceObjVisitor {
  public:
@@ -599,24 +676,12 @@ void ConcurrentCopying::PushOntoMarkStack(mirror::Object* to_ref) {
       if (UNLIKELY(tl_mark_stack == nullptr || tl_mark_stack->IsFull())) {
         MutexLock mu(self, mark_stack_lock_);
         // Get a new thread local mark stack.
-        accounting::AtomicStack<mirror::Object>* new_tl_mark_stack;
-        if (!pooled_mark_stacks_.empty()) {
-          // Use a pooled mark stack.
-          new_tl_mark_stack = pooled_mark_stacks_.back();
-          pooled_mark_stacks_.pop_back();
-        } else {
-          // None pooled. Create a new one.
-          new_tl_mark_stack =
-              accounting::AtomicStack<mirror::Object>::Create(
-                  "thread local mark stack", 4 * KB, 4 * KB);
-        }
-        DCHECK(new_tl_mark_stack != nullptr);
-        DCHECK(new_tl_mark_stack->IsEmpty());
+        accounting::AtomicStack<mirror::Object>* new_tl_mark_stack = AllocateMarkStack();
         new_tl_mark_stack->PushBack(to_ref);
         self->SetThreadLocalMarkStack(new_tl_mark_stack);
         if (tl_mark_stack != nullptr) {
           // Store the old full stack into a vector.
-          revoked_mark_stacks_.push_back(tl_mark_stack);
+          AddRevokedMarkStack(self, tl_mark_stack);
         }
       } else {
         tl_mark_stack->PushBack(to_ref);
@@ -676,7 +741,7 @@ class ConcurrentCopying::VerifyNoFromSpaceRefsVisitor : public SingleRootVisitor
       } else {
         CHECK(ref->GetReadBarrierPointer() == ReadBarrier::BlackPtr() ||
               (ref->GetReadBarrierPointer() == ReadBarrier::WhitePtr() &&
-               collector_->IsOnAllocStack(ref)))
+               (collector_->young_gen_ || collector_->IsOnAllocStack(ref))))
             << "Non-moving/unevac from space ref " << ref << " " << PrettyTypeOf(ref)
             << " has non-black rb_ptr " << ref->GetReadBarrierPointer()
             << " but isn't on the alloc stack (and has white rb_ptr)."
@@ -754,7 +819,7 @@ class ConcurrentCopying::VerifyNoFromSpaceRefsObjectVisitor {
       } else {
         CHECK(obj->GetReadBarrierPointer() == ReadBarrier::BlackPtr() ||
               (obj->GetReadBarrierPointer() == ReadBarrier::WhitePtr() &&
-               collector->IsOnAllocStack(obj)))
+               (collector->young_gen_ || collector->IsOnAllocStack(obj))))
             << "Non-moving space/unevac from space ref " << obj << " " << PrettyTypeOf(obj)
             << " has non-black rb_ptr " << obj->GetReadBarrierPointer()
             << " but isn't on the alloc stack (and has white rb_ptr). Is it in the non-moving space="
@@ -786,8 +851,12 @@ void ConcurrentCopying::VerifyNoFromSpaceReferences() {
     VerifyNoFromSpaceRefsVisitor ref_visitor(this);
     Runtime::Current()->VisitRoots(&ref_visitor);
   }
-  // The to-space.
-  region_space_->WalkToSpace(VerifyNoFromSpaceRefsObjectVisitor::ObjectCallback, this);
+  // The to-space. The promoted regions that a young collection keeps may hold dead objects.
+  if (young_gen_) {
+    region_space_->WalkLiveToSpace(VerifyNoFromSpaceRefsObjectVisitor::ObjectCallback, this);
+  } else {
+    region_space_->WalkToSpace(VerifyNoFromSpaceRefsObjectVisitor::ObjectCallback, this);
+  }
   // Non-moving spaces.
   {
     WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
@@ -902,7 +971,7 @@ class ConcurrentCopying::RevokeThreadLocalMarkStackCheckpoint : public Closure {
     accounting::AtomicStack<mirror::Object>* tl_mark_stack = thread->GetThreadLocalMarkStack();
     if (tl_mark_stack != nullptr) {
       MutexLock mu(self, concurrent_copying_->mark_stack_lock_);
-      concurrent_copying_->revoked_mark_stacks_.push_back(tl_mark_stack);
+      concurrent_copying_->AddRevokedMarkStack(self, tl_mark_stack);
       thread->SetThreadLocalMarkStack(nullptr);
     }
     // Disable weak ref access.
@@ -945,7 +1014,7 @@ void ConcurrentCopying::RevokeThreadLocalMarkStack(Thread* thread) {
   if (tl_mark_stack != nullptr) {
     CHECK(is_marking_);
     MutexLock mu(self, mark_stack_lock_);
-    revoked_mark_stacks_.push_back(tl_mark_stack);
+    AddRevokedMarkStack(self, tl_mark_stack);
     thread->SetThreadLocalMarkStack(nullptr);
   }
 }
@@ -974,13 +1043,18 @@ bool ConcurrentCopying::ProcessMarkStackOnce() {
   MarkStackMode mark_stack_mode = mark_stack_mode_.LoadRelaxed();
   if (mark_stack_mode == kMarkStackModeThreadLocal) {
     // Process the thread-local mark stacks and the GC mark stack.
-    count += ProcessThreadLocalMarkStacks(false);
-    while (!gc_mark_stack_->IsEmpty()) {
-      mirror::Object* to_ref = gc_mark_stack_->PopBack();
-      ProcessMarkStackRef(to_ref);
-      ++count;
+    size_t thread_count = GetParallelMarkThreadCount();
+    if (thread_count > 1) {
+      count += ProcessMarkStackParallel(thread_count);
+    } else {
+      count += ProcessThreadLocalMarkStacks(false);
+      while (!gc_mark_stack_->IsEmpty()) {
+        mirror::Object* to_ref = gc_mark_stack_->PopBack();
+        ProcessMarkStackRef(to_ref);
+        ++count;
+      }
+      gc_mark_stack_->Reset();
     }
-    gc_mark_stack_->Reset();
   } else if (mark_stack_mode == kMarkStackModeShared) {
     // Process the shared GC mark stack with a lock.
     {
@@ -1045,19 +1119,197 @@ size_t ConcurrentCopying::ProcessThreadLocalMarkStacks(bool disable_weak_ref_acc
     }
     {
       MutexLock mu(Thread::Current(), mark_stack_lock_);
-      if (pooled_mark_stacks_.size() >= kMarkStackPoolSize) {
-        // The pool has enough. Delete it.
-        delete mark_stack;
-      } else {
-        // Otherwise, put it into the pool for later reuse.
-        mark_stack->Reset();
-        pooled_mark_stacks_.push_back(mark_stack);
+      RecycleMarkStack(mark_stack);
+    }
+  }
+  return count;
+}
+
+accounting::ObjectStack* ConcurrentCopying::AllocateMarkStack() {
+  accounting::ObjectStack* mark_stack;
+  if (!pooled_mark_stacks_.empty()) {
+    // Use a pooled mark stack.
+    mark_stack = pooled_mark_stacks_.back();
+    pooled_mark_stacks_.pop_back();
+  } else {
+    // None pooled. Create a new one.
+    mark_stack = accounting::ObjectStack::Create("thread local mark stack", 4 * KB, 4 * KB);
+  }
+  DCHECK(mark_stack != nullptr);
+  DCHECK(mark_stack->IsEmpty());
+  return mark_stack;
+}
+
+void ConcurrentCopying::RecycleMarkStack(accounting::ObjectStack* mark_stack) {
+  if (pooled_mark_stacks_.size() >= kMarkStackPoolSize) {
+    // The pool has enough. Delete it.
+    delete mark_stack;
+  } else {
+    // Otherwise, put it into the pool for later reuse.
+    mark_stack->Reset();
+    pooled_mark_stacks_.push_back(mark_stack);
+  }
+}
+
+size_t ConcurrentCopying::GetParallelMarkThreadCount() const {
+  // Like MarkSweep, leave the CPUs to the foreground apps when in the background.
+  ThreadPool* thread_pool = heap_->GetThreadPool();
+  if (thread_pool == nullptr || !Runtime::Current()->InJankPerceptibleProcessState()) {
+    return 0;
+  }
+  return std::min(heap_->GetParallelGCThreadCount(), thread_pool->GetThreadCount());
+}
+
+class ConcurrentCopying::ProcessMarkStackTask : public Task {
+ public:
+  explicit ProcessMarkStackTask(ConcurrentCopying* concurrent_copying)
+      : concurrent_copying_(concurrent_copying) {
+  }
+
+  virtual void Run(Thread* self) OVERRIDE NO_THREAD_SAFETY_ANALYSIS {
+    size_t count = concurrent_copying_->ProcessMarkStackParallelWorker(self);
+    concurrent_copying_->parallel_mark_count_.FetchAndAddSequentiallyConsistent(count);
+  }
+
+  virtual void Finalize() OVERRIDE {
+    delete this;
+  }
+
+ private:
+  ConcurrentCopying* const concurrent_copying_;
+};
+
+// The workers are pool threads, so they push onto thread-local mark stacks like mutators. Full
+// stacks go to revoked_mark_stacks_, where the other workers take them from. Mutators keep adding
+// theirs there too, but the workers don't wait for those. Whatever is left once all workers are
+// idle is processed by the next ProcessMarkStackOnce() call.
+size_t ConcurrentCopying::ProcessMarkStackParallel(size_t thread_count) {
+  TimingLogger::ScopedTiming split("ProcessMarkStackParallel", GetTimings());
+  Thread* self = Thread::Current();
+  // Collect the thread-local mark stacks of all threads, they are the initial work.
+  RevokeThreadLocalMarkStacks(false);
+  size_t initial_count = 0;
+  {
+    MutexLock mu(self, mark_stack_lock_);
+    // Only the GC-running thread may access the GC mark stack, so hand out its refs in chunks.
+    StackReference<mirror::Object>* p = gc_mark_stack_->Begin();
+    while (p != gc_mark_stack_->End()) {
+      accounting::ObjectStack* mark_stack = AllocateMarkStack();
+      while (p != gc_mark_stack_->End() && !mark_stack->IsFull()) {
+        mark_stack->PushBack(p->AsMirrorPtr());
+        ++p;
       }
+      revoked_mark_stacks_.push_back(mark_stack);
+    }
+    gc_mark_stack_->Reset();
+    for (accounting::ObjectStack* mark_stack : revoked_mark_stacks_) {
+      initial_count += mark_stack->Size();
     }
   }
+  if (initial_count < kMinParallelMarkRefs) {
+    // Not worth waking up the workers.
+    return ProcessThreadLocalMarkStacks(false);
+  }
+
+  ThreadPool* thread_pool = heap_->GetThreadPool();
+  parallel_mark_workers_ = thread_count;
+  parallel_mark_idle_workers_.StoreSequentiallyConsistent(0);
+  parallel_mark_count_.StoreSequentiallyConsistent(0);
+  for (size_t i = 0; i < thread_count; ++i) {
+    thread_pool->AddTask(self, new ProcessMarkStackTask(this));
+  }
+  thread_pool->SetMaxActiveWorkers(thread_count);
+  thread_pool->StartWorkers(self);
+  // The GC-running thread pushes onto the GC mark stack, which the workers can't see. So it only
+  // waits rather than doing work.
+  thread_pool->Wait(self, false, true);
+  thread_pool->StopWorkers(self);
+  size_t count = parallel_mark_count_.LoadSequentiallyConsistent();
+  if (kVerboseMode) {
+    LOG(INFO) << "ProcessMarkStackParallel: " << count << " refs with " << thread_count
+              << " threads";
+  }
   return count;
 }
 
+size_t ConcurrentCopying::ProcessMarkStackParallelWorker(Thread* self) {
+  DCHECK_NE(self, thread_running_gc_);
+  size_t count = 0;
+  while (true) {
+    // Refs that this worker pushed, it keeps the thread-local mark stack as long as it has refs.
+    // Pushing may replace a full stack, so look it up again every time.
+    accounting::ObjectStack* tl_mark_stack = self->GetThreadLocalMarkStack();
+    if (tl_mark_stack != nullptr && !tl_mark_stack->IsEmpty()) {
+      if (UNLIKELY(parallel_mark_idle_workers_.LoadRelaxed() != 0 &&
+                   tl_mark_stack->Size() >= kMinSharedMarkStackSize)) {
+        // Share half of the refs with the idle workers.
+        MutexLock mu(self, mark_stack_lock_);
+        accounting::ObjectStack* shared_mark_stack = AllocateMarkStack();
+        for (size_t i = tl_mark_stack->Size() / 2; i != 0; --i) {
+          shared_mark_stack->PushBack(tl_mark_stack->PopBack());
+        }
+        AddRevokedMarkStack(self, shared_mark_stack);
+      }
+      ProcessMarkStackRef(tl_mark_stack->PopBack());
+      ++count;
+      continue;
+    }
+    accounting::ObjectStack* mark_stack = nullptr;
+    {
+      MutexLock mu(self, mark_stack_lock_);
+      if (!revoked_mark_stacks_.empty()) {
+        mark_stack = revoked_mark_stacks_.back();
+        revoked_mark_stacks_.pop_back();
+      }
+    }
+    if (mark_stack != nullptr) {
+      for (StackReference<mirror::Object>* p = mark_stack->Begin(); p != mark_stack->End(); ++p) {
+        ProcessMarkStackRef(p->AsMirrorPtr());
+        ++count;
+      }
+      MutexLock mu(self, mark_stack_lock_);
+      RecycleMarkStack(mark_stack);
+      continue;
+    }
+    if (!WaitForParallelMarkWork(self)) {
+      break;
+    }
+  }
+  // Give back the empty thread-local mark stack, so that the next checkpoint doesn't revoke it.
+  accounting::ObjectStack* tl_mark_stack = self->GetThreadLocalMarkStack();
+  if (tl_mark_stack != nullptr) {
+    DCHECK(tl_mark_stack->IsEmpty());
+    self->SetThreadLocalMarkStack(nullptr);
+    MutexLock mu(self, mark_stack_lock_);
+    RecycleMarkStack(tl_mark_stack);
+  }
+  return count;
+}
+
+bool ConcurrentCopying::WaitForParallelMarkWork(Thread* self) {
+  MutexLock mu(self, mark_stack_lock_);
+  // Idle workers stay counted once they are done, so the count only reaches the number of workers
+  // when all of them are done.
+  parallel_mark_idle_workers_.FetchAndAddSequentiallyConsistent(1);
+  while (true) {
+    if (!revoked_mark_stacks_.empty()) {
+      parallel_mark_idle_workers_.FetchAndSubSequentiallyConsistent(1);
+      return true;
+    }
+    if (parallel_mark_idle_workers_.LoadSequentiallyConsistent() == parallel_mark_workers_) {
+      // Wake up the other idle workers so that they see it too.
+      parallel_mark_cond_.Broadcast(self);
+      return false;
+    }
+    parallel_mark_cond_.Wait(self);
+  }
+}
+
+void ConcurrentCopying::AddRevokedMarkStack(Thread* self, accounting::ObjectStack* mark_stack) {
+  revoked_mark_stacks_.push_back(mark_stack);
+  parallel_mark_cond_.Signal(self);
+}
+
 inline void ConcurrentCopying::ProcessMarkStackRef(mirror::Object* to_ref) {
   DCHECK(!region_space_->IsInFromSpace(to_ref));
   if (kUseBakerReadBarrier) {
@@ -1231,6 +1483,10 @@ class ConcurrentCopying::ClearBlackPtrsVisitor {
       SHARED_REQUIRES(Locks::heap_bitmap_lock_) {
     DCHECK(obj != nullptr);
     DCHECK(collector_->heap_->GetMarkBitmap()->Test(obj)) << obj;
+    if (collector_->young_gen_ && obj->GetReadBarrierPointer() == ReadBarrier::WhitePtr()) {
+      // Survived the previous collection and wasn't marked through.
+      return;
+    }
     DCHECK_EQ(obj->GetReadBarrierPointer(), ReadBarrier::BlackPtr()) << obj;
     obj->AtomicSetReadBarrierPointer(ReadBarrier::BlackPtr(), ReadBarrier::WhitePtr());
     DCHECK_EQ(obj->GetReadBarrierPointer(), ReadBarrier::WhitePtr()) << obj;
@@ -1334,7 +1590,8 @@ void ConcurrentCopying::ReclaimPhase() {
     }
   }
 
-  {
+  if (!young_gen_) {
+    // A young collection has no unevacuated from-space.
     TimingLogger::ScopedTiming split3("ComputeUnevacFromSpaceLiveRatio", GetTimings());
     ComputeUnevacFromSpaceLiveRatio();
   }
@@ -1360,6 +1617,8 @@ void ConcurrentCopying::ReclaimPhase() {
       delete cc_bitmap;
       cc_bitmaps_.pop_back();
     }
+    // The region space bitmap is owned by the region space.
+    cc_heap_bitmap_->RemoveContinuousSpaceBitmap(region_space_bitmap_);
     region_space_bitmap_ = nullptr;
   }
 
@@ -1378,7 +1637,11 @@ class ConcurrentCopying::ComputeUnevacFromSpaceLiveRatioVisitor {
       SHARED_REQUIRES(Locks::heap_bitmap_lock_) {
     DCHECK(ref != nullptr);
     DCHECK(collector_->region_space_bitmap_->Test(ref)) << ref;
-    DCHECK(collector_->region_space_->IsInUnevacFromSpace(ref)) << ref;
+    if (!collector_->region_space_->IsInUnevacFromSpace(ref)) {
+      // A copy in the to-space.
+      DCHECK(collector_->region_space_->IsInToSpace(ref)) << ref;
+      return;
+    }
     if (kUseBakerReadBarrier) {
       DCHECK_EQ(ref->GetReadBarrierPointer(), ReadBarrier::BlackPtr()) << ref;
       // Clear the black ptr.
@@ -1894,6 +2157,10 @@ mirror::Object* ConcurrentCopying::Copy(mirror::Object* from_ref) {
       bytes_moved_.FetchAndAddSequentiallyConsistent(region_space_alloc_size);
       if (LIKELY(!fall_back_to_non_moving)) {
         DCHECK(region_space_->IsInToSpace(to_ref));
+        if (heap_->UseGenerationalConcurrentCopying()) {
+          // Record the promoted object for the young collections.
+          region_space_bitmap_->AtomicTestAndSet(to_ref);
+        }
       } else {
         DCHECK(heap_->non_moving_space_->HasAddress(to_ref));
         DCHECK_EQ(bytes_allocated, non_moving_space_bytes_allocated);
@@ -2018,15 +2285,17 @@ mirror::Object* ConcurrentCopying::MarkNonMoving(mirror::Object* ref) {
     CHECK(los_bitmap != nullptr) << "LOS bitmap covers the entire address range";
     bool is_los = mark_bitmap == nullptr;
     if (!is_los && mark_bitmap->Test(ref)) {
-      // Already marked.
+      // Already marked. Objects that survived the previous collection stay white in a young one.
       if (kUseBakerReadBarrier) {
-        DCHECK(ref->GetReadBarrierPointer() == ReadBarrier::GrayPtr() ||
+        DCHECK(young_gen_ ||
+               ref->GetReadBarrierPointer() == ReadBarrier::GrayPtr() ||
                ref->GetReadBarrierPointer() == ReadBarrier::BlackPtr());
       }
     } else if (is_los && los_bitmap->Test(ref)) {
       // Already marked in LOS.
       if (kUseBakerReadBarrier) {
-        DCHECK(ref->GetReadBarrierPointer() == ReadBarrier::GrayPtr() ||
+        DCHECK(young_gen_ ||
+               ref->GetReadBarrierPointer() == ReadBarrier::GrayPtr() ||
                ref->GetReadBarrierPointer() == ReadBarrier::BlackPtr());
       }
     } else {
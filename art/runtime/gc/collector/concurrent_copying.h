@@ -59,7 +59,7 @@ class ConcurrentCopying : public GarbageCollector {
   // Enable verbose mode.
   static constexpr bool kVerboseMode = false;
 
-  ConcurrentCopying(Heap* heap, const std::string& name_prefix = "");
+  ConcurrentCopying(Heap* heap, bool young_gen, const std::string& name_prefix = "");
   ~ConcurrentCopying();
 
   virtual void RunPhases() OVERRIDE REQUIRES(!mark_stack_lock_, !skipped_blocks_lock_);
@@ -72,7 +72,7 @@ class ConcurrentCopying : public GarbageCollector {
   void BindBitmaps() SHARED_REQUIRES(Locks::mutator_lock_)
       REQUIRES(!Locks::heap_bitmap_lock_);
   virtual GcType GetGcType() const OVERRIDE {
-    return kGcTypePartial;
+    return young_gen_ ? kGcTypeSticky : kGcTypePartial;
   }
   virtual CollectorType GetCollectorType() const OVERRIDE {
     return kCollectorTypeCC;
@@ -138,6 +138,22 @@ class ConcurrentCopying : public GarbageCollector {
       REQUIRES(!mark_stack_lock_);
   size_t ProcessThreadLocalMarkStacks(bool disable_weak_ref_access)
       SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(!mark_stack_lock_);
+  // Returns the number of heap thread pool workers used for marking in the thread-local mark stack
+  // mode, or 0 if the mark stack is processed by the GC-running thread alone.
+  size_t GetParallelMarkThreadCount() const;
+  // Processes the thread-local mark stacks and the GC mark stack with the given number of workers.
+  size_t ProcessMarkStackParallel(size_t thread_count) SHARED_REQUIRES(Locks::mutator_lock_)
+      REQUIRES(!mark_stack_lock_);
+  // Run by each worker of ProcessMarkStackParallel(). Returns the number of processed refs.
+  size_t ProcessMarkStackParallelWorker(Thread* self) SHARED_REQUIRES(Locks::mutator_lock_)
+      REQUIRES(!mark_stack_lock_);
+  // Waits until another worker shares a mark stack. Returns false once all workers are idle.
+  bool WaitForParallelMarkWork(Thread* self) REQUIRES(!mark_stack_lock_);
+  // Adds a full or shared mark stack to revoked_mark_stacks_ and wakes up an idle worker.
+  void AddRevokedMarkStack(Thread* self, accounting::ObjectStack* mark_stack)
+      REQUIRES(mark_stack_lock_);
+  accounting::ObjectStack* AllocateMarkStack() REQUIRES(mark_stack_lock_);
+  void RecycleMarkStack(accounting::ObjectStack* mark_stack) REQUIRES(mark_stack_lock_);
   void RevokeThreadLocalMarkStacks(bool disable_weak_ref_access)
       SHARED_REQUIRES(Locks::mutator_lock_);
   void SwitchToSharedMarkStackMode() SHARED_REQUIRES(Locks::mutator_lock_)
@@ -173,6 +189,10 @@ class ConcurrentCopying : public GarbageCollector {
       SHARED_REQUIRES(Locks::mutator_lock_);
   void FlipThreadRoots() REQUIRES(!Locks::mutator_lock_);
   void SwapStacks() SHARED_REQUIRES(Locks::mutator_lock_);
+  // Gray the objects on dirty cards and the new non-moving objects for a young collection, then
+  // clear the cards. Called during the flip pause.
+  void ProcessCards() REQUIRES(Locks::mutator_lock_)
+      REQUIRES(!mark_stack_lock_, !skipped_blocks_lock_);
   void RecordLiveStackFreezeSize(Thread* self);
   void ComputeUnevacFromSpaceLiveRatio();
   void LogFromSpaceRefHolder(mirror::Object* obj, MemberOffset offset)
@@ -186,16 +206,33 @@ class ConcurrentCopying : public GarbageCollector {
   mirror::Object* MarkNonMoving(mirror::Object* from_ref) SHARED_REQUIRES(Locks::mutator_lock_)
       REQUIRES(!mark_stack_lock_, !skipped_blocks_lock_);
 
+  // True if only the regions allocated since the previous collection are evacuated. The other
+  // regions as well as the objects in the non-moving spaces that survived the previous collection
+  // are considered marked.
+  const bool young_gen_;
   space::RegionSpace* region_space_;      // The underlying region space.
   std::unique_ptr<Barrier> gc_barrier_;
   std::unique_ptr<accounting::ObjectStack> gc_mark_stack_;
   Mutex mark_stack_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   std::vector<accounting::ObjectStack*> revoked_mark_stacks_
       GUARDED_BY(mark_stack_lock_);
+  // Signaled when a stack is added to revoked_mark_stacks_, and broadcast when all parallel mark
+  // workers are idle.
+  ConditionVariable parallel_mark_cond_ GUARDED_BY(mark_stack_lock_);
   static constexpr size_t kMarkStackSize = kPageSize;
   static constexpr size_t kMarkStackPoolSize = 256;
   std::vector<accounting::ObjectStack*> pooled_mark_stacks_
       GUARDED_BY(mark_stack_lock_);
+  // Don't bother the thread pool for less refs than this.
+  static constexpr size_t kMinParallelMarkRefs = 1024;
+  // Workers share half of their thread-local mark stack with idle ones if it has at least this
+  // many refs.
+  static constexpr size_t kMinSharedMarkStackSize = 64;
+  // Number of workers of the ongoing ProcessMarkStackParallel() and how many of them ran out of
+  // refs to process. The idle count is only changed with mark_stack_lock_ held.
+  size_t parallel_mark_workers_;
+  Atomic<size_t> parallel_mark_idle_workers_;
+  Atomic<size_t> parallel_mark_count_;
   Thread* thread_running_gc_;
   bool is_marking_;                       // True while marking is ongoing.
   bool is_active_;                        // True while the collection is ongoing.
@@ -243,9 +280,11 @@ class ConcurrentCopying : public GarbageCollector {
   class ClearBlackPtrsVisitor;
   class ComputeUnevacFromSpaceLiveRatioVisitor;
   class DisableMarkingCheckpoint;
+  class DirtyCardVisitor;
   class FlipCallback;
   class ImmuneSpaceObjVisitor;
   class LostCopyVisitor;
+  class ProcessMarkStackTask;
   class RefFieldsVisitor;
   class RevokeThreadLocalMarkStackCheckpoint;
   class VerifyNoFromSpaceRefsFieldVisitor;
@@ -20,6 +20,7 @@
 #include <functional>
 #include <numeric>
 #include <climits>
+#include <type_traits>
 #include <vector>
 
 #include "base/bounded_fifo.h"
@@ -63,6 +64,11 @@ static constexpr bool kParallelRecursiveMark = true;
 // ProcessMarkStack with very small mark stacks.
 static constexpr size_t kMinimumParallelMarkStackSize = 128;
 static constexpr bool kParallelProcessMarkStack = true;
+static constexpr bool kParallelSweep = true;
+// Spaces smaller than this are swept on the GC thread only.
+static constexpr size_t kMinimumParallelSweepSize = 4 * MB;
+// More tasks than threads, so that a range with much garbage doesn't hold up the others.
+static constexpr size_t kSweepTasksPerThread = 4;
 
 // Profiling and information flags.
 static constexpr bool kProfileLargeObjects = false;
@@ -1301,7 +1307,7 @@ void MarkSweep::Sweep(bool swap_bitmaps) {
       TimingLogger::ScopedTiming split(
           alloc_space->IsZygoteSpace() ? "SweepZygoteSpace" : "SweepMallocSpace",
           GetTimings());
-      RecordFree(alloc_space->Sweep(swap_bitmaps));
+      RecordFree(SweepSpace(alloc_space, swap_bitmaps));
     }
   }
   SweepLargeObjects(swap_bitmaps);
@@ -1311,10 +1317,76 @@ void MarkSweep::SweepLargeObjects(bool swap_bitmaps) {
   space::LargeObjectSpace* los = heap_->GetLargeObjectsSpace();
   if (los != nullptr) {
     TimingLogger::ScopedTiming split(__FUNCTION__, GetTimings());
-    RecordFreeLOS(los->Sweep(swap_bitmaps));
+    RecordFreeLOS(SweepSpace(los, swap_bitmaps));
   }
 }
 
+template <typename SpaceType>
+class MarkSweep::SweepTask : public Task {
+ public:
+  SweepTask(SpaceType* space, bool swap_bitmaps, uintptr_t begin, uintptr_t end,
+            ObjectBytePair* freed)
+      : space_(space), swap_bitmaps_(swap_bitmaps), begin_(begin), end_(end), freed_(freed) {}
+
+  // The GC thread holds the heap bitmap lock for us while it waits for the tasks.
+  virtual void Run(Thread* self ATTRIBUTE_UNUSED) NO_THREAD_SAFETY_ANALYSIS {
+    *freed_ = space_->SweepRange(swap_bitmaps_, begin_, end_);
+  }
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+ private:
+  SpaceType* const space_;
+  const bool swap_bitmaps_;
+  const uintptr_t begin_;
+  const uintptr_t end_;
+  ObjectBytePair* const freed_;
+};
+
+template <typename SpaceType>
+ObjectBytePair MarkSweep::SweepSpace(SpaceType* space, bool swap_bitmaps) {
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(space->Begin());
+  const uintptr_t end = reinterpret_cast<uintptr_t>(space->End());
+  const size_t thread_count = GetThreadCount(!IsConcurrent());
+  if (!kParallelSweep || thread_count <= 1 || end <= begin ||
+      end - begin < kMinimumParallelSweepSize ||
+      space->GetLiveBitmap() == space->GetMarkBitmap()) {
+    return space->Sweep(swap_bitmaps);
+  }
+  // Every range has to start at a bitmap word boundary, otherwise two threads clearing live bits
+  // could race on the same word.
+  using Bitmap = typename std::remove_pointer<decltype(space->GetLiveBitmap())>::type;
+  const uintptr_t heap_begin = space->GetLiveBitmap()->HeapBegin();
+  const uintptr_t word_size = Bitmap::template IndexToOffset<uintptr_t>(1);
+  const uintptr_t chunk_size =
+      RoundUp((end - begin) / (thread_count * kSweepTasksPerThread) + 1, word_size);
+  std::vector<std::pair<uintptr_t, uintptr_t>> ranges;
+  for (uintptr_t range_begin = begin; range_begin < end; ) {
+    const uintptr_t range_end =
+        std::min(heap_begin + RoundDown(range_begin - heap_begin + chunk_size, word_size), end);
+    ranges.emplace_back(range_begin, range_end);
+    range_begin = range_end;
+  }
+  Thread* self = Thread::Current();
+  ThreadPool* thread_pool = GetHeap()->GetThreadPool();
+  std::vector<ObjectBytePair> freed(ranges.size());
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    thread_pool->AddTask(self, new SweepTask<SpaceType>(space, swap_bitmaps, ranges[i].first,
+                                                        ranges[i].second, &freed[i]));
+  }
+  thread_pool->SetMaxActiveWorkers(thread_count - 1);
+  thread_pool->StartWorkers(self);
+  thread_pool->Wait(self, true, true);
+  thread_pool->StopWorkers(self);
+  ObjectBytePair total;
+  for (const ObjectBytePair& range_freed : freed) {
+    total.Add(range_freed);
+  }
+  return total;
+}
+
 // Process the "referent" field in a java.lang.ref.Reference.  If the referent has not yet been
 // marked, put it on the appropriate list in the heap for later processing.
 void MarkSweep::DelayReferenceReferent(mirror::Class* klass, mirror::Reference* ref) {
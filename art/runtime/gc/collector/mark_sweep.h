@@ -154,6 +154,12 @@ class MarkSweep : public GarbageCollector {
   // Sweeps unmarked objects to complete the garbage collection.
   void SweepLargeObjects(bool swap_bitmaps) REQUIRES(Locks::heap_bitmap_lock_);
 
+  // Sweeps a malloc, zygote or large object space, splitting it into bitmap ranges that are swept
+  // on the GC thread pool if the space is large enough.
+  template <typename SpaceType>
+  ObjectBytePair SweepSpace(SpaceType* space, bool swap_bitmaps)
+      REQUIRES(Locks::heap_bitmap_lock_);
+
   // Sweep only pointers within an array. WARNING: Trashes objects.
   void SweepArray(accounting::ObjectStack* allocation_stack_, bool swap_bitmaps)
       REQUIRES(Locks::heap_bitmap_lock_)
@@ -361,6 +367,7 @@ class MarkSweep : public GarbageCollector {
   class RecursiveMarkTask;
   class ScanObjectParallelVisitor;
   class ScanObjectVisitor;
+  template <typename SpaceType> class SweepTask;
   class VerifyRootMarkedVisitor;
   class VerifyRootVisitor;
   class VerifySystemWeakVisitor;
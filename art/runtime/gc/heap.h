@@ -182,6 +182,7 @@ class Heap {
        bool verify_pre_sweeping_rosalloc,
        bool verify_post_gc_rosalloc,
        bool gc_stress_mode,
+       bool use_generational_cc,
        bool use_homogeneous_space_compaction,
        uint64_t min_interval_homogeneous_space_compaction_by_oom);
 
@@ -690,12 +691,18 @@ class Heap {
     return task_processor_.get();
   }
 
+  bool UseGenerationalConcurrentCopying() const {
+    return use_generational_cc_;
+  }
+
   bool HasZygoteSpace() const {
     return zygote_space_ != nullptr;
   }
 
+  // Returns the concurrent copying collector that runs or ran last, i.e. either the full or the
+  // young-generation one.
   collector::ConcurrentCopying* ConcurrentCopyingCollector() {
-    return concurrent_copying_collector_;
+    return active_concurrent_copying_collector_;
   }
 
   CollectorType CurrentCollectorType() {
@@ -1183,6 +1190,8 @@ class Heap {
   bool verify_pre_sweeping_rosalloc_;
   bool verify_post_gc_rosalloc_;
   const bool gc_stress_mode_;
+  // Whether the concurrent copying collector also runs young-generation collections.
+  const bool use_generational_cc_;
 
   // RAII that temporarily disables the rosalloc verification during
   // the zygote fork.
@@ -1272,6 +1281,10 @@ class Heap {
   collector::SemiSpace* semi_space_collector_;
   collector::MarkCompact* mark_compact_collector_;
   collector::ConcurrentCopying* concurrent_copying_collector_;
+  // Collects only the regions allocated since the previous collection, null if generational
+  // collection is disabled.
+  collector::ConcurrentCopying* young_concurrent_copying_collector_;
+  collector::ConcurrentCopying* active_concurrent_copying_collector_;
 
   const bool is_running_on_memory_tool_;
   const bool use_tlab_;
@@ -1350,6 +1363,7 @@ class Heap {
   std::vector<space::ImageSpace*> boot_image_spaces_;
 
   friend class CollectorTransitionTask;
+  friend class GenerationalConcurrentCopyingTest;  // For CollectGarbageInternal.
   friend class collector::GarbageCollector;
   friend class collector::MarkCompact;
   friend class collector::ConcurrentCopying;
@@ -14,14 +14,17 @@
  * limitations under the License.
  */
 
+#include "base/stringprintf.h"
 #include "class_linker-inl.h"
 #include "common_runtime_test.h"
+#include "gc/collector/concurrent_copying.h"
 #include "gc/accounting/card_table-inl.h"
 #include "gc/accounting/space_bitmap-inl.h"
 #include "handle_scope-inl.h"
 #include "mirror/class-inl.h"
 #include "mirror/object-inl.h"
 #include "mirror/object_array-inl.h"
+#include "mirror/string-inl.h"
 #include "scoped_thread_state_change.h"
 
 namespace art {
@@ -84,5 +87,75 @@ TEST_F(ZygoteHeapTest, PreZygoteFork) {
   Runtime::Current()->GetHeap()->PreZygoteFork();
 }
 
+class GenerationalConcurrentCopyingTest : public CommonRuntimeTest {
+ protected:
+  void SetUpRuntimeOptions(RuntimeOptions* options) OVERRIDE {
+    CommonRuntimeTest::SetUpRuntimeOptions(options);
+    options->push_back(std::make_pair("-Xgc:generational_cc", nullptr));
+  }
+
+  // Runs a young collection, or whatever the heap runs instead.
+  collector::GcType CollectYoungGarbage(Thread* self) {
+    ScopedThreadSuspension sts(self, kSuspended);
+    return Runtime::Current()->GetHeap()->CollectGarbageInternal(collector::kGcTypeSticky,
+                                                                 kGcCauseExplicit,
+                                                                 false);
+  }
+
+  void CollectFullGarbage(Thread* self) {
+    ScopedThreadSuspension sts(self, kSuspended);
+    Runtime::Current()->GetHeap()->CollectGarbage(false);
+  }
+};
+
+// Young objects which are only referenced from old ones must survive young collections. Every
+// concurrent copying cycle also verifies that no references to the from-space are left, see
+// ConcurrentCopying::kEnableNoFromSpaceRefsVerification.
+TEST_F(GenerationalConcurrentCopyingTest, YoungCollections) {
+  Heap* heap = Runtime::Current()->GetHeap();
+  if (heap->CurrentCollectorType() != kCollectorTypeCC) {
+    // Concurrent copying needs read barriers, which are a build-time decision.
+    return;
+  }
+  ASSERT_TRUE(heap->UseGenerationalConcurrentCopying());
+
+  static constexpr size_t kLength = 1024;
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<2> hs(soa.Self());
+  Handle<mirror::Class> c(
+      hs.NewHandle(class_linker_->FindSystemClass(soa.Self(), "[Ljava/lang/Object;")));
+  Handle<mirror::ObjectArray<mirror::Object>> old_array(
+      hs.NewHandle(mirror::ObjectArray<mirror::Object>::Alloc(soa.Self(), c.Get(), kLength)));
+  ASSERT_TRUE(old_array.Get() != nullptr);
+  // Promote the array.
+  CollectFullGarbage(soa.Self());
+
+  for (size_t round = 0; round < 4; ++round) {
+    // Only the old array refers to the new strings, through dirty cards.
+    for (size_t i = 0; i < kLength; ++i) {
+      std::string value = StringPrintf("%zu.%zu", round, i);
+      mirror::String* string = mirror::String::AllocFromModifiedUtf8(soa.Self(), value.c_str());
+      ASSERT_TRUE(string != nullptr);
+      old_array->Set<false>(i, string);
+    }
+
+    EXPECT_EQ(collector::kGcTypeSticky, CollectYoungGarbage(soa.Self()));
+    EXPECT_EQ(collector::kGcTypeSticky, heap->ConcurrentCopyingCollector()->GetGcType());
+
+    for (size_t i = 0; i < kLength; ++i) {
+      mirror::Object* string = old_array->Get(i);
+      ASSERT_TRUE(string != nullptr);
+      ASSERT_TRUE(string->IsString());
+      EXPECT_EQ(StringPrintf("%zu.%zu", round, i), string->AsString()->ToModifiedUtf8());
+    }
+  }
+
+  // A full collection after young ones must not lose anything either.
+  CollectFullGarbage(soa.Self());
+  for (size_t i = 0; i < kLength; ++i) {
+    EXPECT_EQ(StringPrintf("3.%zu", i), old_array->Get(i)->AsString()->ToModifiedUtf8());
+  }
+}
+
 }  // namespace gc
 }  // namespace art
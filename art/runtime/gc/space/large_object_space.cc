@@ -81,6 +81,11 @@ class MemoryToolLargeObjectMapSpace FINAL : public LargeObjectMapSpace {
     return LargeObjectMapSpace::Free(self, object_with_rdz);
   }
 
+  size_t FreeList(Thread* self, size_t num_ptrs, mirror::Object** ptrs) OVERRIDE {
+    // Free one by one to handle the red zones.
+    return LargeObjectSpace::FreeList(self, num_ptrs, ptrs);
+  }
+
   bool Contains(const mirror::Object* obj) const OVERRIDE {
     return LargeObjectMapSpace::Contains(ObjectWithRedzone(obj));
   }
@@ -206,6 +211,35 @@ size_t LargeObjectMapSpace::Free(Thread* self, mirror::Object* ptr) {
   return allocation_size;
 }
 
+size_t LargeObjectMapSpace::FreeList(Thread* self, size_t num_ptrs, mirror::Object** ptrs) {
+  // Remove the whole batch from the map with a single lock acquisition, then unmap the objects
+  // without holding the lock so that other sweeping threads can update the map in the meantime.
+  std::vector<MemMap*> mem_maps;
+  mem_maps.reserve(num_ptrs);
+  size_t freed_bytes = 0;
+  {
+    MutexLock mu(self, lock_);
+    for (size_t i = 0; i < num_ptrs; ++i) {
+      auto it = large_objects_.find(ptrs[i]);
+      if (UNLIKELY(it == large_objects_.end())) {
+        ScopedObjectAccess soa(self);
+        Runtime::Current()->GetHeap()->DumpSpaces(LOG(INTERNAL_FATAL));
+        LOG(FATAL) << "Attempted to free large object " << ptrs[i] << " which was not live";
+      }
+      MemMap* mem_map = it->second.mem_map;
+      freed_bytes += mem_map->BaseSize();
+      mem_maps.push_back(mem_map);
+      large_objects_.erase(it);
+    }
+    DCHECK_GE(num_bytes_allocated_, freed_bytes);
+    DCHECK_GE(num_objects_allocated_, num_ptrs);
+    num_bytes_allocated_ -= freed_bytes;
+    num_objects_allocated_ -= num_ptrs;
+  }
+  STLDeleteElements(&mem_maps);
+  return freed_bytes;
+}
+
 size_t LargeObjectMapSpace::AllocationSize(mirror::Object* obj, size_t* usable_size) {
   MutexLock mu(Thread::Current(), lock_);
   auto it = large_objects_.find(obj);
@@ -251,11 +285,15 @@ bool LargeObjectMapSpace::Contains(const mirror::Object* obj) const {
 // Keeps track of allocation sizes + whether or not the previous allocation is free.
 // Used to coalesce free blocks and find the best fit block for an allocation for best fit object
 // allocation. Each allocation has an AllocationInfo which contains the size of the previous free
-// block preceding it. Implemented in such a way that we can also find the iterator for any
-// allocation info pointer.
+// block preceding it, and if there is one, links it into the list of free blocks of its size
+// class.
 class AllocationInfo {
  public:
-  AllocationInfo() : prev_free_(0), alloc_size_(0) {
+  AllocationInfo()
+      : prev_free_(0),
+        alloc_size_(0),
+        prev_free_block_(FreeListSpace::kNoFreeBlock),
+        next_free_block_(FreeListSpace::kNoFreeBlock) {
   }
   // Return the number of pages that the allocation info covers.
   size_t AlignSize() const {
@@ -315,6 +353,20 @@ class AllocationInfo {
     DCHECK_ALIGNED(bytes, FreeListSpace::kAlignment);
     prev_free_ = bytes / FreeListSpace::kAlignment;
   }
+  // Slots of the neighbours in the list of free blocks of the same class, only valid if the
+  // block before us is free.
+  uint32_t GetPrevFreeBlock() const {
+    return prev_free_block_;
+  }
+  uint32_t GetNextFreeBlock() const {
+    return next_free_block_;
+  }
+  void SetPrevFreeBlock(uint32_t slot) {
+    prev_free_block_ = slot;
+  }
+  void SetNextFreeBlock(uint32_t slot) {
+    next_free_block_ = slot;
+  }
 
  private:
   static constexpr uint32_t kFlagFree = 0x80000000;  // If block is free.
@@ -326,6 +378,8 @@ class AllocationInfo {
   uint32_t prev_free_;
   // Allocation size of this object in kAlignment as the unit.
   uint32_t alloc_size_;
+  uint32_t prev_free_block_;
+  uint32_t next_free_block_;
 };
 
 size_t FreeListSpace::GetSlotIndexForAllocationInfo(const AllocationInfo* info) const {
@@ -342,13 +396,102 @@ const AllocationInfo* FreeListSpace::GetAllocationInfoForAddress(uintptr_t addre
   return &allocation_info_[GetSlotIndexForAddress(address)];
 }
 
-inline bool FreeListSpace::SortByPrevFree::operator()(const AllocationInfo* a,
-                                                      const AllocationInfo* b) const {
-  if (a->GetPrevFree() < b->GetPrevFree()) return true;
-  if (a->GetPrevFree() > b->GetPrevFree()) return false;
-  if (a->AlignSize() < b->AlignSize()) return true;
-  if (a->AlignSize() > b->AlignSize()) return false;
-  return reinterpret_cast<uintptr_t>(a) < reinterpret_cast<uintptr_t>(b);
+size_t FreeListSpace::FreeClassForPages(size_t pages) {
+  DCHECK_GT(pages, 0U);
+  if (pages < kNumLinearFreeClasses) {
+    return pages;
+  }
+  // The power of two and the next bits below it select the class.
+  const size_t power = MostSignificantBit(pages);
+  const size_t sub_class =
+      (pages >> (power - kFreeClassesPerPowerOfTwoBits)) & (kFreeClassesPerPowerOfTwo - 1);
+  return kNumLinearFreeClasses + (power - kLinearFreeClassesBits) * kFreeClassesPerPowerOfTwo +
+      sub_class;
+}
+
+size_t FreeListSpace::FreeClassForRequest(size_t pages) {
+  if (pages < kNumLinearFreeClasses) {
+    return pages;
+  }
+  // Round up to the smallest size of the next class, unless pages is the smallest of its own.
+  const size_t power = MostSignificantBit(pages);
+  const size_t class_pages = static_cast<size_t>(1) << (power - kFreeClassesPerPowerOfTwoBits);
+  return std::min(FreeClassForPages(pages + class_pages - 1), kNumFreeClasses);
+}
+
+void FreeListSpace::AddFreeBlock(AllocationInfo* info) {
+  DCHECK_GT(info->GetPrevFree(), 0U);
+  const size_t free_class = FreeClassForPages(info->GetPrevFree());
+  const uint32_t slot = GetSlotIndexForAllocationInfo(info);
+  const uint32_t head = free_class_heads_[free_class];
+  info->SetPrevFreeBlock(kNoFreeBlock);
+  info->SetNextFreeBlock(head);
+  if (head != kNoFreeBlock) {
+    allocation_info_[head].SetPrevFreeBlock(slot);
+  } else {
+    const size_t word = free_class / 64;
+    non_empty_free_classes_[word] |= UINT64_C(1) << (free_class % 64);
+    non_empty_free_class_words_ |= 1u << word;
+  }
+  free_class_heads_[free_class] = slot;
+}
+
+void FreeListSpace::RemoveFreeBlock(AllocationInfo* info) {
+  CHECK_GT(info->GetPrevFree(), 0U);
+  const size_t free_class = FreeClassForPages(info->GetPrevFree());
+  const uint32_t prev = info->GetPrevFreeBlock();
+  const uint32_t next = info->GetNextFreeBlock();
+  if (prev != kNoFreeBlock) {
+    allocation_info_[prev].SetNextFreeBlock(next);
+  } else {
+    CHECK_EQ(free_class_heads_[free_class], GetSlotIndexForAllocationInfo(info));
+    free_class_heads_[free_class] = next;
+    if (next == kNoFreeBlock) {
+      const size_t word = free_class / 64;
+      non_empty_free_classes_[word] &= ~(UINT64_C(1) << (free_class % 64));
+      if (non_empty_free_classes_[word] == 0) {
+        non_empty_free_class_words_ &= ~(1u << word);
+      }
+    }
+  }
+  if (next != kNoFreeBlock) {
+    allocation_info_[next].SetPrevFreeBlock(prev);
+  }
+}
+
+size_t FreeListSpace::FindNonEmptyFreeClass(size_t first_class) const {
+  if (first_class >= kNumFreeClasses) {
+    return kNumFreeClasses;
+  }
+  size_t word = first_class / 64;
+  uint64_t classes = non_empty_free_classes_[word] & (~UINT64_C(0) << (first_class % 64));
+  if (classes == 0) {
+    const uint32_t words = non_empty_free_class_words_ & ~((2u << word) - 1);
+    if (words == 0) {
+      return kNumFreeClasses;
+    }
+    word = CTZ(words);
+    classes = non_empty_free_classes_[word];
+  }
+  return word * 64 + CTZ(classes);
+}
+
+AllocationInfo* FreeListSpace::FindFreeBlock(size_t pages) {
+  const size_t request_class = FreeClassForRequest(pages);
+  const size_t pages_class = FreeClassForPages(pages);
+  if (request_class != pages_class) {
+    // The class of the request may have blocks that are large enough, which are a closer fit
+    // than those of the larger classes. Only check the first to stay O(1).
+    const uint32_t head = free_class_heads_[pages_class];
+    if (head != kNoFreeBlock && allocation_info_[head].GetPrevFree() >= pages) {
+      return &allocation_info_[head];
+    }
+  }
+  const size_t free_class = FindNonEmptyFreeClass(request_class);
+  if (free_class == kNumFreeClasses) {
+    return nullptr;
+  }
+  return &allocation_info_[free_class_heads_[free_class]];
 }
 
 FreeListSpace* FreeListSpace::Create(const std::string& name, uint8_t* requested_begin, size_t size) {
@@ -376,6 +519,9 @@ FreeListSpace::FreeListSpace(const std::string& name, MemMap* mem_map, uint8_t*
   CHECK(allocation_info_map_.get() != nullptr) << "Failed to allocate allocation info map"
       << error_msg;
   allocation_info_ = reinterpret_cast<AllocationInfo*>(allocation_info_map_->Begin());
+  std::fill_n(free_class_heads_, kNumFreeClasses, kNoFreeBlock);
+  std::fill_n(non_empty_free_classes_, kNumFreeClassWords, 0);
+  non_empty_free_class_words_ = 0;
 }
 
 FreeListSpace::~FreeListSpace() {}
@@ -398,24 +544,42 @@ void FreeListSpace::Walk(DlMallocSpace::WalkCallback callback, void* arg) {
   CHECK_EQ(cur_info, end_info);
 }
 
-void FreeListSpace::RemoveFreePrev(AllocationInfo* info) {
-  CHECK_GT(info->GetPrevFree(), 0U);
-  auto it = free_blocks_.lower_bound(info);
-  CHECK(it != free_blocks_.end());
-  CHECK_EQ(*it, info);
-  free_blocks_.erase(it);
+size_t FreeListSpace::Free(Thread* self, mirror::Object* obj) {
+  return FreeList(self, 1, &obj);
 }
 
-size_t FreeListSpace::Free(Thread* self, mirror::Object* obj) {
+size_t FreeListSpace::FreeList(Thread* self, size_t num_ptrs, mirror::Object** ptrs) {
+  // The sizes of allocated objects don't change and the memory can't be reused before it is added
+  // to the free blocks below, so it can be released without the lock.
+  size_t freed_bytes = 0;
+  for (size_t i = 0; i < num_ptrs; ++i) {
+    mirror::Object* obj = ptrs[i];
+    DCHECK(Contains(obj)) << reinterpret_cast<void*>(Begin()) << " " << obj << " "
+                          << reinterpret_cast<void*>(End());
+    DCHECK_ALIGNED(obj, kAlignment);
+    const AllocationInfo* info = GetAllocationInfoForAddress(reinterpret_cast<uintptr_t>(obj));
+    DCHECK(!info->IsFree());
+    const size_t allocation_size = info->ByteSize();
+    DCHECK_GT(allocation_size, 0U);
+    DCHECK_ALIGNED(allocation_size, kAlignment);
+    madvise(obj, allocation_size, MADV_DONTNEED);
+    if (kIsDebugBuild) {
+      // Can't disallow reads since we use them to find next chunks during coalescing.
+      mprotect(obj, allocation_size, PROT_READ);
+    }
+    freed_bytes += allocation_size;
+  }
   MutexLock mu(self, lock_);
-  DCHECK(Contains(obj)) << reinterpret_cast<void*>(Begin()) << " " << obj << " "
-                        << reinterpret_cast<void*>(End());
-  DCHECK_ALIGNED(obj, kAlignment);
+  for (size_t i = 0; i < num_ptrs; ++i) {
+    FreeLocked(ptrs[i]);
+  }
+  return freed_bytes;
+}
+
+void FreeListSpace::FreeLocked(mirror::Object* obj) {
   AllocationInfo* info = GetAllocationInfoForAddress(reinterpret_cast<uintptr_t>(obj));
   DCHECK(!info->IsFree());
   const size_t allocation_size = info->ByteSize();
-  DCHECK_GT(allocation_size, 0U);
-  DCHECK_ALIGNED(allocation_size, kAlignment);
   info->SetByteSize(allocation_size, true);  // Mark as free.
   // Look at the next chunk.
   AllocationInfo* next_info = info->GetNextInfo();
@@ -426,7 +590,7 @@ size_t FreeListSpace::Free(Thread* self, mirror::Object* obj) {
   if (prev_free_bytes != 0) {
     // Coalesce with previous free chunk.
     new_free_size += prev_free_bytes;
-    RemoveFreePrev(info);
+    RemoveFreeBlock(info);
     info = info->GetPrevFreeInfo();
     // The previous allocation info must not be free since we are supposed to always coalesce.
     DCHECK_EQ(info->GetPrevFreeBytes(), 0U) << "Previous allocation was free";
@@ -445,24 +609,18 @@ size_t FreeListSpace::Free(Thread* self, mirror::Object* obj) {
       DCHECK_ALIGNED(next_next_info->ByteSize(), kAlignment);
       new_free_info = next_next_info;
       new_free_size += next_next_info->GetPrevFreeBytes();
-      RemoveFreePrev(next_next_info);
+      RemoveFreeBlock(next_next_info);
     } else {
       new_free_info = next_info;
     }
     new_free_info->SetPrevFreeBytes(new_free_size);
-    free_blocks_.insert(new_free_info);
+    AddFreeBlock(new_free_info);
     info->SetByteSize(new_free_size, true);
     DCHECK_EQ(info->GetNextInfo(), new_free_info);
   }
   --num_objects_allocated_;
   DCHECK_LE(allocation_size, num_bytes_allocated_);
   num_bytes_allocated_ -= allocation_size;
-  madvise(obj, allocation_size, MADV_DONTNEED);
-  if (kIsDebugBuild) {
-    // Can't disallow reads since we use them to find next chunks during coalescing.
-    mprotect(obj, allocation_size, PROT_READ);
-  }
-  return allocation_size;
 }
 
 size_t FreeListSpace::AllocationSize(mirror::Object* obj, size_t* usable_size) {
@@ -480,15 +638,11 @@ mirror::Object* FreeListSpace::Alloc(Thread* self, size_t num_bytes, size_t* byt
                                      size_t* usable_size, size_t* bytes_tl_bulk_allocated) {
   MutexLock mu(self, lock_);
   const size_t allocation_size = RoundUp(num_bytes, kAlignment);
-  AllocationInfo temp_info;
-  temp_info.SetPrevFreeBytes(allocation_size);
-  temp_info.SetByteSize(0, false);
   AllocationInfo* new_info;
-  // Find the smallest chunk at least num_bytes in size.
-  auto it = free_blocks_.lower_bound(&temp_info);
-  if (it != free_blocks_.end()) {
-    AllocationInfo* info = *it;
-    free_blocks_.erase(it);
+  // Find a chunk at least num_bytes in size, the smallest one up to the size class granularity.
+  AllocationInfo* info = FindFreeBlock(allocation_size / kAlignment);
+  if (info != nullptr) {
+    RemoveFreeBlock(info);
     // Fit our object in the previous allocation info free space.
     new_info = info->GetPrevFreeInfo();
     // Remove the newly allocated block from the info and update the prev_free_.
@@ -497,8 +651,8 @@ mirror::Object* FreeListSpace::Alloc(Thread* self, size_t num_bytes, size_t* byt
       AllocationInfo* new_free = info - info->GetPrevFree();
       new_free->SetPrevFreeBytes(0);
       new_free->SetByteSize(info->GetPrevFreeBytes(), true);
-      // If there is remaining space, insert back into the free set.
-      free_blocks_.insert(info);
+      // If there is remaining space, insert back into the free blocks.
+      AddFreeBlock(info);
     }
   } else {
     // Try to steal some memory from the free space at the end of the space.
@@ -582,7 +736,6 @@ void LargeObjectSpace::SweepCallback(size_t num_ptrs, mirror::Object** ptrs, voi
   SweepCallbackContext* context = static_cast<SweepCallbackContext*>(arg);
   space::LargeObjectSpace* space = context->space->AsLargeObjectSpace();
   Thread* self = context->self;
-  Locks::heap_bitmap_lock_->AssertExclusiveHeld(self);
   // If the bitmaps aren't swapped we need to clear the bits since the GC isn't going to re-swap
   // the bitmaps as an optimization.
   if (!context->swap_bitmaps) {
@@ -596,7 +749,15 @@ void LargeObjectSpace::SweepCallback(size_t num_ptrs, mirror::Object** ptrs, voi
 }
 
 collector::ObjectBytePair LargeObjectSpace::Sweep(bool swap_bitmaps) {
-  if (Begin() >= End()) {
+  Locks::heap_bitmap_lock_->AssertExclusiveHeld(Thread::Current());
+  return SweepRange(swap_bitmaps, reinterpret_cast<uintptr_t>(Begin()),
+                    reinterpret_cast<uintptr_t>(End()));
+}
+
+collector::ObjectBytePair LargeObjectSpace::SweepRange(bool swap_bitmaps,
+                                                       uintptr_t sweep_begin,
+                                                       uintptr_t sweep_end) {
+  if (sweep_begin >= sweep_end) {
     return collector::ObjectBytePair(0, 0);
   }
   accounting::LargeObjectBitmap* live_bitmap = GetLiveBitmap();
@@ -605,9 +766,8 @@ collector::ObjectBytePair LargeObjectSpace::Sweep(bool swap_bitmaps) {
     std::swap(live_bitmap, mark_bitmap);
   }
   AllocSpace::SweepCallbackContext scc(swap_bitmaps, this);
-  accounting::LargeObjectBitmap::SweepWalk(*live_bitmap, *mark_bitmap,
-                                           reinterpret_cast<uintptr_t>(Begin()),
-                                           reinterpret_cast<uintptr_t>(End()), SweepCallback, &scc);
+  accounting::LargeObjectBitmap::SweepWalk(*live_bitmap, *mark_bitmap, sweep_begin, sweep_end,
+                                           SweepCallback, &scc);
   return scc.freed;
 }
 
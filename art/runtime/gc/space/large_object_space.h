@@ -22,7 +22,6 @@
 #include "safe_map.h"
 #include "space.h"
 
-#include <set>
 #include <vector>
 
 namespace art {
@@ -75,6 +74,10 @@ class LargeObjectSpace : public DiscontinuousSpace, public AllocSpace {
     return this;
   }
   collector::ObjectBytePair Sweep(bool swap_bitmaps);
+  // Sweeps the objects in [sweep_begin, sweep_end), which has to start and end at bitmap word
+  // boundaries. Disjoint ranges can be swept concurrently, see ContinuousMemMapAllocSpace.
+  collector::ObjectBytePair SweepRange(bool swap_bitmaps, uintptr_t sweep_begin,
+                                       uintptr_t sweep_end);
   virtual bool CanMoveObjects() const OVERRIDE {
     return false;
   }
@@ -135,6 +138,7 @@ class LargeObjectMapSpace : public LargeObjectSpace {
                         size_t* usable_size, size_t* bytes_tl_bulk_allocated)
       REQUIRES(!lock_);
   size_t Free(Thread* self, mirror::Object* ptr) REQUIRES(!lock_);
+  size_t FreeList(Thread* self, size_t num_ptrs, mirror::Object** ptrs) OVERRIDE REQUIRES(!lock_);
   void Walk(DlMallocSpace::WalkCallback, void* arg) OVERRIDE REQUIRES(!lock_);
   // TODO: disabling thread safety analysis as this may be called when we already hold lock_.
   bool Contains(const mirror::Object* obj) const NO_THREAD_SAFETY_ANALYSIS;
@@ -160,6 +164,8 @@ class LargeObjectMapSpace : public LargeObjectSpace {
 class FreeListSpace FINAL : public LargeObjectSpace {
  public:
   static constexpr size_t kAlignment = kPageSize;
+  // Slot index that ends the lists of free blocks.
+  static constexpr uint32_t kNoFreeBlock = 0xFFFFFFFF;
 
   virtual ~FreeListSpace();
   static FreeListSpace* Create(const std::string& name, uint8_t* requested_begin, size_t capacity);
@@ -169,6 +175,10 @@ class FreeListSpace FINAL : public LargeObjectSpace {
                         size_t* usable_size, size_t* bytes_tl_bulk_allocated)
       OVERRIDE REQUIRES(!lock_);
   size_t Free(Thread* self, mirror::Object* obj) OVERRIDE REQUIRES(!lock_);
+  // Releases the memory of the objects before taking the lock once for the whole batch, so that
+  // threads sweeping different ranges mostly don't wait for each other.
+  size_t FreeList(Thread* self, size_t num_ptrs, mirror::Object** ptrs) OVERRIDE
+      REQUIRES(!lock_);
   void Walk(DlMallocSpace::WalkCallback callback, void* arg) OVERRIDE REQUIRES(!lock_);
   void Dump(std::ostream& os) const REQUIRES(!lock_);
 
@@ -187,17 +197,36 @@ class FreeListSpace FINAL : public LargeObjectSpace {
   uintptr_t GetAddressForAllocationInfo(const AllocationInfo* info) const {
     return GetAllocationAddressForSlot(GetSlotIndexForAllocationInfo(info));
   }
-  // Removes header from the free blocks set by finding the corresponding iterator and erasing it.
-  void RemoveFreePrev(AllocationInfo* info) REQUIRES(lock_);
+  // Frees an object whose memory has already been released.
+  void FreeLocked(mirror::Object* obj) REQUIRES(lock_);
   bool IsZygoteLargeObject(Thread* self, mirror::Object* obj) const OVERRIDE;
   void SetAllLargeObjectsAsZygoteObjects(Thread* self) OVERRIDE REQUIRES(!lock_);
 
-  class SortByPrevFree {
-   public:
-    bool operator()(const AllocationInfo* a, const AllocationInfo* b) const;
-  };
-  typedef std::set<AllocationInfo*, SortByPrevFree,
-                   TrackingAllocator<AllocationInfo*, kAllocatorTagLOSFreeList>> FreeBlocks;
+  // Free blocks are segregated into size classes by the number of pages: one class for every
+  // size below kNumLinearFreeClasses pages, then kFreeClassesPerPowerOfTwo classes for every
+  // power of two. A free block is represented by the allocation info that follows it, which
+  // links it into the list of its class.
+  static constexpr size_t kLinearFreeClassesBits = 4;
+  static constexpr size_t kNumLinearFreeClasses = 1u << kLinearFreeClassesBits;
+  static constexpr size_t kFreeClassesPerPowerOfTwoBits = 3;
+  static constexpr size_t kFreeClassesPerPowerOfTwo = 1u << kFreeClassesPerPowerOfTwoBits;
+  // Enough classes for the 30 bits of pages in AllocationInfo.
+  static constexpr size_t kNumFreeClasses = kNumLinearFreeClasses +
+      (30 - kLinearFreeClassesBits) * kFreeClassesPerPowerOfTwo;
+  static constexpr size_t kNumFreeClassWords = RoundUp(kNumFreeClasses, 64) / 64;
+
+  // Returns the class of free blocks of the given number of pages.
+  static size_t FreeClassForPages(size_t pages);
+  // Returns the first class whose free blocks all have at least the given number of pages, or
+  // kNumFreeClasses.
+  static size_t FreeClassForRequest(size_t pages);
+  // Adds and removes the free block preceding info to / from the index.
+  void AddFreeBlock(AllocationInfo* info) REQUIRES(lock_);
+  void RemoveFreeBlock(AllocationInfo* info) REQUIRES(lock_);
+  // Returns a free block of at least the given number of pages, or null.
+  AllocationInfo* FindFreeBlock(size_t pages) REQUIRES(lock_);
+  // Returns the first class that isn't empty starting at the given one, or kNumFreeClasses.
+  size_t FindNonEmptyFreeClass(size_t first_class) const REQUIRES(lock_);
 
   // There is not footer for any allocations at the end of the space, so we keep track of how much
   // free space there is at the end manually.
@@ -209,7 +238,11 @@ class FreeListSpace FINAL : public LargeObjectSpace {
   mutable Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   // Free bytes at the end of the space.
   size_t free_end_ GUARDED_BY(lock_);
-  FreeBlocks free_blocks_ GUARDED_BY(lock_);
+  // Slot of the allocation info of the first free block in every class, or kNoFreeBlock.
+  uint32_t free_class_heads_[kNumFreeClasses] GUARDED_BY(lock_);
+  // A bit for every class with free blocks, and a summary bit for every word of them.
+  uint64_t non_empty_free_classes_[kNumFreeClassWords] GUARDED_BY(lock_);
+  uint32_t non_empty_free_class_words_ GUARDED_BY(lock_);
 };
 
 }  // namespace space
@@ -15,6 +15,7 @@
  */
 
 #include "base/time_utils.h"
+#include "gc/accounting/space_bitmap-inl.h"
 #include "space_test.h"
 #include "large_object_space.h"
 
@@ -29,6 +30,10 @@ class LargeObjectSpaceTest : public SpaceTest<CommonRuntimeTest> {
   static constexpr size_t kNumThreads = 10;
   static constexpr size_t kNumIterations = 1000;
   void RaceTest();
+
+  void SweepRangeTest();
+
+  void FreeListBestFitTest();
 };
 
 
@@ -164,6 +169,133 @@ void LargeObjectSpaceTest::RaceTest() {
   }
 }
 
+class SweepRangeTask : public Task {
+ public:
+  SweepRangeTask(LargeObjectSpace* los, uintptr_t begin, uintptr_t end,
+                 collector::ObjectBytePair* freed)
+      : los_(los), begin_(begin), end_(end), freed_(freed) {}
+
+  void Run(Thread* self ATTRIBUTE_UNUSED) {
+    *freed_ = los_->SweepRange(false, begin_, end_);
+  }
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+ private:
+  LargeObjectSpace* const los_;
+  const uintptr_t begin_;
+  const uintptr_t end_;
+  collector::ObjectBytePair* const freed_;
+};
+
+void LargeObjectSpaceTest::SweepRangeTest() {
+  for (size_t los_type = 0; los_type < 2; ++los_type) {
+    LargeObjectSpace* los = nullptr;
+    if (los_type == 0) {
+      los = space::LargeObjectMapSpace::Create("large object space");
+    } else {
+      los = space::FreeListSpace::Create("large object space", nullptr, 128 * MB);
+    }
+
+    // Every other object is marked, the others are garbage.
+    static const size_t num_objects = 128;
+    Thread* self = Thread::Current();
+    std::vector<mirror::Object*> objects;
+    size_t marked_bytes = 0;
+    for (size_t i = 0; i < num_objects; ++i) {
+      size_t allocation_size, bytes_tl_bulk_allocated;
+      mirror::Object* obj = los->Alloc(self, (i % 7 + 1) * 40 * KB, &allocation_size, nullptr,
+                                       &bytes_tl_bulk_allocated);
+      ASSERT_TRUE(obj != nullptr);
+      los->GetLiveBitmap()->Set(obj);
+      if (i % 2 == 0) {
+        los->GetMarkBitmap()->Set(obj);
+        marked_bytes += allocation_size;
+      }
+      objects.push_back(obj);
+    }
+    const uint64_t allocated_bytes = los->GetBytesAllocated();
+
+    // Sweep one bitmap word per task, like MarkSweep does with larger ranges.
+    const uintptr_t heap_begin = los->GetLiveBitmap()->HeapBegin();
+    const uintptr_t word_size = accounting::LargeObjectBitmap::IndexToOffset<uintptr_t>(1);
+    const uintptr_t end = reinterpret_cast<uintptr_t>(los->End());
+    std::vector<std::pair<uintptr_t, uintptr_t>> ranges;
+    for (uintptr_t begin = reinterpret_cast<uintptr_t>(los->Begin()); begin < end; ) {
+      uintptr_t range_end = std::min(heap_begin + RoundDown(begin - heap_begin + word_size,
+                                                            word_size),
+                                     end);
+      ranges.emplace_back(begin, range_end);
+      begin = range_end;
+    }
+    std::vector<collector::ObjectBytePair> freed(ranges.size());
+    ThreadPool thread_pool("Large object space sweep thread pool", kNumThreads);
+    for (size_t i = 0; i < ranges.size(); ++i) {
+      thread_pool.AddTask(self, new SweepRangeTask(los, ranges[i].first, ranges[i].second,
+                                                   &freed[i]));
+    }
+    thread_pool.StartWorkers(self);
+    thread_pool.Wait(self, true, false);
+
+    collector::ObjectBytePair total;
+    for (const collector::ObjectBytePair& range_freed : freed) {
+      total.Add(range_freed);
+    }
+    EXPECT_EQ(num_objects / 2, total.objects);
+    EXPECT_EQ(static_cast<int64_t>(allocated_bytes - marked_bytes), total.bytes);
+    EXPECT_EQ(num_objects / 2, los->GetObjectsAllocated());
+    EXPECT_EQ(marked_bytes, los->GetBytesAllocated());
+    for (size_t i = 0; i < num_objects; ++i) {
+      EXPECT_EQ(i % 2 == 0, los->GetLiveBitmap()->Test(objects[i]));
+    }
+
+    for (size_t i = 0; i < num_objects; i += 2) {
+      los->Free(self, objects[i]);
+    }
+    EXPECT_EQ(0U, los->GetBytesAllocated());
+    delete los;
+  }
+}
+
+void LargeObjectSpaceTest::FreeListBestFitTest() {
+  std::unique_ptr<FreeListSpace> los(
+      space::FreeListSpace::Create("large object space", nullptr, 128 * MB));
+  Thread* self = Thread::Current();
+  size_t allocation_size, bytes_tl_bulk_allocated;
+
+  // Holes of these numbers of pages, separated by single pages so that they aren't coalesced.
+  static const size_t hole_pages[] = { 40, 17, 64, 20, 18 };
+  std::vector<mirror::Object*> holes;
+  std::vector<mirror::Object*> separators;
+  for (size_t pages : hole_pages) {
+    holes.push_back(los->Alloc(self, pages * kPageSize, &allocation_size, nullptr,
+                               &bytes_tl_bulk_allocated));
+    separators.push_back(los->Alloc(self, kPageSize, &allocation_size, nullptr,
+                                    &bytes_tl_bulk_allocated));
+    ASSERT_TRUE(holes.back() != nullptr);
+    ASSERT_TRUE(separators.back() != nullptr);
+  }
+  los->FreeList(self, holes.size(), holes.data());
+  EXPECT_EQ(separators.size(), los->GetObjectsAllocated());
+
+  // Every request lands in the smallest hole that fits it.
+  static const std::pair<size_t, size_t> requests[] = { {18, 4}, {17, 1}, {20, 3}, {33, 0} };
+  for (const std::pair<size_t, size_t>& request : requests) {
+    mirror::Object* obj = los->Alloc(self, request.first * kPageSize, &allocation_size, nullptr,
+                                     &bytes_tl_bulk_allocated);
+    EXPECT_EQ(holes[request.second], obj) << request.first << " pages";
+  }
+  // Larger than any hole, comes from the end of the space.
+  mirror::Object* obj = los->Alloc(self, 65 * kPageSize, &allocation_size, nullptr,
+                                   &bytes_tl_bulk_allocated);
+  EXPECT_GT(obj, separators.back());
+  // The remaining hole.
+  obj = los->Alloc(self, 64 * kPageSize, &allocation_size, nullptr, &bytes_tl_bulk_allocated);
+  EXPECT_EQ(holes[2], obj);
+}
+
 TEST_F(LargeObjectSpaceTest, LargeObjectTest) {
   LargeObjectTest();
 }
@@ -172,6 +304,14 @@ TEST_F(LargeObjectSpaceTest, RaceTest) {
   RaceTest();
 }
 
+TEST_F(LargeObjectSpaceTest, SweepRangeTest) {
+  SweepRangeTest();
+}
+
+TEST_F(LargeObjectSpaceTest, FreeListBestFitTest) {
+  FreeListBestFitTest();
+}
+
 }  // namespace space
 }  // namespace gc
 }  // namespace art
@@ -19,6 +19,8 @@
 
 #include "region_space.h"
 
+#include "gc/accounting/space_bitmap-inl.h"
+
 namespace art {
 namespace gc {
 namespace space {
@@ -92,6 +94,7 @@ inline mirror::Object* RegionSpace::AllocNonvirtual(size_t num_bytes, size_t* by
         Region* r = &regions_[i];
         if (r->IsFree()) {
           r->Unfree(time_);
+          r->SetPromoted();
           ++num_non_free_regions_;
           obj = r->Alloc(num_bytes, bytes_allocated, usable_size, bytes_tl_bulk_allocated);
           CHECK(obj != nullptr);
@@ -222,7 +225,7 @@ uint64_t RegionSpace::GetObjectsAllocatedInternal() {
   return bytes;
 }
 
-template<bool kToSpaceOnly>
+template<bool kToSpaceOnly, bool kLiveOnly>
 void RegionSpace::WalkInternal(ObjectCallback* callback, void* arg) {
   // TODO: MutexLock on region_lock_ won't work due to lock order
   // issues (the classloader classes lock and the monitor lock). We
@@ -235,11 +238,21 @@ void RegionSpace::WalkInternal(ObjectCallback* callback, void* arg) {
     }
     if (r->IsLarge()) {
       mirror::Object* obj = reinterpret_cast<mirror::Object*>(r->Begin());
+      if (kLiveOnly && r->IsPromoted() && !region_mark_bitmap_->Test(obj)) {
+        continue;
+      }
       if (obj->GetClass() != nullptr) {
         callback(obj, arg);
       }
     } else if (r->IsLargeTail()) {
       // Do nothing.
+    } else if (kLiveOnly && r->IsPromoted()) {
+      // The region may hold dead objects whose classes are gone, don't walk it linearly.
+      region_mark_bitmap_->VisitMarkedRange(reinterpret_cast<uintptr_t>(r->Begin()),
+                                            reinterpret_cast<uintptr_t>(r->Top()),
+                                            [callback, arg](mirror::Object* obj) {
+        callback(obj, arg);
+      });
     } else {
       uint8_t* pos = r->Begin();
       uint8_t* top = r->Top();
@@ -299,12 +312,18 @@ mirror::Object* RegionSpace::AllocLarge(size_t num_bytes, size_t* bytes_allocate
       Region* first_reg = &regions_[left];
       DCHECK(first_reg->IsFree());
       first_reg->UnfreeLarge(time_);
+      if (kForEvac) {
+        first_reg->SetPromoted();
+      }
       ++num_non_free_regions_;
       first_reg->SetTop(first_reg->Begin() + num_bytes);
       for (size_t p = left + 1; p < right; ++p) {
         DCHECK_LT(p, num_regions_);
         DCHECK(regions_[p].IsFree());
         regions_[p].UnfreeLargeTail(time_);
+        if (kForEvac) {
+          regions_[p].SetPromoted();
+        }
         ++num_non_free_regions_;
       }
       *bytes_allocated = num_bytes;
@@ -77,6 +77,9 @@ RegionSpace::RegionSpace(const std::string& name, MemMap* mem_map)
   evac_region_ = nullptr;
   size_t ignored;
   DCHECK(full_region_.Alloc(kAlignment, &ignored, nullptr, &ignored) == nullptr);
+  region_mark_bitmap_.reset(accounting::ContinuousSpaceBitmap::Create(
+      "region space mark bitmap", Begin(), Capacity()));
+  CHECK(region_mark_bitmap_.get() != nullptr) << "Could not create region space mark bitmap";
 }
 
 size_t RegionSpace::FromSpaceSize() {
@@ -144,8 +147,10 @@ inline bool RegionSpace::Region::ShouldBeEvacuated() {
 }
 
 // Determine which regions to evacuate and mark them as
-// from-space. Mark the rest as unevacuated from-space.
-void RegionSpace::SetFromSpace(accounting::ReadBarrierTable* rb_table, bool force_evacuate_all) {
+// from-space. Mark the rest as unevacuated from-space, or leave them
+// in the to-space for a young collection.
+void RegionSpace::SetFromSpace(accounting::ReadBarrierTable* rb_table, bool force_evacuate_all,
+                               bool young_gen) {
   ++time_;
   if (kUseTableLookupReadBarrier) {
     DCHECK(rb_table->IsAllCleared());
@@ -160,11 +165,20 @@ void RegionSpace::SetFromSpace(accounting::ReadBarrierTable* rb_table, bool forc
     RegionType type = r->Type();
     if (!r->IsFree()) {
       DCHECK(r->IsInToSpace());
+      if (young_gen && r->IsPromoted()) {
+        // The objects survived an earlier collection. The tails of a large region are promoted
+        // along with it.
+        DCHECK_EQ(num_expected_large_tails, 0U);
+        if (kUseTableLookupReadBarrier) {
+          rb_table->Clear(r->Begin(), r->End());
+        }
+        continue;
+      }
       if (LIKELY(num_expected_large_tails == 0U)) {
         DCHECK((state == RegionState::kRegionStateAllocated ||
                 state == RegionState::kRegionStateLarge) &&
                type == RegionType::kRegionTypeToSpace);
-        bool should_evacuate = force_evacuate_all || r->ShouldBeEvacuated();
+        bool should_evacuate = force_evacuate_all || young_gen || r->ShouldBeEvacuated();
         if (should_evacuate) {
           r->SetAsFromSpace();
           DCHECK(r->IsInFromSpace());
@@ -207,10 +221,12 @@ void RegionSpace::ClearFromSpace() {
   for (size_t i = 0; i < num_regions_; ++i) {
     Region* r = &regions_[i];
     if (r->IsInFromSpace()) {
+      ClearRegionMarkBits(r);
       r->Clear();
       --num_non_free_regions_;
     } else if (r->IsInUnevacFromSpace()) {
       r->SetUnevacFromSpaceAsToSpace();
+      r->SetPromoted();
     }
   }
   evac_region_ = nullptr;
@@ -273,6 +289,7 @@ void RegionSpace::Clear() {
     Region* r = &regions_[i];
     if (!r->IsFree()) {
       --num_non_free_regions_;
+      ClearRegionMarkBits(r);
     }
     r->Clear();
   }
@@ -299,6 +316,7 @@ void RegionSpace::FreeLarge(mirror::Object* large_obj, size_t bytes_allocated) {
     } else {
       DCHECK(reg->IsLargeTail());
     }
+    ClearRegionMarkBits(reg);
     reg->Clear();
     --num_non_free_regions_;
   }
@@ -413,7 +431,8 @@ void RegionSpace::Region::Dump(std::ostream& os) const {
      << " state=" << static_cast<uint>(state_) << " type=" << static_cast<uint>(type_)
      << " objects_allocated=" << objects_allocated_
      << " alloc_time=" << alloc_time_ << " live_bytes=" << live_bytes_
-     << " is_newly_allocated=" << is_newly_allocated_ << " is_a_tlab=" << is_a_tlab_ << " thread=" << thread_ << "\n";
+     << " is_newly_allocated=" << is_newly_allocated_ << " is_promoted=" << is_promoted_
+     << " is_a_tlab=" << is_a_tlab_ << " thread=" << thread_ << "\n";
 }
 
 }  // namespace space
@@ -87,6 +87,14 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
 
   void Clear() OVERRIDE REQUIRES(!region_lock_);
 
+  // The mark bitmap of the concurrent copying collector. Unlike the bitmaps of the other spaces,
+  // it's kept across collections, so that a young collection can find the live objects in the
+  // promoted regions, which may also hold dead objects. The bits of a region are cleared when the
+  // region is freed.
+  accounting::ContinuousSpaceBitmap* GetRegionMarkBitmap() const {
+    return region_mark_bitmap_.get();
+  }
+
   void Dump(std::ostream& os) const;
   void DumpRegions(std::ostream& os) REQUIRES(!region_lock_);
   void DumpNonFreeRegions(std::ostream& os) REQUIRES(!region_lock_);
@@ -159,6 +167,13 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
     WalkInternal<true>(callback, arg);
   }
 
+  // Like WalkToSpace(), but only visits the objects of the promoted regions that are marked in the
+  // region mark bitmap.
+  void WalkLiveToSpace(ObjectCallback* callback, void* arg)
+      REQUIRES(Locks::mutator_lock_) {
+    WalkInternal<true, true>(callback, arg);
+  }
+
   accounting::ContinuousSpaceBitmap::SweepCallback* GetSweepCallback() OVERRIDE {
     return nullptr;
   }
@@ -202,7 +217,10 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
     return RegionType::kRegionTypeNone;
   }
 
-  void SetFromSpace(accounting::ReadBarrierTable* rb_table, bool force_evacuate_all)
+  // Determine the regions to collect. A young collection evacuates all the regions that were
+  // allocated since the previous collection and keeps the promoted ones in the to-space.
+  void SetFromSpace(accounting::ReadBarrierTable* rb_table, bool force_evacuate_all,
+                    bool young_gen)
       REQUIRES(!region_lock_);
 
   size_t FromSpaceSize() REQUIRES(!region_lock_);
@@ -227,7 +245,7 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
  private:
   RegionSpace(const std::string& name, MemMap* mem_map);
 
-  template<bool kToSpaceOnly>
+  template<bool kToSpaceOnly, bool kLiveOnly = false>
   void WalkInternal(ObjectCallback* callback, void* arg) NO_THREAD_SAFETY_ANALYSIS;
 
   class Region {
@@ -237,13 +255,13 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
           begin_(nullptr), top_(nullptr), end_(nullptr),
           state_(RegionState::kRegionStateAllocated), type_(RegionType::kRegionTypeToSpace),
           objects_allocated_(0), alloc_time_(0), live_bytes_(static_cast<size_t>(-1)),
-          is_newly_allocated_(false), is_a_tlab_(false), thread_(nullptr) {}
+          is_newly_allocated_(false), is_promoted_(false), is_a_tlab_(false), thread_(nullptr) {}
 
     Region(size_t idx, uint8_t* begin, uint8_t* end)
         : idx_(idx), begin_(begin), top_(begin), end_(end),
           state_(RegionState::kRegionStateFree), type_(RegionType::kRegionTypeNone),
           objects_allocated_(0), alloc_time_(0), live_bytes_(static_cast<size_t>(-1)),
-          is_newly_allocated_(false), is_a_tlab_(false), thread_(nullptr) {
+          is_newly_allocated_(false), is_promoted_(false), is_a_tlab_(false), thread_(nullptr) {
       DCHECK_LT(begin, end);
       DCHECK_EQ(static_cast<size_t>(end - begin), kRegionSize);
     }
@@ -268,6 +286,7 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
       }
       madvise(begin_, end_ - begin_, MADV_DONTNEED);
       is_newly_allocated_ = false;
+      is_promoted_ = false;
       is_a_tlab_ = false;
       thread_ = nullptr;
     }
@@ -312,6 +331,14 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
       is_newly_allocated_ = true;
     }
 
+    void SetPromoted() {
+      is_promoted_ = true;
+    }
+
+    bool IsPromoted() const {
+      return is_promoted_;
+    }
+
     // Non-large, non-large-tail allocated.
     bool IsAllocated() const {
       return state_ == RegionState::kRegionStateAllocated;
@@ -472,6 +499,7 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
     uint32_t alloc_time_;          // The allocation time of the region.
     size_t live_bytes_;            // The live bytes. Used to compute the live percent.
     bool is_newly_allocated_;      // True if it's allocated after the last collection.
+    bool is_promoted_;             // True if it holds objects that survived a collection.
     bool is_a_tlab_;               // True if it's a tlab.
     Thread* thread_;               // The owning thread if it's a tlab.
 
@@ -508,6 +536,11 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
   mirror::Object* GetNextObject(mirror::Object* obj)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
+  void ClearRegionMarkBits(Region* r) {
+    region_mark_bitmap_->ClearRange(reinterpret_cast<mirror::Object*>(r->Begin()),
+                                    reinterpret_cast<mirror::Object*>(r->End()));
+  }
+
   Mutex region_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
 
   uint32_t time_;                  // The time as the number of collections since the startup.
@@ -518,6 +551,8 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
   Region* current_region_;         // The region that's being allocated currently.
   Region* evac_region_;            // The region that's being evacuated to currently.
   Region full_region_;             // The dummy/sentinel region that looks full.
+  std::unique_ptr<accounting::ContinuousSpaceBitmap> region_mark_bitmap_;
+                                   // The mark bitmap of the concurrent copying collector.
 
   DISALLOW_COPY_AND_ASSIGN(RegionSpace);
 };
@@ -438,6 +438,11 @@ class ContinuousMemMapAllocSpace : public MemMapSpace, public AllocSpace {
   }
 
   collector::ObjectBytePair Sweep(bool swap_bitmaps);
+  // Sweeps the objects in [sweep_begin, sweep_end). The range has to start and end at bitmap word
+  // boundaries, then disjoint ranges can be swept by several threads at the same time while the
+  // calling GC holds the heap bitmap lock.
+  collector::ObjectBytePair SweepRange(bool swap_bitmaps, uintptr_t sweep_begin,
+                                       uintptr_t sweep_end);
   virtual accounting::ContinuousSpaceBitmap::SweepCallback* GetSweepCallback() = 0;
 
  protected:
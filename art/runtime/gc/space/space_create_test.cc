@@ -17,8 +17,10 @@
 #include "space_test.h"
 
 #include "dlmalloc_space.h"
+#include "gc/accounting/space_bitmap-inl.h"
 #include "rosalloc_space.h"
 #include "scoped_thread_state_change.h"
+#include "thread_pool.h"
 
 namespace art {
 namespace gc {
@@ -352,6 +354,102 @@ TEST_P(SpaceCreateTest, AllocAndFreeListTestBody) {
   space->FreeList(self, arraysize(lots_of_objects), lots_of_objects);
 }
 
+class SweepRangeTask : public Task {
+ public:
+  SweepRangeTask(MallocSpace* space, uintptr_t begin, uintptr_t end,
+                 collector::ObjectBytePair* freed)
+      : space_(space), begin_(begin), end_(end), freed_(freed) {}
+
+  // The test thread holds the heap bitmap lock like MarkSweep does, the workers don't.
+  void Run(Thread* self ATTRIBUTE_UNUSED) NO_THREAD_SAFETY_ANALYSIS {
+    *freed_ = space_->SweepRange(false, begin_, end_);
+  }
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+ private:
+  MallocSpace* const space_;
+  const uintptr_t begin_;
+  const uintptr_t end_;
+  collector::ObjectBytePair* const freed_;
+};
+
+TEST_P(SpaceCreateTest, SweepRangeTestBody) {
+  MallocSpace* space(CreateSpace("test", 4 * MB, 16 * MB, 16 * MB, nullptr));
+  ASSERT_TRUE(space != nullptr);
+
+  // Make space findable to the heap, will also delete space when runtime is cleaned up
+  AddSpace(space);
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+
+  // Every other object is marked, the others are garbage.
+  static const size_t num_objects = 4096;
+  std::vector<mirror::Object*> objects;
+  size_t garbage_bytes = 0;
+  for (size_t i = 0; i < num_objects; ++i) {
+    size_t allocation_size, usable_size, bytes_tl_bulk_allocated;
+    mirror::Object* obj = Alloc(space,
+                                self,
+                                SizeOfZeroLengthByteArray() + (i % 13) * 64,
+                                &allocation_size,
+                                &usable_size,
+                                &bytes_tl_bulk_allocated);
+    ASSERT_TRUE(obj != nullptr);
+    space->GetLiveBitmap()->Set(obj);
+    if (i % 2 == 0) {
+      space->GetMarkBitmap()->Set(obj);
+    } else {
+      garbage_bytes += allocation_size;
+    }
+    objects.push_back(obj);
+  }
+  space->RevokeAllThreadLocalBuffers();
+
+  // Sweep one bitmap word per task on threads that don't hold the heap bitmap lock.
+  const uintptr_t heap_begin = space->GetLiveBitmap()->HeapBegin();
+  const uintptr_t word_size = accounting::ContinuousSpaceBitmap::IndexToOffset<uintptr_t>(1);
+  const uintptr_t end = reinterpret_cast<uintptr_t>(space->End());
+  std::vector<std::pair<uintptr_t, uintptr_t>> ranges;
+  for (uintptr_t begin = reinterpret_cast<uintptr_t>(space->Begin()); begin < end; ) {
+    uintptr_t range_end = std::min(heap_begin + RoundDown(begin - heap_begin + word_size,
+                                                          word_size),
+                                   end);
+    ranges.emplace_back(begin, range_end);
+    begin = range_end;
+  }
+  std::vector<collector::ObjectBytePair> freed(ranges.size());
+  {
+    WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
+    ThreadPool thread_pool("Malloc space sweep thread pool", 4);
+    for (size_t i = 0; i < ranges.size(); ++i) {
+      thread_pool.AddTask(self, new SweepRangeTask(space, ranges[i].first, ranges[i].second,
+                                                   &freed[i]));
+    }
+    thread_pool.StartWorkers(self);
+    thread_pool.Wait(self, true, false);
+  }
+
+  collector::ObjectBytePair total;
+  for (const collector::ObjectBytePair& range_freed : freed) {
+    total.Add(range_freed);
+  }
+  EXPECT_EQ(num_objects / 2, total.objects);
+  EXPECT_EQ(static_cast<int64_t>(garbage_bytes), total.bytes);
+  for (size_t i = 0; i < num_objects; ++i) {
+    EXPECT_EQ(i % 2 == 0, space->GetLiveBitmap()->Test(objects[i]));
+  }
+
+  // Release memory.
+  for (size_t i = 0; i < num_objects; i += 2) {
+    space->GetLiveBitmap()->Clear(objects[i]);
+    space->GetMarkBitmap()->Clear(objects[i]);
+    space->Free(self, objects[i]);
+  }
+}
+
 INSTANTIATE_TEST_CASE_P(CreateRosAllocSpace,
                         SpaceCreateTest,
                         testing::Values(kMallocSpaceRosAlloc));
@@ -16,7 +16,9 @@
 
 #include "instrumentation.h"
 
+#include <algorithm>
 #include <sstream>
+#include <vector>
 
 #include "arch/context.h"
 #include "art_method-inl.h"
@@ -167,18 +169,40 @@ void Instrumentation::InstallStubsForMethod(ArtMethod* method) {
   UpdateEntrypoints(method, new_quick_code);
 }
 
-// Places the instrumentation exit pc as the return PC for every quick frame. This also allows
-// deoptimization of quick frames to interpreter frames.
-// Since we may already have done this previously, we need to push new instrumentation frame before
-// existing instrumentation frames.
-static void InstrumentationInstallStack(Thread* thread, void* arg)
+// Returns whether the compiled code of `method` at `pc` must not be resumed anymore, because it
+// was invalidated after a method it calls or inlines has been hooked.
+static bool IsInvalidatedCode(ArtMethod* method, uintptr_t pc)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
+  if (!method->IgnoreAotCode()) {
+    return false;
+  }
+  if (Runtime::Current()->UseJitCompilation()) {
+    jit::JitCodeCache* code_cache = Runtime::Current()->GetJit()->GetCodeCache();
+    return !code_cache->ContainsPc(reinterpret_cast<const void*>(pc)) ||
+        code_cache->IsInvalidated(method, pc);
+  }
+  return true;
+}
+
+// Places the instrumentation exit pc as the return PC for every quick frame, or only for the
+// quick frames listed in `frame_ids` if it is not null. This also allows deoptimization of quick
+// frames to interpreter frames.
+// Since we may already have done this previously, either for the whole stack or only for some
+// frames, we need to insert new instrumentation frames between the existing ones.
+// Returns the number of frames that have been instrumented.
+static size_t InstallExitStubs(Thread* thread,
+                               Instrumentation* instrumentation,
+                               const std::vector<size_t>* frame_ids)
     SHARED_REQUIRES(Locks::mutator_lock_) {
   struct InstallStackVisitor FINAL : public StackVisitor {
-    InstallStackVisitor(Thread* thread_in, Context* context, uintptr_t instrumentation_exit_pc)
+    InstallStackVisitor(Thread* thread_in,
+                        Context* context,
+                        uintptr_t instrumentation_exit_pc,
+                        const std::vector<size_t>* frame_ids)
         : StackVisitor(thread_in, context, kInstrumentationStackWalk),
           instrumentation_stack_(thread_in->GetInstrumentationStack()),
           instrumentation_exit_pc_(instrumentation_exit_pc),
-          reached_existing_instrumentation_frames_(false), instrumentation_stack_depth_(0),
+          frame_ids_(frame_ids), instrumentation_stack_depth_(0), frames_installed_(0),
           last_return_pc_(0) {
     }
 
@@ -226,14 +250,17 @@ static void InstrumentationInstallStack(Thread* thread, void* arg)
           return true;  // Ignore unresolved methods since they will be instrumented after resolution.
         }
       }
+      if (frame_ids_ != nullptr &&
+          return_pc != instrumentation_exit_pc_ &&
+          std::find(frame_ids_->begin(), frame_ids_->end(), GetFrameId()) == frame_ids_->end()) {
+        last_return_pc_ = return_pc;
+        return true;  // Not one of the requested frames.
+      }
       if (kVerboseInstrumentation) {
         LOG(INFO) << "  Installing exit stub in " << DescribeLocation();
       }
       if (return_pc == instrumentation_exit_pc_) {
         // We've reached a frame which has already been installed with instrumentation exit stub.
-        // We should have already installed instrumentation on previous frames.
-        reached_existing_instrumentation_frames_ = true;
-
         CHECK_LT(instrumentation_stack_depth_, instrumentation_stack_->size());
         const InstrumentationStackFrame& frame =
             instrumentation_stack_->at(instrumentation_stack_depth_);
@@ -245,7 +272,6 @@ static void InstrumentationInstallStack(Thread* thread, void* arg)
         }
       } else {
         CHECK_NE(return_pc, 0U);
-        CHECK(!reached_existing_instrumentation_frames_);
         InstrumentationStackFrame instrumentation_frame(GetThisObject(), m, return_pc, GetFrameId(),
                                                         false);
         if (kVerboseInstrumentation) {
@@ -263,6 +289,7 @@ static void InstrumentationInstallStack(Thread* thread, void* arg)
         }
         instrumentation_stack_->insert(it, instrumentation_frame);
         SetReturnPc(instrumentation_exit_pc_);
+        ++frames_installed_;
       }
       dex_pcs_.push_back((GetCurrentOatQuickMethodHeader() == nullptr)
           ? DexFile::kDexNoIndex
@@ -275,8 +302,9 @@ static void InstrumentationInstallStack(Thread* thread, void* arg)
     std::vector<InstrumentationStackFrame> shadow_stack_;
     std::vector<uint32_t> dex_pcs_;
     const uintptr_t instrumentation_exit_pc_;
-    bool reached_existing_instrumentation_frames_;
+    const std::vector<size_t>* const frame_ids_;
     size_t instrumentation_stack_depth_;
+    size_t frames_installed_;
     uintptr_t last_return_pc_;
   };
   if (kVerboseInstrumentation) {
@@ -285,14 +313,15 @@ static void InstrumentationInstallStack(Thread* thread, void* arg)
     LOG(INFO) << "Installing exit stubs in " << thread_name;
   }
 
-  Instrumentation* instrumentation = reinterpret_cast<Instrumentation*>(arg);
   std::unique_ptr<Context> context(Context::Create());
   uintptr_t instrumentation_exit_pc = reinterpret_cast<uintptr_t>(GetQuickInstrumentationExitPc());
-  InstallStackVisitor visitor(thread, context.get(), instrumentation_exit_pc);
+  InstallStackVisitor visitor(thread, context.get(), instrumentation_exit_pc, frame_ids);
   visitor.WalkStack(true);
   CHECK_EQ(visitor.dex_pcs_.size(), thread->GetInstrumentationStack()->size());
 
-  if (instrumentation->ShouldNotifyMethodEnterExitEvents()) {
+  // Method enter events are only reported when the whole stack gets instrumented, i.e. when the
+  // listeners are added. By then, any frames instrumented for a selected set already are.
+  if (frame_ids == nullptr && instrumentation->ShouldNotifyMethodEnterExitEvents()) {
     // Create method enter events for all methods currently on the thread's stack. We only do this
     // if no debugger is attached to prevent from posting events twice.
     auto ssi = visitor.shadow_stack_.rbegin();
@@ -310,6 +339,13 @@ static void InstrumentationInstallStack(Thread* thread, void* arg)
     }
   }
   thread->VerifyStack();
+  return visitor.frames_installed_;
+}
+
+static void InstrumentationInstallStack(Thread* thread, void* arg)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
+  Instrumentation* instrumentation = reinterpret_cast<Instrumentation*>(arg);
+  InstallExitStubs(thread, instrumentation, nullptr);
 }
 
 void Instrumentation::InstrumentThreadStack(Thread* thread) {
@@ -317,6 +353,42 @@ void Instrumentation::InstrumentThreadStack(Thread* thread) {
   InstrumentationInstallStack(thread, this);
 }
 
+size_t Instrumentation::InstrumentInvalidatedCallerFrames(Thread* thread) {
+  // Collects the frames whose caller resumes in invalidated compiled code. Only the return
+  // PC of these frames needs to go through the exit stub, which deoptimizes the caller.
+  struct FindInvalidatedCallersVisitor FINAL : public StackVisitor {
+    explicit FindInvalidatedCallersVisitor(Thread* thread_in)
+        : StackVisitor(thread_in, nullptr, kInstrumentationStackWalk),
+          callee_frame_id_(0),
+          callee_is_quick_method_(false) {}
+
+    bool VisitFrame() OVERRIDE SHARED_REQUIRES(Locks::mutator_lock_) {
+      ArtMethod* m = GetMethod();
+      bool is_quick_method =
+          m != nullptr && GetCurrentQuickFrame() != nullptr && !m->IsRuntimeMethod();
+      if (is_quick_method &&
+          callee_is_quick_method_ &&
+          IsInvalidatedCode(m, GetCurrentQuickFramePc())) {
+        frame_ids_.push_back(callee_frame_id_);
+      }
+      callee_frame_id_ = GetFrameId();
+      callee_is_quick_method_ = is_quick_method;
+      return true;
+    }
+
+    std::vector<size_t> frame_ids_;
+    size_t callee_frame_id_;
+    bool callee_is_quick_method_;
+  };
+
+  FindInvalidatedCallersVisitor visitor(thread);
+  visitor.WalkStack(true);
+  if (visitor.frame_ids_.empty()) {
+    return 0;
+  }
+  return InstallExitStubs(thread, this, &visitor.frame_ids_);
+}
+
 // Removes the instrumentation exit pc as the return PC for every quick frame.
 static void InstrumentationRestoreStack(Thread* thread, void* arg)
     REQUIRES(Locks::mutator_lock_) {
@@ -1093,16 +1165,8 @@ TwoWordReturn Instrumentation::PopInstrumentationStackFrame(Thread* self, uintpt
   visitor.WalkStack(true);
   bool deoptimize = (visitor.caller != nullptr) &&
                     (interpreter_stubs_installed_ || IsDeoptimized(visitor.caller) ||
-                    Dbg::IsForcedInterpreterNeededForUpcall(self, visitor.caller));
-  if (!deoptimize && visitor.caller != nullptr && visitor.caller->IgnoreAotCode()) {
-    if (Runtime::Current()->UseJitCompilation()) {
-      jit::JitCodeCache* code_cache = Runtime::Current()->GetJit()->GetCodeCache();
-      deoptimize = !code_cache->ContainsPc(reinterpret_cast<const void*>(*return_pc)) ||
-          code_cache->IsInvalidated(visitor.caller, *return_pc);
-    } else {
-      deoptimize = true;
-    }
-  }
+                    Dbg::IsForcedInterpreterNeededForUpcall(self, visitor.caller) ||
+                    IsInvalidatedCode(visitor.caller, *return_pc));
   if (deoptimize) {
     if (kVerboseInstrumentation) {
       LOG(INFO) << StringPrintf("Deoptimizing %s by returning from %s with result %#" PRIx64 " in ",
@@ -419,6 +419,14 @@ class Instrumentation {
       SHARED_REQUIRES(Locks::mutator_lock_)
       REQUIRES(!Locks::thread_list_lock_);
 
+  // Install instrumentation exit stubs only on the frames of the given thread whose caller would
+  // resume in invalidated compiled code, so that the caller gets deoptimized when they return.
+  // Other frames and the rest of the process are left uninstrumented. This is used after hooking
+  // methods. Returns the number of frames that have been instrumented.
+  size_t InstrumentInvalidatedCallerFrames(Thread* thread)
+      SHARED_REQUIRES(Locks::mutator_lock_)
+      REQUIRES(!Locks::thread_list_lock_);
+
   static size_t ComputeFrameId(Thread* self,
                                size_t frame_depth,
                                size_t inlined_frames_before_frame)
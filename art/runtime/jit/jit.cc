@@ -19,10 +19,12 @@
 #include <dlfcn.h>
 
 #include "art_method-inl.h"
+#include "base/stl_util.h"
 #include "debugger.h"
 #include "entrypoints/runtime_asm_entrypoints.h"
 #include "interpreter/interpreter.h"
 #include "jit_code_cache.h"
+#include "linear_alloc.h"
 #include "oat_file_manager.h"
 #include "oat_quick_method_header.h"
 #include "offline_profiling_info.h"
@@ -61,6 +63,8 @@ JitOptions* JitOptions::CreateFromRuntimeArguments(const RuntimeArgumentMap& opt
       options.Exists(RuntimeArgumentMap::DumpJITInfoOnShutdown);
   jit_options->save_profiling_info_ =
       options.GetOrDefault(RuntimeArgumentMap::JITSaveProfilingInfo);
+  jit_options->recompile_hook_callers_ =
+      options.GetOrDefault(RuntimeArgumentMap::JITRecompileHookCallers);
 
   jit_options->compile_threshold_ = options.GetOrDefault(RuntimeArgumentMap::JITCompileThreshold);
   if (jit_options->compile_threshold_ > std::numeric_limits<uint16_t>::max()) {
@@ -127,6 +131,11 @@ bool Jit::ShouldUsePriorityThreadWeight() {
 void Jit::DumpInfo(std::ostream& os) {
   code_cache_->Dump(os);
   cumulative_timings_.Dump(os);
+  {
+    MutexLock mu(Thread::Current(), recompilation_lock_);
+    os << "Total number of recompilations scheduled for callers of hooked methods: "
+       << number_of_recompilations_ << "\n";
+  }
   MutexLock mu(Thread::Current(), lock_);
   memory_use_.PrintMemoryUse(os);
 }
@@ -146,6 +155,9 @@ Jit::Jit() : dump_info_on_shutdown_(false),
              lock_("JIT memory use lock"),
              use_jit_compilation_(true),
              save_profiling_info_(false),
+             recompile_hook_callers_(false),
+             recompilation_lock_("JIT hook callers recompilation lock"),
+             number_of_recompilations_(0),
              hot_method_threshold_(0),
              warm_method_threshold_(0),
              osr_method_threshold_(0),
@@ -169,6 +181,7 @@ Jit* Jit::Create(JitOptions* options, std::string* error_msg) {
   }
   jit->use_jit_compilation_ = options->UseJitCompilation();
   jit->save_profiling_info_ = options->GetSaveProfilingInfo();
+  jit->recompile_hook_callers_ = options->GetRecompileHookCallers();
   VLOG(jit) << "JIT created with initial_capacity="
       << PrettySize(options->GetCodeCacheInitialCapacity())
       << ", max_capacity=" << PrettySize(options->GetCodeCacheMaxCapacity())
@@ -596,6 +609,66 @@ class JitCompileTask FINAL : public Task {
   DISALLOW_IMPLICIT_CONSTRUCTORS(JitCompileTask);
 };
 
+void Jit::ScheduleRecompilation(ArtMethod* method) {
+  if (!recompile_hook_callers_ || !use_jit_compilation_) {
+    return;
+  }
+  if (method->IsClassInitializer() || method->IsNative() || !method->IsCompilable()) {
+    return;
+  }
+  MutexLock mu(Thread::Current(), recompilation_lock_);
+  scheduled_recompilations_.push_back(method);
+}
+
+void Jit::CompileScheduledMethods(Thread* self) {
+  std::vector<ArtMethod*> methods;
+  {
+    MutexLock mu(self, recompilation_lock_);
+    methods.swap(scheduled_recompilations_);
+    number_of_recompilations_ += methods.size();
+  }
+  if (methods.empty() || thread_pool_ == nullptr) {
+    return;
+  }
+  STLSortAndRemoveDuplicates(&methods);
+
+  // Create the tasks first, they keep the classes alive while we allocate the profiling infos,
+  // which may suspend.
+  std::vector<JitCompileTask*> tasks;
+  tasks.reserve(methods.size());
+  for (ArtMethod* method : methods) {
+    tasks.push_back(new JitCompileTask(method, JitCompileTask::kCompile));
+  }
+
+  // The tasks are added to the front of the queue, so the callers are compiled before any method
+  // which got hot in the meantime, and don't have to warm up in the interpreter first. Adding the
+  // compilation before the profile allocation makes the allocation run first.
+  for (size_t i = 0; i < methods.size(); ++i) {
+    ArtMethod* method = methods[i];
+    thread_pool_->AddPriorityTask(self, tasks[i]);
+    if (method->GetProfilingInfo(sizeof(void*)) == nullptr &&
+        !ProfilingInfo::Create(self, method, /* retry_allocation */ false)) {
+      if (thread_pool_ == nullptr) {
+        // Calling ProfilingInfo::Create might put us in a suspended state, which could
+        // lead to the thread pool being deleted when we are shutting down.
+        DCHECK(Runtime::Current()->IsShuttingDown(self));
+        return;
+      }
+      thread_pool_->AddPriorityTask(self,
+                                    new JitCompileTask(method, JitCompileTask::kAllocateProfile));
+    }
+  }
+}
+
+void Jit::RemoveScheduledMethodsIn(Thread* self, const LinearAlloc& alloc) {
+  MutexLock mu(self, recompilation_lock_);
+  scheduled_recompilations_.erase(
+      std::remove_if(scheduled_recompilations_.begin(),
+                     scheduled_recompilations_.end(),
+                     [&alloc](ArtMethod* method) { return alloc.ContainsUnsafe(method); }),
+      scheduled_recompilations_.end());
+}
+
 void Jit::AddSamples(Thread* self, ArtMethod* method, uint16_t count, bool with_backedges) {
   if (thread_pool_ == nullptr) {
     // Should only see this when shutting down.
@@ -29,6 +29,7 @@
 namespace art {
 
 class ArtMethod;
+class LinearAlloc;
 struct RuntimeArgumentMap;
 
 namespace jit {
@@ -106,6 +107,25 @@ class Jit {
   void AddSamples(Thread* self, ArtMethod* method, uint16_t samples, bool with_backedges)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
+  // Remembers a method whose compiled code was invalidated because it calls a hooked method.
+  // Does nothing unless -Xjitrecompilehookcallers was passed. Can be called with all threads
+  // suspended.
+  void ScheduleRecompilation(ArtMethod* method)
+      REQUIRES(!recompilation_lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Queues the methods passed to ScheduleRecompilation() for compilation ahead of all other
+  // pending tasks, rather than waiting for them to get hot again in the interpreter. The hooked
+  // callees are never inlined, so the new code calls the hooks.
+  void CompileScheduledMethods(Thread* self)
+      REQUIRES(!recompilation_lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Forgets the scheduled methods that were allocated by 'alloc', whose class loader is being
+  // unloaded.
+  void RemoveScheduledMethodsIn(Thread* self, const LinearAlloc& alloc)
+      REQUIRES(!recompilation_lock_);
+
   void InvokeVirtualOrInterface(Thread* thread,
                                 mirror::Object* this_object,
                                 ArtMethod* caller,
@@ -194,6 +214,13 @@ class Jit {
 
   bool use_jit_compilation_;
   bool save_profiling_info_;
+  bool recompile_hook_callers_;
+
+  // Methods to recompile after hooks have been installed.
+  Mutex recompilation_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  std::vector<ArtMethod*> scheduled_recompilations_ GUARDED_BY(recompilation_lock_);
+  size_t number_of_recompilations_ GUARDED_BY(recompilation_lock_);
+
   static bool generate_debug_info_;
   uint16_t hot_method_threshold_;
   uint16_t warm_method_threshold_;
@@ -235,6 +262,9 @@ class JitOptions {
   bool GetSaveProfilingInfo() const {
     return save_profiling_info_;
   }
+  bool GetRecompileHookCallers() const {
+    return recompile_hook_callers_;
+  }
   bool UseJitCompilation() const {
     return use_jit_compilation_;
   }
@@ -260,6 +290,7 @@ class JitOptions {
   size_t invoke_transition_weight_;
   bool dump_info_on_shutdown_;
   bool save_profiling_info_;
+  bool recompile_hook_callers_;
 
   JitOptions()
       : use_jit_compilation_(false),
@@ -267,7 +298,8 @@ class JitOptions {
         code_cache_max_capacity_(0),
         compile_threshold_(0),
         dump_info_on_shutdown_(false),
-        save_profiling_info_(false) { }
+        save_profiling_info_(false),
+        recompile_hook_callers_(false) { }
 
   DISALLOW_COPY_AND_ASSIGN(JitOptions);
 };
@@ -145,6 +145,8 @@ JitCodeCache::JitCodeCache(MemMap* code_map,
       number_of_osr_compilations_(0),
       number_of_deoptimizations_(0),
       number_of_collections_(0),
+      number_of_caller_lookups_(0),
+      number_of_callers_invalidated_(0),
       histogram_stack_map_memory_use_("Memory used for stack maps", 16),
       histogram_code_memory_use_("Memory used for compiled code", 16),
       histogram_profiling_info_memory_use_("Memory used for profiling info", 16) {
@@ -208,7 +210,7 @@ uint8_t* JitCodeCache::CommitCode(Thread* self,
                                   size_t fp_spill_mask,
                                   const uint8_t* code,
                                   size_t code_size,
-                                  ArraySlice<const uint32_t> called_methods,
+                                  ArraySlice<const uint64_t> called_methods,
                                   bool osr) {
   uint8_t* result = CommitCodeInternal(self,
                                        method,
@@ -258,6 +260,22 @@ void JitCodeCache::FreeCode(const void* code_ptr, ArtMethod* method ATTRIBUTE_UN
   // It does nothing if we are not using native debugger.
   DeleteJITCodeEntryForAddress(reinterpret_cast<uintptr_t>(code_ptr));
 
+  // Drop the code from the caller index before its called methods go away.
+  JitXposedHeader* xposed_header = JitXposedHeader::FromCodePointer(code_ptr);
+  if (xposed_header->called_methods.size() != 0) {
+    for (uint64_t called_identity : xposed_header->called_methods) {
+      auto range = callers_by_identity_.equal_range(called_identity);
+      for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == code_ptr) {
+          callers_by_identity_.erase(it);
+          break;
+        }
+      }
+    }
+    FreeData(reinterpret_cast<uint8_t*>(
+        const_cast<uint64_t*>(&xposed_header->called_methods.At(0))));
+  }
+
   // Use the offset directly to prevent sanity check that the method is
   // compiled with optimizing.
   // TODO(ngeoffray): Clean up.
@@ -322,7 +340,7 @@ uint8_t* JitCodeCache::CommitCodeInternal(Thread* self,
                                           size_t fp_spill_mask,
                                           const uint8_t* code,
                                           size_t code_size,
-                                          ArraySlice<const uint32_t> called_methods,
+                                          ArraySlice<const uint64_t> called_methods,
                                           bool osr) {
   size_t alignment = GetInstructionSetAlignment(kRuntimeISA);
   // Ensure the header ends up at expected instruction alignment.
@@ -336,8 +354,8 @@ uint8_t* JitCodeCache::CommitCodeInternal(Thread* self,
       return nullptr;
     }
     memcpy(xposed_memory, &called_methods.At(0), called_methods.DataSize());
-    called_methods = ArraySlice<const uint32_t>(
-        reinterpret_cast<const uint32_t*>(xposed_memory), called_methods.size());
+    called_methods = ArraySlice<const uint64_t>(
+        reinterpret_cast<const uint64_t*>(xposed_memory), called_methods.size());
   }
 
   OatQuickMethodHeader* method_header = nullptr;
@@ -383,6 +401,9 @@ uint8_t* JitCodeCache::CommitCodeInternal(Thread* self,
   {
     MutexLock mu(self, lock_);
     method_code_map_.Put(code_ptr, method);
+    for (uint64_t called_identity : called_methods) {
+      callers_by_identity_.emplace(called_identity, code_ptr);
+    }
     if (osr) {
       number_of_osr_compilations_++;
       osr_code_map_.Put(method, code_ptr);
@@ -448,19 +469,18 @@ void JitCodeCache::MoveObsoleteMethod(ArtMethod* old_method, ArtMethod* new_meth
   }
 }
 
-std::vector<ArtMethod*> JitCodeCache::GetCallers(uint32_t hash) {
+std::vector<ArtMethod*> JitCodeCache::GetCallers(uint64_t identity) {
   std::vector<ArtMethod*> callers;
   MutexLock mu(Thread::Current(), lock_);
-  for (auto& it : method_code_map_) {
-    JitXposedHeader* xposed_header = JitXposedHeader::FromCodePointer(it.first);
-    for (uint32_t called_hash : xposed_header->called_methods) {
-      if (called_hash == hash) {
-        callers.push_back(it.second);
-      } else if (called_hash > hash) {
-        break;
-      }
-    }
+  auto range = callers_by_identity_.equal_range(identity);
+  for (auto it = range.first; it != range.second; ++it) {
+    // Look the method up rather than caching it, MoveObsoleteMethod may have replaced it.
+    auto code_it = method_code_map_.find(it->second);
+    DCHECK(code_it != method_code_map_.end());
+    callers.push_back(code_it->second);
   }
+  number_of_caller_lookups_++;
+  number_of_callers_invalidated_ += callers.size();
   return callers;
 }
 
@@ -1158,7 +1178,10 @@ void JitCodeCache::Dump(std::ostream& os) {
      << "Total number of JIT compilations for on stack replacement: "
         << number_of_osr_compilations_ << "\n"
      << "Total number of deoptimizations: " << number_of_deoptimizations_ << "\n"
-     << "Total number of JIT code cache collections: " << number_of_collections_ << std::endl;
+     << "Total number of JIT code cache collections: " << number_of_collections_ << "\n"
+     << "Total number of Xposed caller lookups: " << number_of_caller_lookups_ << "\n"
+     << "Total number of JIT callers invalidated for Xposed hooks: "
+        << number_of_callers_invalidated_ << std::endl;
   histogram_stack_map_memory_use_.PrintMemoryUse(os);
   histogram_code_memory_use_.PrintMemoryUse(os);
   histogram_profiling_info_memory_use_.PrintMemoryUse(os);
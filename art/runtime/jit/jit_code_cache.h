@@ -17,6 +17,8 @@
 #ifndef ART_RUNTIME_JIT_JIT_CODE_CACHE_H_
 #define ART_RUNTIME_JIT_JIT_CODE_CACHE_H_
 
+#include <map>
+
 #include "instrumentation.h"
 
 #include "atomic.h"
@@ -42,7 +44,8 @@ class ProfilingInfo;
 namespace jit {
 
 struct JitXposedHeader {
-  ArraySlice<const uint32_t> called_methods;
+  // Sorted identities (see DexFile::GetMethodIdentity()) of the methods called by the code.
+  ArraySlice<const uint64_t> called_methods;
 
   static JitXposedHeader* FromCodePointer(const void* code_ptr);
 };
@@ -105,7 +108,7 @@ class JitCodeCache {
                       size_t fp_spill_mask,
                       const uint8_t* code,
                       size_t code_size,
-                      ArraySlice<const uint32_t> called_methods,
+                      ArraySlice<const uint64_t> called_methods,
                       bool osr)
       SHARED_REQUIRES(Locks::mutator_lock_)
       REQUIRES(!lock_);
@@ -209,8 +212,8 @@ class JitCodeCache {
   void MoveObsoleteMethod(ArtMethod* old_method, ArtMethod* new_method)
       REQUIRES(!lock_) REQUIRES(Locks::mutator_lock_);
 
-  // Returns the methods which call the method with the given hash.
-  std::vector<ArtMethod*> GetCallers(uint32_t hash)
+  // Returns the methods which call the method with the given identity.
+  std::vector<ArtMethod*> GetCallers(uint64_t identity)
       SHARED_REQUIRES(Locks::mutator_lock_)
       REQUIRES(!lock_);
 
@@ -233,7 +236,7 @@ class JitCodeCache {
                               size_t fp_spill_mask,
                               const uint8_t* code,
                               size_t code_size,
-                              ArraySlice<const uint32_t> called_methods,
+                              ArraySlice<const uint64_t> called_methods,
                               bool osr)
       REQUIRES(!lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
@@ -306,6 +309,9 @@ class JitCodeCache {
   std::unique_ptr<CodeCacheBitmap> live_bitmap_;
   // Holds compiled code associated to the ArtMethod.
   SafeMap<const void*, ArtMethod*> method_code_map_ GUARDED_BY(lock_);
+  // Maps the identity of a called method to the compiled code calling it, kept in sync with
+  // method_code_map_ so that GetCallers() does not need to walk the whole cache.
+  std::multimap<uint64_t, const void*> callers_by_identity_ GUARDED_BY(lock_);
   // Holds osr compiled code associated to the ArtMethod.
   SafeMap<ArtMethod*, const void*> osr_code_map_ GUARDED_BY(lock_);
   // ProfilingInfo objects we have allocated.
@@ -351,6 +357,12 @@ class JitCodeCache {
   // Number of code cache collections done throughout the lifetime of the JIT.
   size_t number_of_collections_ GUARDED_BY(lock_);
 
+  // Number of GetCallers() lookups done for Xposed hooks.
+  size_t number_of_caller_lookups_ GUARDED_BY(lock_);
+
+  // Number of compiled callers returned by GetCallers() for invalidation.
+  size_t number_of_callers_invalidated_ GUARDED_BY(lock_);
+
   // Histograms for keeping track of stack map size statistics.
   Histogram<uint64_t> histogram_stack_map_memory_use_ GUARDED_BY(lock_);
 
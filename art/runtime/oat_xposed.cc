@@ -4,11 +4,14 @@
 #include <sys/file.h>
 #include <sys/stat.h>
 
+#include "base/stl_util.h"
 #include "base/stringprintf.h"
+#include "dex_file.h"
 #include "mem_map.h"
 #include "oat_file.h"
 #include "os.h"
 #include "ScopedFd.h"
+#include "thread-inl.h"
 
 namespace art {
 
@@ -19,6 +22,7 @@ namespace art {
 
 constexpr uint8_t OatXposedHeader::kOatXposedMagic[4];
 constexpr uint8_t OatXposedHeader::kOatXposedVersion[4];
+constexpr uint8_t OatXposedHeader::kOatXposedVersionWithoutCallerIndex[4];
 
 OatXposedHeader::OatXposedHeader(uint32_t oat_file_checksum, uint32_t dex_file_count)
     : oat_file_checksum_(oat_file_checksum),
@@ -38,12 +42,20 @@ bool OatXposedHeader::IsValid() const {
   if (memcmp(magic_, kOatXposedMagic, sizeof(kOatXposedMagic)) != 0) {
     return false;
   }
-  if (memcmp(version_, kOatXposedVersion, sizeof(kOatXposedVersion)) != 0) {
+  if (memcmp(version_, kOatXposedVersion, sizeof(kOatXposedVersion)) != 0 &&
+      memcmp(version_, kOatXposedVersionWithoutCallerIndex,
+             sizeof(kOatXposedVersionWithoutCallerIndex)) != 0) {
     return false;
   }
   return true;
 }
 
+bool OatXposedHeader::HasCallerIndex() const {
+  DCHECK(IsValid());
+  return memcmp(version_, kOatXposedVersionWithoutCallerIndex,
+                sizeof(kOatXposedVersionWithoutCallerIndex)) != 0;
+}
+
 const char* OatXposedHeader::GetMagic() const {
   CHECK(IsValid());
   return reinterpret_cast<const char*>(magic_);
@@ -151,6 +163,7 @@ bool OatXposedFile::Setup(std::string* error_msg) {
     return false;
   }
 
+  const bool has_caller_index = GetOatXposedHeader().HasCallerIndex();
   uint32_t dex_file_count = GetOatXposedHeader().GetDexFileCount();
   oat_xposed_dex_files_storage_.reserve(dex_file_count);
   for (size_t i = 0; i < dex_file_count; i++) {
@@ -199,6 +212,159 @@ bool OatXposedFile::Setup(std::string* error_msg) {
       return false;
     }
 
+    uint32_t callee_hashes_num = 0;
+    uint32_t callee_hashes_offset = 0;
+    uint32_t callers_index_offset = 0;
+    uint32_t callers_offset = 0;
+    uint32_t callee_secondary_hashes_offset = 0;
+    uint32_t hook_safe_methods_num = 0;
+    uint32_t hook_safe_hashes_offset = 0;
+    uint32_t hook_safe_secondary_hashes_offset = 0;
+    uint32_t colliding_hashes_num = 0;
+    uint32_t colliding_hashes_offset = 0;
+    uint32_t colliding_callers_index_offset = 0;
+    if (has_caller_index) {
+      if (UNLIKELY(!ReadOatXposedDexFileData(*this, &xposed, &callee_hashes_num))) {
+        *error_msg = StringPrintf("In oat file '%s' found OatXposedDexFile #%zu truncated after "
+                                      "callee hashes num",
+                                  GetLocation().c_str(),
+                                  i);
+        return false;
+      }
+
+      if (UNLIKELY(!ReadOatXposedDexFileData(*this, &xposed, &callee_hashes_offset))) {
+        *error_msg = StringPrintf("In oat file '%s' found OatXposedDexFile #%zu truncated after "
+                                      "callee hashes offset",
+                                  GetLocation().c_str(),
+                                  i);
+        return false;
+      }
+
+      if (UNLIKELY(!ReadOatXposedDexFileData(*this, &xposed, &callers_index_offset))) {
+        *error_msg = StringPrintf("In oat file '%s' found OatXposedDexFile #%zu truncated after "
+                                      "callers index offset",
+                                  GetLocation().c_str(),
+                                  i);
+        return false;
+      }
+
+      if (UNLIKELY(!ReadOatXposedDexFileData(*this, &xposed, &callers_offset))) {
+        *error_msg = StringPrintf("In oat file '%s' found OatXposedDexFile #%zu truncated after "
+                                      "callers offset",
+                                  GetLocation().c_str(),
+                                  i);
+        return false;
+      }
+
+      if (UNLIKELY(!ReadOatXposedDexFileData(*this, &xposed, &callee_secondary_hashes_offset))) {
+        *error_msg = StringPrintf("In oat file '%s' found OatXposedDexFile #%zu truncated after "
+                                      "callee secondary hashes offset",
+                                  GetLocation().c_str(),
+                                  i);
+        return false;
+      }
+
+      // The last entry of the callers index is the total number of callers.
+      const size_t callers_index_size = (callee_hashes_num + 1) * sizeof(uint32_t);
+      if (UNLIKELY(callee_hashes_offset + callee_hashes_num * sizeof(uint32_t) > Size() ||
+                   callers_index_offset + callers_index_size > Size() ||
+                   callee_secondary_hashes_offset + callee_hashes_num * sizeof(uint32_t) > Size())) {
+        *error_msg = StringPrintf("In oat file '%s' found OatXposedDexFile #%zu with truncated "
+                                      "callee hashes or callers index",
+                                  GetLocation().c_str(),
+                                  i);
+        return false;
+      }
+      const uint32_t* callers_index =
+          reinterpret_cast<const uint32_t*>(Begin() + callers_index_offset);
+      if (UNLIKELY(callers_offset + callers_index[callee_hashes_num] * sizeof(uint16_t) > Size())) {
+        *error_msg = StringPrintf("In oat file '%s' found OatXposedDexFile #%zu with truncated "
+                                      "callers",
+                                  GetLocation().c_str(),
+                                  i);
+        return false;
+      }
+
+      if (UNLIKELY(!ReadOatXposedDexFileData(*this, &xposed, &hook_safe_methods_num))) {
+        *error_msg = StringPrintf("In oat file '%s' found OatXposedDexFile #%zu truncated after "
+                                      "hook-safe methods num",
+                                  GetLocation().c_str(),
+                                  i);
+        return false;
+      }
+
+      if (UNLIKELY(!ReadOatXposedDexFileData(*this, &xposed, &hook_safe_hashes_offset))) {
+        *error_msg = StringPrintf("In oat file '%s' found OatXposedDexFile #%zu truncated after "
+                                      "hook-safe hashes offset",
+                                  GetLocation().c_str(),
+                                  i);
+        return false;
+      }
+
+      if (UNLIKELY(!ReadOatXposedDexFileData(*this, &xposed, &hook_safe_secondary_hashes_offset))) {
+        *error_msg = StringPrintf("In oat file '%s' found OatXposedDexFile #%zu truncated after "
+                                      "hook-safe secondary hashes offset",
+                                  GetLocation().c_str(),
+                                  i);
+        return false;
+      }
+
+      const size_t hook_safe_size = hook_safe_methods_num * sizeof(uint32_t);
+      if (UNLIKELY(hook_safe_hashes_offset + hook_safe_size > Size() ||
+                   hook_safe_secondary_hashes_offset + hook_safe_size > Size())) {
+        *error_msg = StringPrintf("In oat file '%s' found OatXposedDexFile #%zu with truncated "
+                                      "hook-safe methods",
+                                  GetLocation().c_str(),
+                                  i);
+        return false;
+      }
+
+      if (UNLIKELY(!ReadOatXposedDexFileData(*this, &xposed, &colliding_hashes_num))) {
+        *error_msg = StringPrintf("In oat file '%s' found OatXposedDexFile #%zu truncated after "
+                                      "colliding hashes num",
+                                  GetLocation().c_str(),
+                                  i);
+        return false;
+      }
+
+      if (UNLIKELY(!ReadOatXposedDexFileData(*this, &xposed, &colliding_hashes_offset))) {
+        *error_msg = StringPrintf("In oat file '%s' found OatXposedDexFile #%zu truncated after "
+                                      "colliding hashes offset",
+                                  GetLocation().c_str(),
+                                  i);
+        return false;
+      }
+
+      if (UNLIKELY(!ReadOatXposedDexFileData(*this, &xposed, &colliding_callers_index_offset))) {
+        *error_msg = StringPrintf("In oat file '%s' found OatXposedDexFile #%zu truncated after "
+                                      "colliding callers index offset",
+                                  GetLocation().c_str(),
+                                  i);
+        return false;
+      }
+
+      // The merged callers follow the callers of the single identities.
+      const size_t colliding_callers_index_size = (colliding_hashes_num + 1) * sizeof(uint32_t);
+      if (UNLIKELY(colliding_hashes_offset + colliding_hashes_num * sizeof(uint32_t) > Size() ||
+                   colliding_callers_index_offset + colliding_callers_index_size > Size())) {
+        *error_msg = StringPrintf("In oat file '%s' found OatXposedDexFile #%zu with truncated "
+                                      "colliding hashes or callers index",
+                                  GetLocation().c_str(),
+                                  i);
+        return false;
+      }
+      const uint32_t* colliding_callers_index =
+          reinterpret_cast<const uint32_t*>(Begin() + colliding_callers_index_offset);
+      if (UNLIKELY(callers_offset + colliding_callers_index[colliding_hashes_num] *
+                       sizeof(uint16_t) > Size())) {
+        *error_msg = StringPrintf("In oat file '%s' found OatXposedDexFile #%zu with truncated "
+                                      "colliding callers",
+                                  GetLocation().c_str(),
+                                  i);
+        return false;
+      }
+    }
+
     // Create the OatXposedDexFile and add it to the owning container.
     OatXposedDexFile* oat_xposed_dex_file = new OatXposedDexFile(
         num_methods,
@@ -206,7 +372,27 @@ bool OatXposedFile::Setup(std::string* error_msg) {
         reinterpret_cast<const uint32_t*>(Begin() + called_methods_offset),
         ArraySlice<const uint32_t>(
             reinterpret_cast<const uint32_t*>(Begin() + called_methods_foreign_hashes_offset),
-            called_methods_foreign_hashes_num));
+            called_methods_foreign_hashes_num),
+        ArraySlice<const uint32_t>(
+            reinterpret_cast<const uint32_t*>(Begin() + callee_hashes_offset),
+            callee_hashes_num),
+        has_caller_index
+            ? reinterpret_cast<const uint32_t*>(Begin() + callee_secondary_hashes_offset)
+            : nullptr,
+        has_caller_index ? reinterpret_cast<const uint32_t*>(Begin() + callers_index_offset)
+                         : nullptr,
+        has_caller_index ? reinterpret_cast<const uint16_t*>(Begin() + callers_offset)
+                         : nullptr,
+        ArraySlice<const uint32_t>(
+            reinterpret_cast<const uint32_t*>(Begin() + hook_safe_hashes_offset),
+            hook_safe_methods_num),
+        reinterpret_cast<const uint32_t*>(Begin() + hook_safe_secondary_hashes_offset),
+        ArraySlice<const uint32_t>(
+            reinterpret_cast<const uint32_t*>(Begin() + colliding_hashes_offset),
+            colliding_hashes_num),
+        has_caller_index
+            ? reinterpret_cast<const uint32_t*>(Begin() + colliding_callers_index_offset)
+            : nullptr);
 
     oat_xposed_dex_files_storage_.push_back(oat_xposed_dex_file);
   }
@@ -237,11 +423,35 @@ bool OatXposedFile::Validate(const OatFile& oat_file, std::string* error_msg) co
 OatXposedDexFile::OatXposedDexFile(uint32_t num_methods,
                                    const uint16_t* called_methods_num,
                                    const uint32_t* called_methods,
-                                   ArraySlice<const uint32_t> foreign_hashes)
+                                   ArraySlice<const uint32_t> foreign_hashes,
+                                   ArraySlice<const uint32_t> callee_hashes,
+                                   const uint32_t* callee_secondary_hashes,
+                                   const uint32_t* callers_index,
+                                   const uint16_t* callers,
+                                   ArraySlice<const uint32_t> hook_safe_hashes,
+                                   const uint32_t* hook_safe_secondary_hashes,
+                                   ArraySlice<const uint32_t> colliding_hashes,
+                                   const uint32_t* colliding_callers_index)
     : num_methods_(num_methods),
       called_methods_num_(called_methods_num),
       called_methods_(called_methods),
-      foreign_hashes_(foreign_hashes) {
+      foreign_hashes_(foreign_hashes),
+      callee_hashes_(callee_hashes),
+      callee_secondary_hashes_(callee_secondary_hashes),
+      callers_index_(callers_index),
+      callers_(callers),
+      hook_safe_hashes_(hook_safe_hashes),
+      hook_safe_secondary_hashes_(hook_safe_secondary_hashes),
+      colliding_hashes_(colliding_hashes),
+      colliding_callers_index_(colliding_callers_index),
+      fallback_lock_("OatXposedDexFile fallback caller index lock", kDefaultMutexLevel),
+      fallback_built_(false) {
+  called_methods_index_.reserve(num_methods_);
+  uint32_t start_index = 0;
+  for (uint32_t i = 0; i < num_methods_; ++i) {
+    called_methods_index_.push_back(start_index);
+    start_index += called_methods_num_[i];
+  }
 }
 
 ArraySlice<const uint32_t> OatXposedDexFile::GetCalledMethods(uint32_t method_index) const {
@@ -250,31 +460,110 @@ ArraySlice<const uint32_t> OatXposedDexFile::GetCalledMethods(uint32_t method_in
     return ArraySlice<const uint32_t>();
   }
 
-  // Calculate the start index by summing up the number of called methods for all previous methods.
-  const uint16_t* num_called_methods_pointer = called_methods_num_;
-  size_t start_index = 0;
-  for (size_t i = 0; i < method_index; ++i) {
-    start_index += *num_called_methods_pointer;
-    num_called_methods_pointer++;
+  return ArraySlice<const uint32_t>(called_methods_ + called_methods_index_[method_index],
+                                    called_methods_num_[method_index]);
+}
+
+static ArraySlice<const uint16_t> LookupCallers(ArraySlice<const uint32_t> callee_hashes,
+                                                const uint32_t* callers_index,
+                                                const uint16_t* callers,
+                                                uint32_t hash) {
+  // Entries for the same hash are adjacent, and so are their callers.
+  auto range = std::equal_range(callee_hashes.begin(), callee_hashes.end(), hash);
+  size_t first = range.first - callee_hashes.begin();
+  size_t last = range.second - callee_hashes.begin();
+  return ArraySlice<const uint16_t>(callers + callers_index[first],
+                                    callers_index[last] - callers_index[first]);
+}
+
+ArraySlice<const uint16_t> OatXposedDexFile::GetCallers(uint32_t hash) const {
+  if (LIKELY(callers_index_ != nullptr)) {
+    // With one entry per callee identity, colliding hashes have several lists of callers, which
+    // may overlap. Their union is stored separately.
+    auto range = std::equal_range(callee_hashes_.begin(), callee_hashes_.end(), hash);
+    size_t first = range.first - callee_hashes_.begin();
+    size_t last = range.second - callee_hashes_.begin();
+    if (LIKELY(last - first <= 1)) {
+      return ArraySlice<const uint16_t>(callers_ + callers_index_[first],
+                                        callers_index_[last] - callers_index_[first]);
+    }
+    return LookupCallers(colliding_hashes_, colliding_callers_index_, callers_, hash);
   }
 
-  return ArraySlice<const uint32_t>(called_methods_ + start_index, *num_called_methods_pointer);
+  MutexLock mu(Thread::Current(), fallback_lock_);
+  if (!fallback_built_) {
+    BuildFallbackCallerIndex();
+    fallback_built_ = true;
+  }
+  return LookupCallers(ArraySlice<const uint32_t>(fallback_callee_hashes_.data(),
+                                                  fallback_callee_hashes_.size()),
+                       fallback_callers_index_.data(),
+                       fallback_callers_.data(),
+                       hash);
+}
+
+ArraySlice<const uint16_t> OatXposedDexFile::GetCallersOfIdentity(uint64_t identity) const {
+  uint32_t hash = DexFile::GetMethodHashFromIdentity(identity);
+  if (UNLIKELY(callers_index_ == nullptr)) {
+    return GetCallers(hash);
+  }
+
+  // Entries are sorted by hash first, then by secondary hash.
+  auto range = std::equal_range(callee_hashes_.begin(), callee_hashes_.end(), hash);
+  size_t first = range.first - callee_hashes_.begin();
+  size_t last = range.second - callee_hashes_.begin();
+  const uint32_t secondary_hash = static_cast<uint32_t>(identity);
+  const uint32_t* it = std::lower_bound(callee_secondary_hashes_ + first,
+                                        callee_secondary_hashes_ + last,
+                                        secondary_hash);
+  if (it == callee_secondary_hashes_ + last || *it != secondary_hash) {
+    return ArraySlice<const uint16_t>();
+  }
+  size_t i = it - callee_secondary_hashes_;
+  return ArraySlice<const uint16_t>(callers_ + callers_index_[i],
+                                    callers_index_[i + 1] - callers_index_[i]);
 }
 
-std::vector<uint16_t> OatXposedDexFile::GetCallers(uint32_t hash) const {
-  std::vector<uint16_t> callers;
+bool OatXposedDexFile::IsHookSafe(uint64_t identity) const {
+  if (hook_safe_hashes_.size() == 0) {
+    return false;
+  }
+  uint32_t hash = DexFile::GetMethodHashFromIdentity(identity);
+  auto range = std::equal_range(hook_safe_hashes_.begin(), hook_safe_hashes_.end(), hash);
+  size_t first = range.first - hook_safe_hashes_.begin();
+  size_t last = range.second - hook_safe_hashes_.begin();
+  return std::binary_search(hook_safe_secondary_hashes_ + first,
+                            hook_safe_secondary_hashes_ + last,
+                            static_cast<uint32_t>(identity));
+}
+
+void OatXposedDexFile::BuildFallbackCallerIndex() const {
+  // Collect (callee hash, caller index) pairs. Methods are visited in ascending order, so the
+  // callers of each hash will be sorted after a stable sort by hash.
+  std::vector<std::pair<uint32_t, uint16_t>> edges;
   const uint32_t* call_methods_pointer = called_methods_;
-  const uint16_t* num_called_methods_pointer = called_methods_num_;
   for (uint32_t method_index = 0; method_index < num_methods_; ++method_index) {
-    size_t num = *num_called_methods_pointer;
-    const uint32_t* call_methods_pointer_next = call_methods_pointer + num;
-    if (num > 0 && std::binary_search(call_methods_pointer, call_methods_pointer_next, hash)) {
-      callers.push_back(method_index);
+    size_t num = called_methods_num_[method_index];
+    for (size_t i = 0; i < num; ++i) {
+      edges.emplace_back(call_methods_pointer[i], method_index);
+    }
+    call_methods_pointer += num;
+  }
+  std::stable_sort(edges.begin(), edges.end(),
+                   [](const std::pair<uint32_t, uint16_t>& lhs,
+                      const std::pair<uint32_t, uint16_t>& rhs) {
+                     return lhs.first < rhs.first;
+                   });
+
+  fallback_callers_.reserve(edges.size());
+  for (const auto& edge : edges) {
+    if (fallback_callee_hashes_.empty() || fallback_callee_hashes_.back() != edge.first) {
+      fallback_callee_hashes_.push_back(edge.first);
+      fallback_callers_index_.push_back(fallback_callers_.size());
     }
-    call_methods_pointer = call_methods_pointer_next;
-    ++num_called_methods_pointer;
+    fallback_callers_.push_back(edge.second);
   }
-  return callers;
+  fallback_callers_index_.push_back(fallback_callers_.size());
 }
 
 }  // namespace art
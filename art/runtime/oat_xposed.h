@@ -7,6 +7,7 @@
 #include "base/array_slice.h"
 #include "base/logging.h"
 #include "base/macros.h"
+#include "base/mutex.h"
 
 namespace art {
 
@@ -17,7 +18,10 @@ class OatXposedDexFile;
 class OatXposedHeader {
  public:
   static constexpr uint8_t kOatXposedMagic[] = { 'X', 'p', 'o', '\n' };
-  static constexpr uint8_t kOatXposedVersion[] = { '0', '0', '1', '\0' };
+  static constexpr uint8_t kOatXposedVersion[] = { '0', '0', '5', '\0' };
+  // Version without the callee hash -> callers index and everything added after it, still
+  // accepted by the reader.
+  static constexpr uint8_t kOatXposedVersionWithoutCallerIndex[] = { '0', '0', '1', '\0' };
 
   OatXposedHeader(uint32_t oat_file_checksum, uint32_t dex_file_count);
 
@@ -25,6 +29,9 @@ class OatXposedHeader {
 
   const char* GetMagic() const;
 
+  // Returns whether this is the current version, rather than version 001.
+  bool HasCallerIndex() const;
+
   uint32_t GetOatFileChecksum() const {
     DCHECK(IsValid());
     return oat_file_checksum_;
@@ -106,24 +113,76 @@ class OatXposedDexFile {
   // Returns the hashes of methods called by the given method.
   ArraySlice<const uint32_t> GetCalledMethods(uint32_t method_index) const;
 
-  // Returns the indexes of the methods calling a method with the given hash.
-  std::vector<uint16_t> GetCallers(uint32_t hash) const;
+  // Returns the indexes of the methods calling a method with the given hash, sorted ascending and
+  // unique. For version 001 files, the index is built in memory on the first call.
+  ArraySlice<const uint16_t> GetCallers(uint32_t hash) const REQUIRES(!fallback_lock_);
+
+  // Returns the indexes of the methods calling the method with the given identity (see
+  // DexFile::GetMethodIdentity()), sorted ascending. Version 001 files can't tell colliding
+  // methods apart, so this returns all callers of the hash for them.
+  ArraySlice<const uint16_t> GetCallersOfIdentity(uint64_t identity) const
+      REQUIRES(!fallback_lock_);
 
   // Returns whether a method with the given hash is called, but not declared in the dex file.
   bool HasForeignHash(uint32_t hash) const {
     return std::binary_search(foreign_hashes_.begin(), foreign_hashes_.end(), hash);
   }
 
+  // Returns whether the method with the given identity was declared as hooked at compile time
+  // (dex2oat --hooked-methods). Compiled code of this dex file never bypasses such a method.
+  bool IsHookSafe(uint64_t identity) const;
+
  private:
   OatXposedDexFile(uint32_t num_methods,
                    const uint16_t* called_methods_num,
                    const uint32_t* called_methods,
-                   ArraySlice<const uint32_t> foreign_hashes);
+                   ArraySlice<const uint32_t> foreign_hashes,
+                   ArraySlice<const uint32_t> callee_hashes,
+                   const uint32_t* callee_secondary_hashes,
+                   const uint32_t* callers_index,
+                   const uint16_t* callers,
+                   ArraySlice<const uint32_t> hook_safe_hashes,
+                   const uint32_t* hook_safe_secondary_hashes,
+                   ArraySlice<const uint32_t> colliding_hashes,
+                   const uint32_t* colliding_callers_index);
+
+  // Builds the callers index from the called methods lists, for version 001 files.
+  void BuildFallbackCallerIndex() const REQUIRES(fallback_lock_);
 
   uint32_t num_methods_;
   const uint16_t* called_methods_num_;
   const uint32_t* called_methods_;
   ArraySlice<const uint32_t> foreign_hashes_;
+  // Start index of the called methods of each method in called_methods_, computed once when the
+  // section is set up (4 bytes per method), so GetCalledMethods() is constant time.
+  std::vector<uint32_t> called_methods_index_;
+
+  // Inverted index: sorted callee identities, split into hashes and secondary hashes, and for each
+  // of them the start offset of its callers in callers_ (with one extra entry at the end). A hash
+  // can appear multiple times, each with a different secondary hash. Null/empty for version 001
+  // files.
+  ArraySlice<const uint32_t> callee_hashes_;
+  const uint32_t* callee_secondary_hashes_;
+  const uint32_t* callers_index_;
+  const uint16_t* callers_;
+
+  // Sorted identities of the hook-safe methods, split into hashes and secondary hashes. Empty for
+  // version 001 files.
+  ArraySlice<const uint32_t> hook_safe_hashes_;
+  const uint32_t* hook_safe_secondary_hashes_;
+
+  // Sorted hashes shared by several callee identities, and for each of them the start offset of
+  // the sorted, unique union of their callers in callers_ (with one extra entry at the end).
+  // Empty/null for version 001 files.
+  ArraySlice<const uint32_t> colliding_hashes_;
+  const uint32_t* colliding_callers_index_;
+
+  // Owning storage for the in-memory index of version 001 files.
+  mutable Mutex fallback_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  mutable bool fallback_built_ GUARDED_BY(fallback_lock_);
+  mutable std::vector<uint32_t> fallback_callee_hashes_ GUARDED_BY(fallback_lock_);
+  mutable std::vector<uint32_t> fallback_callers_index_ GUARDED_BY(fallback_lock_);
+  mutable std::vector<uint16_t> fallback_callers_ GUARDED_BY(fallback_lock_);
 
   friend class OatXposedFile;
   DISALLOW_COPY_AND_ASSIGN(OatXposedDexFile);
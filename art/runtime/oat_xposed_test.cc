@@ -0,0 +1,330 @@
+#include "oat_xposed.h"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "base/histogram-inl.h"
+#include "base/time_utils.h"
+#include "common_runtime_test.h"
+#include "dex_file.h"
+
+namespace art {
+
+class OatXposedTest : public CommonRuntimeTest {
+ protected:
+  // Format versions of the .xposed section, see OatXposedHeader.
+  enum Version {
+    kVersionWithoutCallerIndex,
+    kVersionCurrent,
+  };
+
+  static uint64_t Identity(uint32_t hash, uint32_t secondary_hash) {
+    return (static_cast<uint64_t>(hash) << 32) | secondary_hash;
+  }
+
+  static std::vector<std::vector<uint64_t>> ToIdentities(
+      const std::vector<std::vector<uint32_t>>& called_methods) {
+    std::vector<std::vector<uint64_t>> identities(called_methods.size());
+    for (size_t i = 0; i < called_methods.size(); ++i) {
+      for (uint32_t hash : called_methods[i]) {
+        identities[i].push_back(Identity(hash, 0u));
+      }
+    }
+    return identities;
+  }
+
+  // Builds a section for a single dex file. `called_methods` contains the sorted called method
+  // identities for each method index, like CompiledMethod::GetCalledMethods(). `hook_safe` contains
+  // the sorted identities of the methods declared as hooked.
+  static std::vector<uint32_t> BuildSection(
+      const std::vector<std::vector<uint64_t>>& called_methods,
+      Version version,
+      const std::vector<uint64_t>& hook_safe = std::vector<uint64_t>()) {
+    std::vector<uint16_t> called_methods_num;
+    std::vector<uint32_t> all_called_methods;
+    std::map<uint64_t, std::vector<uint16_t>> callers_map;
+    for (size_t i = 0; i < called_methods.size(); ++i) {
+      uint16_t num = 0;
+      for (uint64_t identity : called_methods[i]) {
+        uint32_t hash = DexFile::GetMethodHashFromIdentity(identity);
+        if (num == 0 || all_called_methods.back() != hash) {
+          all_called_methods.push_back(hash);
+          ++num;
+        }
+        std::vector<uint16_t>& callers = callers_map[identity];
+        if (callers.empty() || callers.back() != i) {
+          callers.push_back(i);
+        }
+      }
+      called_methods_num.push_back(num);
+    }
+    std::vector<uint32_t> callee_hashes;
+    std::vector<uint32_t> callee_secondary_hashes;
+    std::vector<uint32_t> callers_index;
+    std::vector<uint16_t> callers;
+    for (const auto& entry : callers_map) {
+      callee_hashes.push_back(DexFile::GetMethodHashFromIdentity(entry.first));
+      callee_secondary_hashes.push_back(static_cast<uint32_t>(entry.first));
+      callers_index.push_back(callers.size());
+      callers.insert(callers.end(), entry.second.begin(), entry.second.end());
+    }
+    callers_index.push_back(callers.size());
+    std::vector<uint32_t> colliding_hashes;
+    std::vector<uint32_t> colliding_callers_index;
+    for (size_t first = 0, last; first < callee_hashes.size(); first = last) {
+      last = first + 1;
+      while (last < callee_hashes.size() && callee_hashes[last] == callee_hashes[first]) {
+        ++last;
+      }
+      if (last - first > 1) {
+        std::vector<uint16_t> merged(callers.begin() + callers_index[first],
+                                     callers.begin() + callers_index[last]);
+        std::sort(merged.begin(), merged.end());
+        merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+        colliding_hashes.push_back(callee_hashes[first]);
+        colliding_callers_index.push_back(callers.size());
+        callers.insert(callers.end(), merged.begin(), merged.end());
+      }
+    }
+    colliding_callers_index.push_back(callers.size());
+    // Treat the highest hash as declared in another dex file.
+    std::vector<uint32_t> foreign_hashes;
+    if (!callee_hashes.empty()) {
+      foreign_hashes.push_back(callee_hashes.back());
+    }
+
+    const size_t header_words = sizeof(OatXposedHeader) / sizeof(uint32_t);
+    std::vector<uint32_t> hook_safe_hashes;
+    std::vector<uint32_t> hook_safe_secondary_hashes;
+    for (uint64_t identity : hook_safe) {
+      hook_safe_hashes.push_back(DexFile::GetMethodHashFromIdentity(identity));
+      hook_safe_secondary_hashes.push_back(static_cast<uint32_t>(identity));
+    }
+
+    const size_t dex_header_words = (version == kVersionCurrent) ? 16 : 5;
+    std::vector<uint32_t> data(header_words + dex_header_words);
+    OatXposedHeader header(0, 1);
+    memcpy(data.data(), &header, sizeof(header));
+    if (version == kVersionWithoutCallerIndex) {
+      memcpy(reinterpret_cast<uint8_t*>(data.data()) + 4,
+             OatXposedHeader::kOatXposedVersionWithoutCallerIndex,
+             sizeof(OatXposedHeader::kOatXposedVersionWithoutCallerIndex));
+    }
+
+    auto append_u32 = [&data](const std::vector<uint32_t>& values) {
+      uint32_t offset = data.size() * sizeof(uint32_t);
+      data.insert(data.end(), values.begin(), values.end());
+      return offset;
+    };
+    auto append_u16 = [&data](const std::vector<uint16_t>& values) {
+      uint32_t offset = data.size() * sizeof(uint32_t);
+      data.resize(data.size() + RoundUp(values.size(), 2) / 2);
+      memcpy(reinterpret_cast<uint8_t*>(data.data()) + offset,
+             values.data(),
+             values.size() * sizeof(uint16_t));
+      return offset;
+    };
+
+    std::vector<uint32_t> fields;
+    fields.push_back(called_methods_num.size());
+    fields.push_back(append_u16(called_methods_num));
+    fields.push_back(append_u32(all_called_methods));
+    fields.push_back(foreign_hashes.size());
+    fields.push_back(append_u32(foreign_hashes));
+    if (version == kVersionCurrent) {
+      fields.push_back(callee_hashes.size());
+      fields.push_back(append_u32(callee_hashes));
+      fields.push_back(append_u32(callers_index));
+      fields.push_back(append_u16(callers));
+      fields.push_back(append_u32(callee_secondary_hashes));
+      fields.push_back(hook_safe_hashes.size());
+      fields.push_back(append_u32(hook_safe_hashes));
+      fields.push_back(append_u32(hook_safe_secondary_hashes));
+      fields.push_back(colliding_hashes.size());
+      fields.push_back(append_u32(colliding_hashes));
+      fields.push_back(append_u32(colliding_callers_index));
+    }
+    std::copy(fields.begin(), fields.end(), data.begin() + header_words);
+    return data;
+  }
+
+  static std::unique_ptr<OatXposedFile> OpenSection(const std::vector<uint32_t>& data) {
+    const uint8_t* begin = reinterpret_cast<const uint8_t*>(data.data());
+    std::unique_ptr<OatXposedFile> file(
+        new OatXposedFile("test.xposed", begin, begin + data.size() * sizeof(uint32_t)));
+    std::string error_msg;
+    EXPECT_TRUE(file->Setup(&error_msg)) << error_msg;
+    EXPECT_EQ(1u, file->GetOatXposedDexFiles().size());
+    return file;
+  }
+
+  static std::vector<uint16_t> Callers(const OatXposedDexFile* dex_file, uint32_t hash) {
+    ArraySlice<const uint16_t> callers = dex_file->GetCallers(hash);
+    return std::vector<uint16_t>(callers.begin(), callers.end());
+  }
+
+  static std::vector<uint16_t> CallersOfIdentity(const OatXposedDexFile* dex_file,
+                                                 uint64_t identity) {
+    ArraySlice<const uint16_t> callers = dex_file->GetCallersOfIdentity(identity);
+    return std::vector<uint16_t>(callers.begin(), callers.end());
+  }
+
+  static std::vector<uint32_t> CalledMethods(const OatXposedDexFile* dex_file, uint32_t index) {
+    ArraySlice<const uint32_t> called_methods = dex_file->GetCalledMethods(index);
+    return std::vector<uint32_t>(called_methods.begin(), called_methods.end());
+  }
+
+  void CheckSection(Version version) {
+    std::vector<uint32_t> data =
+        BuildSection(ToIdentities({ { 10, 20 }, {}, { 20, 30 }, { 10 } }), version);
+    std::unique_ptr<OatXposedFile> file = OpenSection(data);
+    EXPECT_EQ(version == kVersionCurrent, file->GetOatXposedHeader().HasCallerIndex());
+    const OatXposedDexFile* dex_file = file->GetOatXposedDexFiles()[0];
+
+    EXPECT_EQ(std::vector<uint16_t>({ 0, 3 }), Callers(dex_file, 10));
+    EXPECT_EQ(std::vector<uint16_t>({ 0, 2 }), Callers(dex_file, 20));
+    EXPECT_EQ(std::vector<uint16_t>({ 2 }), Callers(dex_file, 30));
+    EXPECT_TRUE(Callers(dex_file, 5).empty());
+    EXPECT_TRUE(Callers(dex_file, 40).empty());
+    EXPECT_TRUE(dex_file->HasForeignHash(30));
+    EXPECT_FALSE(dex_file->HasForeignHash(20));
+    EXPECT_TRUE(CalledMethods(dex_file, 1).empty());
+    EXPECT_EQ(std::vector<uint32_t>({ 20, 30 }), CalledMethods(dex_file, 2));
+    EXPECT_EQ(std::vector<uint32_t>({ 10 }), CalledMethods(dex_file, 3));
+  }
+};
+
+TEST_F(OatXposedTest, CallerIndex) {
+  CheckSection(kVersionCurrent);
+}
+
+TEST_F(OatXposedTest, CallerIndexFallback) {
+  CheckSection(kVersionWithoutCallerIndex);
+}
+
+// Methods 0 and 1 call different methods with the same hash, method 2 calls both of them.
+TEST_F(OatXposedTest, CalleeIdentities) {
+  std::vector<std::vector<uint64_t>> called_methods = {
+    { Identity(10, 1) },
+    { Identity(10, 2) },
+    { Identity(10, 1), Identity(10, 2) },
+    { Identity(20, 1) },
+  };
+
+  std::vector<uint32_t> data = BuildSection(called_methods, kVersionCurrent);
+  std::unique_ptr<OatXposedFile> file = OpenSection(data);
+  const OatXposedDexFile* dex_file = file->GetOatXposedDexFiles()[0];
+  EXPECT_EQ(std::vector<uint16_t>({ 0, 2 }), CallersOfIdentity(dex_file, Identity(10, 1)));
+  EXPECT_EQ(std::vector<uint16_t>({ 1, 2 }), CallersOfIdentity(dex_file, Identity(10, 2)));
+  EXPECT_TRUE(CallersOfIdentity(dex_file, Identity(10, 3)).empty());
+  EXPECT_EQ(std::vector<uint16_t>({ 3 }), CallersOfIdentity(dex_file, Identity(20, 1)));
+  EXPECT_TRUE(CallersOfIdentity(dex_file, Identity(20, 0)).empty());
+  // The callers of the hash are sorted and unique, even though method 2 calls both methods.
+  EXPECT_EQ(std::vector<uint16_t>({ 0, 1, 2 }), Callers(dex_file, 10));
+  EXPECT_EQ(std::vector<uint16_t>({ 3 }), Callers(dex_file, 20));
+  EXPECT_EQ(std::vector<uint32_t>({ 10 }), CalledMethods(dex_file, 2));
+
+  // Without the identities, all callers of the hash are returned.
+  std::vector<uint32_t> old_data = BuildSection(called_methods, kVersionWithoutCallerIndex);
+  file = OpenSection(old_data);
+  dex_file = file->GetOatXposedDexFiles()[0];
+  EXPECT_EQ(std::vector<uint16_t>({ 0, 1, 2 }), CallersOfIdentity(dex_file, Identity(10, 1)));
+  EXPECT_EQ(std::vector<uint16_t>({ 0, 1, 2 }), CallersOfIdentity(dex_file, Identity(10, 3)));
+}
+
+TEST_F(OatXposedTest, HookSafeMethods) {
+  std::vector<std::vector<uint64_t>> called_methods = {
+    { Identity(10, 1) },
+    { Identity(20, 1) },
+  };
+  std::vector<uint64_t> hook_safe = { Identity(30, 1), Identity(30, 2), Identity(40, 5) };
+
+  std::vector<uint32_t> data = BuildSection(called_methods, kVersionCurrent, hook_safe);
+  std::unique_ptr<OatXposedFile> file = OpenSection(data);
+  const OatXposedDexFile* dex_file = file->GetOatXposedDexFiles()[0];
+  EXPECT_TRUE(dex_file->IsHookSafe(Identity(30, 1)));
+  EXPECT_TRUE(dex_file->IsHookSafe(Identity(30, 2)));
+  EXPECT_TRUE(dex_file->IsHookSafe(Identity(40, 5)));
+  EXPECT_FALSE(dex_file->IsHookSafe(Identity(30, 3)));
+  EXPECT_FALSE(dex_file->IsHookSafe(Identity(10, 1)));
+  EXPECT_FALSE(dex_file->IsHookSafe(Identity(40, 1)));
+  EXPECT_EQ(std::vector<uint16_t>({ 0 }), CallersOfIdentity(dex_file, Identity(10, 1)));
+
+  // Older files don't list any hook-safe methods.
+  std::vector<uint32_t> old_data = BuildSection(called_methods, kVersionWithoutCallerIndex);
+  file = OpenSection(old_data);
+  dex_file = file->GetOatXposedDexFiles()[0];
+  EXPECT_FALSE(dex_file->IsHookSafe(Identity(30, 1)));
+  EXPECT_EQ(std::vector<uint16_t>({ 1 }), CallersOfIdentity(dex_file, Identity(20, 1)));
+}
+
+// The called methods of a dex file with the maximum number of methods.
+static std::vector<std::vector<uint32_t>> ManyCalledMethods() {
+  const size_t kNumMethods = 0xffff;
+  std::vector<std::vector<uint32_t>> called_methods(kNumMethods);
+  for (size_t i = 0; i < kNumMethods; ++i) {
+    for (uint32_t j = 0; j < i % 8; ++j) {
+      called_methods[i].push_back((i * 7 + j * 13) % kNumMethods * 8 + j);
+    }
+    std::sort(called_methods[i].begin(), called_methods[i].end());
+  }
+  return called_methods;
+}
+
+TEST_F(OatXposedTest, CalledMethodsOfManyMethods) {
+  std::vector<std::vector<uint32_t>> called_methods = ManyCalledMethods();
+  std::vector<uint32_t> data = BuildSection(ToIdentities(called_methods), kVersionCurrent);
+  std::unique_ptr<OatXposedFile> file = OpenSection(data);
+  const OatXposedDexFile* dex_file = file->GetOatXposedDexFiles()[0];
+  for (uint32_t i = 0; i < called_methods.size(); ++i) {
+    ASSERT_EQ(called_methods[i], CalledMethods(dex_file, i)) << i;
+  }
+}
+
+// Simulates linking all methods of a dex file with the maximum number of methods, checking their
+// called methods against the hooked hashes the way ClassLinker::ShouldIgnoreAotCode() does.
+// Too slow for every run, use --gtest_also_run_disabled_tests.
+TEST_F(OatXposedTest, DISABLED_LinkSpeed) {
+  std::vector<std::vector<uint32_t>> called_methods = ManyCalledMethods();
+  const size_t kNumMethods = called_methods.size();
+  std::vector<uint32_t> data = BuildSection(ToIdentities(called_methods), kVersionCurrent);
+  std::unique_ptr<OatXposedFile> file = OpenSection(data);
+  const OatXposedDexFile* dex_file = file->GetOatXposedDexFiles()[0];
+
+  for (size_t num_hooks : { 0u, 500u }) {
+    std::vector<uint32_t> hooked_hashes;
+    for (size_t i = 0; i < num_hooks; ++i) {
+      hooked_hashes.push_back(called_methods[i * 97 % kNumMethods].empty()
+          ? 0u : called_methods[i * 97 % kNumMethods][0]);
+    }
+    std::sort(hooked_hashes.begin(), hooked_hashes.end());
+
+    std::unique_ptr<Histogram<uint64_t>> hist(
+        new Histogram<uint64_t>(num_hooks == 0 ? "LinkWithoutHooks" : "LinkWithHooks", 5));
+    size_t ignored = 0;
+    for (size_t round = 0; round < 16; ++round) {
+      uint64_t start_time = NanoTime();
+      for (uint32_t i = 0; i < kNumMethods; ++i) {
+        ArraySlice<const uint32_t> called = dex_file->GetCalledMethods(i);
+        ASSERT_EQ(called_methods[i].size(), called.size());
+        if (called.size() != 0 && !hooked_hashes.empty()) {
+          for (uint32_t hash : called) {
+            if (std::binary_search(hooked_hashes.begin(), hooked_hashes.end(), hash)) {
+              ++ignored;
+              break;
+            }
+          }
+        }
+      }
+      hist->AddValue(NanoTime() - start_time);
+    }
+    EXPECT_EQ(num_hooks == 0, ignored == 0);
+
+    Histogram<uint64_t>::CumulativeData data_hist;
+    hist->CreateHistogram(&data_hist);
+    hist->PrintConfidenceIntervals(std::cout, 0.99, data_hist);
+  }
+}
+
+}  // namespace art
@@ -42,7 +42,8 @@ QuickExceptionHandler::QuickExceptionHandler(Thread* self, bool is_deoptimizatio
       context_(self->GetLongJumpContext()),
       is_deoptimization_(is_deoptimization),
       method_tracing_active_(is_deoptimization ||
-                             Runtime::Current()->GetInstrumentation()->AreExitStubsInstalled()),
+                             Runtime::Current()->GetInstrumentation()->AreExitStubsInstalled() ||
+                             !self->GetInstrumentationStack()->empty()),
       handler_quick_frame_(nullptr),
       handler_quick_frame_pc_(0),
       handler_method_header_(nullptr),
@@ -334,7 +334,95 @@ class ArgArray {
     return true;
   }
 
+  // Like BuildArgArrayFromObjectArray(), but only accepts primitive arguments boxed in their exact
+  // type and reference arguments whose parameter type is already resolved. Never throws or causes
+  // thread suspension, returns false and resets the array if anything else is found instead.
+  bool BuildArgArrayFromExactObjectArray(const ScopedObjectAccessAlreadyRunnable& soa,
+                                         mirror::Object* receiver,
+                                         mirror::ObjectArray<mirror::Object>* args,
+                                         ArtMethod* m,
+                                         const DexFile::TypeList* classes)
+      SHARED_REQUIRES(Locks::mutator_lock_) {
+    if (receiver != nullptr) {
+      Append(receiver);
+    }
+    for (size_t i = 1, args_offset = 0; i < shorty_len_; ++i, ++args_offset) {
+      mirror::Object* arg = args->GetWithoutChecks(args_offset);
+      if (shorty_[i] == 'L') {
+        if (arg != nullptr) {
+          mirror::Class* dst_class =
+              m->GetClassFromTypeIndex(classes->GetTypeItem(args_offset).type_idx_,
+                                       false /* resolve */,
+                                       sizeof(void*));
+          if (UNLIKELY(dst_class == nullptr || !arg->InstanceOf(dst_class))) {
+            num_bytes_ = 0;
+            return false;
+          }
+        }
+        Append(arg);
+        continue;
+      }
+      if (UNLIKELY(arg == nullptr || arg->GetClass() != GetBoxClass(soa, shorty_[i]))) {
+        num_bytes_ = 0;
+        return false;
+      }
+      ArtField* primitive_field = arg->GetClass()->GetInstanceField(0);
+      switch (shorty_[i]) {
+        case 'Z':
+          Append(primitive_field->GetBoolean(arg));
+          break;
+        case 'B':
+          Append(primitive_field->GetByte(arg));
+          break;
+        case 'C':
+          Append(primitive_field->GetChar(arg));
+          break;
+        case 'S':
+          Append(primitive_field->GetShort(arg));
+          break;
+        case 'I':
+          Append(primitive_field->GetInt(arg));
+          break;
+        case 'J':
+          AppendWide(primitive_field->GetLong(arg));
+          break;
+        case 'F':
+          AppendFloat(primitive_field->GetFloat(arg));
+          break;
+        case 'D':
+          AppendDouble(primitive_field->GetDouble(arg));
+          break;
+#ifndef NDEBUG
+        default:
+          LOG(FATAL) << "Unexpected shorty character: " << shorty_[i];
+          UNREACHABLE();
+#endif
+      }
+    }
+    return true;
+  }
+
  private:
+  // Returns the class used to box values of the given primitive type.
+  static mirror::Class* GetBoxClass(const ScopedObjectAccessAlreadyRunnable& soa, char type)
+      SHARED_REQUIRES(Locks::mutator_lock_) {
+    jmethodID value_of = nullptr;
+    switch (type) {
+      case 'Z': value_of = WellKnownClasses::java_lang_Boolean_valueOf; break;
+      case 'B': value_of = WellKnownClasses::java_lang_Byte_valueOf; break;
+      case 'C': value_of = WellKnownClasses::java_lang_Character_valueOf; break;
+      case 'S': value_of = WellKnownClasses::java_lang_Short_valueOf; break;
+      case 'I': value_of = WellKnownClasses::java_lang_Integer_valueOf; break;
+      case 'J': value_of = WellKnownClasses::java_lang_Long_valueOf; break;
+      case 'F': value_of = WellKnownClasses::java_lang_Float_valueOf; break;
+      case 'D': value_of = WellKnownClasses::java_lang_Double_valueOf; break;
+      default:
+        LOG(FATAL) << "Unexpected primitive type: " << type;
+        UNREACHABLE();
+    }
+    return soa.DecodeMethod(value_of)->GetDeclaringClass();
+  }
+
   enum { kSmallArgArraySize = 16 };
   const char* const shorty_;
   const uint32_t shorty_len_;
@@ -562,6 +650,27 @@ JValue InvokeVirtualOrInterfaceWithVarArgs(const ScopedObjectAccessAlreadyRunnab
   return result;
 }
 
+// Replaces the pending exception with an InvocationTargetException wrapping it. If we get another
+// exception when we are trying to wrap, then just use that instead.
+static void WrapPendingExceptionForInvoke(const ScopedObjectAccessAlreadyRunnable& soa)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
+  jthrowable th = soa.Env()->ExceptionOccurred();
+  soa.Self()->ClearException();
+  jclass exception_class = soa.Env()->FindClass("java/lang/reflect/InvocationTargetException");
+  if (exception_class == nullptr) {
+    soa.Self()->AssertPendingOOMException();
+    return;
+  }
+  jmethodID mid = soa.Env()->GetMethodID(exception_class, "<init>", "(Ljava/lang/Throwable;)V");
+  CHECK(mid != nullptr);
+  jobject exception_instance = soa.Env()->NewObject(exception_class, mid, th);
+  if (exception_instance == nullptr) {
+    soa.Self()->AssertPendingOOMException();
+    return;
+  }
+  soa.Env()->Throw(reinterpret_cast<jthrowable>(exception_instance));
+}
+
 jobject InvokeMethod(const ScopedObjectAccessAlreadyRunnable& soa, jobject javaMethod,
                      jobject javaReceiver, jobject javaArgs, size_t num_frames) {
   // We want to make sure that the stack is not within a small distance from the
@@ -646,26 +755,79 @@ jobject InvokeMethod(const ScopedObjectAccessAlreadyRunnable& soa, jobject javaM
 
   // Wrap any exception with "Ljava/lang/reflect/InvocationTargetException;" and return early.
   if (soa.Self()->IsExceptionPending()) {
-    // If we get another exception when we are trying to wrap, then just use that instead.
-    jthrowable th = soa.Env()->ExceptionOccurred();
-    soa.Self()->ClearException();
-    jclass exception_class = soa.Env()->FindClass("java/lang/reflect/InvocationTargetException");
-    if (exception_class == nullptr) {
-      soa.Self()->AssertPendingOOMException();
+    WrapPendingExceptionForInvoke(soa);
+    return nullptr;
+  }
+
+  // Box if necessary and return.
+  return soa.AddLocalReference<jobject>(BoxPrimitive(Primitive::GetType(shorty[0]), result));
+}
+
+jobject InvokeXposedOriginalMethod(const ScopedObjectAccessAlreadyRunnable& soa,
+                                   const XposedHookInfo* hook_info,
+                                   jobject javaReceiver,
+                                   jobject javaArgs) {
+  // We want to make sure that the stack is not within a small distance from the
+  // protected region in case we are calling into a leaf function whose stack
+  // check has been elided.
+  if (UNLIKELY(__builtin_frame_address(0) <
+               soa.Self()->GetStackEndForInterpreter(true))) {
+    ThrowStackOverflowError(soa.Self());
+    return nullptr;
+  }
+
+  // The backup is accessible and direct, so there is no access check and no virtual dispatch.
+  ArtMethod* m = hook_info->original_method;
+  DCHECK(m->IsXposedOriginalMethod());
+  mirror::Class* declaring_class = m->GetDeclaringClass();
+  if (UNLIKELY(!m->IsStatic() && declaring_class->IsStringClass() && m->IsConstructor())) {
+    // Needs to be replaced by a StringFactory call.
+    return InvokeMethod(soa, hook_info->reflected_method, javaReceiver, javaArgs);
+  }
+  if (UNLIKELY(!declaring_class->IsInitialized())) {
+    StackHandleScope<1> hs(soa.Self());
+    Handle<mirror::Class> h_class(hs.NewHandle(declaring_class));
+    if (!Runtime::Current()->GetClassLinker()->EnsureInitialized(soa.Self(), h_class, true, true)) {
       return nullptr;
     }
-    jmethodID mid = soa.Env()->GetMethodID(exception_class, "<init>", "(Ljava/lang/Throwable;)V");
-    CHECK(mid != nullptr);
-    jobject exception_instance = soa.Env()->NewObject(exception_class, mid, th);
-    if (exception_instance == nullptr) {
-      soa.Self()->AssertPendingOOMException();
+    declaring_class = h_class.Get();
+  }
+
+  mirror::Object* receiver = nullptr;
+  if (!m->IsStatic()) {
+    receiver = soa.Decode<mirror::Object*>(javaReceiver);
+    if (!VerifyObjectIsClass(receiver, declaring_class)) {
       return nullptr;
     }
-    soa.Env()->Throw(reinterpret_cast<jthrowable>(exception_instance));
+  }
+
+  auto* objects = soa.Decode<mirror::ObjectArray<mirror::Object>*>(javaArgs);
+  uint32_t shorty_len = 0;
+  const char* shorty = m->GetShorty(&shorty_len);
+  uint32_t arg_count = (objects != nullptr) ? objects->GetLength() : 0;
+  if (UNLIKELY(arg_count != shorty_len - 1)) {
+    ThrowIllegalArgumentException(StringPrintf("Wrong number of arguments; expected %d, got %d",
+                                               shorty_len - 1, arg_count).c_str());
     return nullptr;
   }
 
-  // Box if necessary and return.
+  // Use the cached parameter types for the common case of exactly typed arguments.
+  // Everything else, including errors, is handled by the generic conversions.
+  JValue result;
+  ArgArray arg_array(shorty, shorty_len);
+  if (!arg_array.BuildArgArrayFromExactObjectArray(soa, receiver, objects, m,
+                                                   hook_info->parameter_types) &&
+      !arg_array.BuildArgArrayFromObjectArray(receiver, objects, m)) {
+    CHECK(soa.Self()->IsExceptionPending());
+    return nullptr;
+  }
+
+  InvokeWithArgArray(soa, m, &arg_array, &result, shorty);
+
+  if (soa.Self()->IsExceptionPending()) {
+    WrapPendingExceptionForInvoke(soa);
+    return nullptr;
+  }
   return soa.AddLocalReference<jobject>(BoxPrimitive(Primitive::GetType(shorty[0]), result));
 }
 
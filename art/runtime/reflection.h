@@ -31,6 +31,7 @@ class ArtMethod;
 union JValue;
 class ScopedObjectAccessAlreadyRunnable;
 class ShadowFrame;
+struct XposedHookInfo;
 
 mirror::Object* BoxPrimitive(Primitive::Type src_class, const JValue& value)
     SHARED_REQUIRES(Locks::mutator_lock_);
@@ -66,6 +67,15 @@ jobject InvokeMethod(const ScopedObjectAccessAlreadyRunnable& soa, jobject metho
                      jobject args, size_t num_frames = 1)
     SHARED_REQUIRES(Locks::mutator_lock_);
 
+// Calls the original method of a method hooked by Xposed with arguments boxed in an Object[],
+// like InvokeMethod() for the backup method would, but without access checks and virtual dispatch
+// and with the argument layout cached in the hook info.
+jobject InvokeXposedOriginalMethod(const ScopedObjectAccessAlreadyRunnable& soa,
+                                   const XposedHookInfo* hook_info,
+                                   jobject receiver,
+                                   jobject args)
+    SHARED_REQUIRES(Locks::mutator_lock_);
+
 ALWAYS_INLINE bool VerifyObjectIsClass(mirror::Object* o, mirror::Class* c)
     SHARED_REQUIRES(Locks::mutator_lock_);
 
@@ -140,6 +140,7 @@
 #include "utils.h"
 #include "verifier/method_verifier.h"
 #include "well_known_classes.h"
+#include "xposed_hook_stats.h"
 
 namespace art {
 
@@ -1276,6 +1277,7 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
                        xgc_option.verify_pre_sweeping_rosalloc_,
                        xgc_option.verify_post_gc_rosalloc_,
                        xgc_option.gcstress_,
+                       xgc_option.generational_cc_,
                        runtime_options.GetOrDefault(Opt::EnableHSpaceCompactForOOM),
                        runtime_options.GetOrDefault(Opt::HSpaceCompactForOOMMinIntervalsMs));
 
@@ -1664,6 +1666,7 @@ void Runtime::RegisterRuntimeNativeMethods(JNIEnv* env) {
 
 void Runtime::DumpForSigQuit(std::ostream& os) {
   GetClassLinker()->DumpForSigQuit(os);
+  XposedHookStats::DumpForSigQuit(os);
   GetInternTable()->DumpForSigQuit(os);
   GetJavaVM()->DumpForSigQuit(os);
   GetHeap()->DumpForSigQuit(os);
@@ -784,7 +784,10 @@ QuickMethodFrameInfo StackVisitor::GetCurrentQuickFrameInfo() const {
 void StackVisitor::WalkStack(bool include_transitions) {
   DCHECK(thread_ == Thread::Current() || thread_->IsSuspended());
   CHECK_EQ(cur_depth_, 0U);
-  bool exit_stubs_installed = Runtime::Current()->GetInstrumentation()->AreExitStubsInstalled();
+  // Exit stubs may also have been installed on selected frames only, see
+  // Instrumentation::InstrumentInvalidatedCallerFrames().
+  bool exit_stubs_installed = Runtime::Current()->GetInstrumentation()->AreExitStubsInstalled() ||
+      !thread_->GetInstrumentationStack()->empty();
   uint32_t instrumentation_stack_depth = 0;
   size_t inlined_frames_count = 0;
 
@@ -105,6 +105,15 @@ void ThreadPool::AddTask(Thread* self, Task* task) {
   }
 }
 
+void ThreadPool::AddPriorityTask(Thread* self, Task* task) {
+  MutexLock mu(self, task_queue_lock_);
+  tasks_.push_front(task);
+  // If we have any waiters, signal one.
+  if (started_ && waiting_count_ != 0) {
+    task_queue_condition_.Signal(self);
+  }
+}
+
 void ThreadPool::RemoveAllTasks(Thread* self) {
   MutexLock mu(self, task_queue_lock_);
   tasks_.clear();
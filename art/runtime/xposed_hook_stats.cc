@@ -0,0 +1,163 @@
+#include "xposed_hook_stats.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "art_method-inl.h"
+#include "base/bit_utils.h"
+#include "base/time_utils.h"
+#include "thread-inl.h"
+#include "utils.h"
+
+namespace art {
+
+constexpr size_t XposedHookStats::kMaxDumpedHooks;
+constexpr size_t XposedHookStats::kSubBucketBits;
+constexpr size_t XposedHookStats::kSubBuckets;
+constexpr size_t XposedHookStats::kMaxLatencyBits;
+constexpr size_t XposedHookStats::kNumBuckets;
+
+Atomic<bool> XposedHookStats::enabled_(false);
+Mutex XposedHookStats::registry_lock_("Xposed hook stats registry lock", kDefaultMutexLevel);
+std::vector<XposedHookStats*> XposedHookStats::registry_;
+
+XposedHookStats::XposedHookStats(const std::string& name)
+    : name_(name),
+      calls_(0),
+      total_ns_(0),
+      max_ns_(0) {
+}
+
+XposedHookStats* XposedHookStats::ForHook(ArtMethod* hooked_method,
+                                          const XposedHookInfo* hook_info) {
+  if (LIKELY(!IsEnabled())) {
+    return nullptr;
+  }
+  XposedHookStats* stats = hook_info->stats.LoadSequentiallyConsistent();
+  if (LIKELY(stats != nullptr)) {
+    return stats;
+  }
+
+  // First call since enabling the stats. Another thread might be doing the same.
+  std::unique_ptr<XposedHookStats> new_stats(new XposedHookStats(PrettyMethod(hooked_method)));
+  if (!hook_info->stats.CompareExchangeStrongSequentiallyConsistent(nullptr, new_stats.get())) {
+    return hook_info->stats.LoadSequentiallyConsistent();
+  }
+  MutexLock mu(Thread::Current(), registry_lock_);
+  registry_.push_back(new_stats.get());
+  return new_stats.release();
+}
+
+XposedHookStats* XposedHookStats::Get(const XposedHookInfo* hook_info) {
+  return hook_info->stats.LoadSequentiallyConsistent();
+}
+
+void XposedHookStats::AddCall(uint64_t duration_ns) {
+  calls_.FetchAndAddRelaxed(1);
+  total_ns_.FetchAndAddRelaxed(duration_ns);
+  uint64_t max_ns = max_ns_.LoadRelaxed();
+  while (duration_ns > max_ns && !max_ns_.CompareExchangeWeakRelaxed(max_ns, duration_ns)) {
+    max_ns = max_ns_.LoadRelaxed();
+  }
+  latency_buckets_[GetBucketIndex(duration_ns)].FetchAndAddRelaxed(1);
+}
+
+size_t XposedHookStats::GetBucketIndex(uint64_t duration_ns) {
+  if (duration_ns < kSubBuckets) {
+    return duration_ns;
+  }
+  if (duration_ns >> kMaxLatencyBits != 0) {
+    return kNumBuckets - 1;
+  }
+  size_t msb = static_cast<size_t>(MostSignificantBit(duration_ns));
+  size_t sub_bucket = (duration_ns >> (msb - kSubBucketBits)) & (kSubBuckets - 1);
+  return (msb - kSubBucketBits + 1) * kSubBuckets + sub_bucket;
+}
+
+uint64_t XposedHookStats::GetBucketMidpoint(size_t index) {
+  if (index < kSubBuckets) {
+    return index;
+  }
+  size_t msb = index / kSubBuckets + kSubBucketBits - 1;
+  size_t shift = msb - kSubBucketBits;
+  uint64_t lower = (kSubBuckets + index % kSubBuckets) << shift;
+  return lower + ((UINT64_C(1) << shift) >> 1);
+}
+
+uint64_t XposedHookStats::GetPercentile(double fraction, uint64_t calls) const {
+  uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(fraction * calls + 0.5), 1u);
+  uint64_t count = 0;
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    count += latency_buckets_[i].LoadRelaxed();
+    if (count >= rank) {
+      return GetBucketMidpoint(i);
+    }
+  }
+  return GetBucketMidpoint(kNumBuckets - 1);
+}
+
+XposedHookStats::Snapshot XposedHookStats::GetSnapshot() const {
+  Snapshot snapshot = {};
+  snapshot.calls = GetCalls();
+  snapshot.total_ns = total_ns_.LoadRelaxed();
+  snapshot.max_ns = max_ns_.LoadRelaxed();
+  // Calls may be added meanwhile, so rank by what the buckets hold.
+  uint64_t bucket_calls = 0;
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    bucket_calls += latency_buckets_[i].LoadRelaxed();
+  }
+  if (bucket_calls == 0) {
+    return snapshot;
+  }
+  // The middle of a bucket may be above the slowest call in it.
+  snapshot.median_ns = std::min(GetPercentile(0.5, bucket_calls), snapshot.max_ns);
+  snapshot.p99_ns = std::min(GetPercentile(0.99, bucket_calls), snapshot.max_ns);
+  return snapshot;
+}
+
+void XposedHookStats::Dump(std::ostream& os) const {
+  Snapshot snapshot = GetSnapshot();
+  os << name_ << ": calls=" << snapshot.calls;
+  if (snapshot.calls != 0) {
+    os << " total=" << PrettyDuration(snapshot.total_ns)
+       << " avg=" << PrettyDuration(snapshot.total_ns / snapshot.calls)
+       << " median=" << PrettyDuration(snapshot.median_ns)
+       << " p99=" << PrettyDuration(snapshot.p99_ns)
+       << " max=" << PrettyDuration(snapshot.max_ns);
+  }
+  os << "\n";
+}
+
+void XposedHookStats::DumpForSigQuit(std::ostream& os) {
+  std::vector<XposedHookStats*> all_stats;
+  {
+    MutexLock mu(Thread::Current(), registry_lock_);
+    all_stats = registry_;
+  }
+  if (all_stats.empty() && !IsEnabled()) {
+    return;
+  }
+
+  std::vector<std::pair<uint64_t, XposedHookStats*>> by_total_time;
+  uint64_t total_calls = 0;
+  for (XposedHookStats* stats : all_stats) {
+    Snapshot snapshot = stats->GetSnapshot();
+    total_calls += snapshot.calls;
+    by_total_time.emplace_back(snapshot.total_ns, stats);
+  }
+  std::sort(by_total_time.begin(), by_total_time.end(),
+            [](const std::pair<uint64_t, XposedHookStats*>& lhs,
+               const std::pair<uint64_t, XposedHookStats*>& rhs) {
+              return lhs.first > rhs.first;
+            });
+
+  os << "Xposed hook stats " << (IsEnabled() ? "enabled" : "disabled")
+     << ": hooks called=" << all_stats.size() << " calls=" << total_calls << "\n";
+  for (size_t i = 0; i < by_total_time.size() && i < kMaxDumpedHooks; ++i) {
+    os << "  ";
+    by_total_time[i].second->Dump(os);
+  }
+}
+
+}  // namespace art
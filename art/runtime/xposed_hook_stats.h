@@ -0,0 +1,105 @@
+#ifndef ART_RUNTIME_XPOSED_HOOK_STATS_H_
+#define ART_RUNTIME_XPOSED_HOOK_STATS_H_
+
+#include <stdint.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "atomic.h"
+#include "base/macros.h"
+#include "base/mutex.h"
+
+namespace art {
+
+class ArtMethod;
+struct XposedHookInfo;
+
+// Call count and latency of a single hooked method, measured around the call of
+// XposedBridge.handleHookedMethod(), i.e. including all callbacks and the original method.
+// Only collected while enabled, the stats object of a hook is created on its first call after
+// enabling them and then kept forever.
+class XposedHookStats {
+ public:
+  // Summary returned to Java, see XposedBridge.getHookStatsNative().
+  struct Snapshot {
+    uint64_t calls;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t median_ns;
+    uint64_t p99_ns;
+  };
+
+  static bool IsEnabled() {
+    return enabled_.LoadRelaxed();
+  }
+
+  static void SetEnabled(bool enabled) {
+    enabled_.StoreRelaxed(enabled);
+  }
+
+  // Returns the stats for the hook, creating them if needed, or null if stats are disabled.
+  static XposedHookStats* ForHook(ArtMethod* hooked_method, const XposedHookInfo* hook_info)
+      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(!registry_lock_);
+
+  // Returns the stats for the hook if they have been created, null otherwise.
+  static XposedHookStats* Get(const XposedHookInfo* hook_info);
+
+  // Dumps the hooks with the highest total time, for SIGQUIT.
+  static void DumpForSigQuit(std::ostream& os) REQUIRES(!registry_lock_);
+
+  explicit XposedHookStats(const std::string& name);
+
+  // Lock-free, hooked methods may be called from many threads at the same time.
+  void AddCall(uint64_t duration_ns);
+
+  uint64_t GetCalls() const {
+    return calls_.LoadRelaxed();
+  }
+
+  const std::string& GetName() const {
+    return name_;
+  }
+
+  Snapshot GetSnapshot() const;
+
+  void Dump(std::ostream& os) const;
+
+ private:
+  // Number of hooks listed by DumpForSigQuit().
+  static constexpr size_t kMaxDumpedHooks = 20;
+  // Latencies are counted in buckets of a log-linear histogram: every power of two range is split
+  // into kSubBuckets buckets of equal width, so the percentiles are off by at most 1/kSubBuckets.
+  // Below kSubBuckets ns, each value has its own bucket. Latencies of 2^kMaxLatencyBits ns
+  // (about 18 minutes) or more share the last bucket.
+  static constexpr size_t kSubBucketBits = 3;
+  static constexpr size_t kSubBuckets = 1u << kSubBucketBits;
+  static constexpr size_t kMaxLatencyBits = 40;
+  static constexpr size_t kNumBuckets = (kMaxLatencyBits - kSubBucketBits + 1) * kSubBuckets;
+
+  static size_t GetBucketIndex(uint64_t duration_ns);
+  // Returns the latency in the middle of the bucket.
+  static uint64_t GetBucketMidpoint(size_t index);
+
+  // Returns the latency below which the given fraction of the calls counted in the buckets is.
+  uint64_t GetPercentile(double fraction, uint64_t calls) const;
+
+  static Atomic<bool> enabled_;
+  // All stats objects, for dumping.
+  static Mutex registry_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  static std::vector<XposedHookStats*> registry_ GUARDED_BY(registry_lock_);
+
+  const std::string name_;
+  // Exact, unlike the percentiles.
+  Atomic<uint64_t> calls_;
+  Atomic<uint64_t> total_ns_;
+  Atomic<uint64_t> max_ns_;
+  // Number of calls per latency bucket, for the percentiles.
+  Atomic<uint64_t> latency_buckets_[kNumBuckets];
+
+  DISALLOW_COPY_AND_ASSIGN(XposedHookStats);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_XPOSED_HOOK_STATS_H_
@@ -0,0 +1,76 @@
+#include "xposed_hook_stats.h"
+
+#include <sstream>
+
+#include "common_runtime_test.h"
+
+namespace art {
+
+class XposedHookStatsTest : public CommonRuntimeTest {};
+
+TEST_F(XposedHookStatsTest, Snapshot) {
+  XposedHookStats stats("void Foo.bar()");
+  XposedHookStats::Snapshot snapshot = stats.GetSnapshot();
+  EXPECT_EQ(0u, snapshot.calls);
+  EXPECT_EQ(0u, snapshot.total_ns);
+
+  // 99 fast calls and a slow one.
+  for (size_t i = 0; i < 99; ++i) {
+    stats.AddCall(10 * 1000);
+  }
+  stats.AddCall(5 * 1000 * 1000);
+
+  snapshot = stats.GetSnapshot();
+  EXPECT_EQ(100u, stats.GetCalls());
+  EXPECT_EQ(100u, snapshot.calls);
+  EXPECT_EQ(99u * 10 * 1000 + 5 * 1000 * 1000, snapshot.total_ns);
+  EXPECT_EQ(5u * 1000 * 1000, snapshot.max_ns);
+  EXPECT_LE(snapshot.median_ns, snapshot.p99_ns);
+  EXPECT_LT(snapshot.median_ns, 1000u * 1000);
+
+  std::ostringstream os;
+  stats.Dump(os);
+  EXPECT_EQ(0u, os.str().find("void Foo.bar(): calls=100 "));
+}
+
+// Most hooked calls take less than a microsecond, they must not be rounded away.
+TEST_F(XposedHookStatsTest, SubMicrosecondCalls) {
+  XposedHookStats stats("void Foo.baz()");
+  for (size_t i = 0; i < 1000; ++i) {
+    stats.AddCall(300 + i % 3);
+  }
+
+  XposedHookStats::Snapshot snapshot = stats.GetSnapshot();
+  EXPECT_EQ(1000u, snapshot.calls);
+  EXPECT_EQ(334u * 300 + 333u * 301 + 333u * 302, snapshot.total_ns);
+  EXPECT_EQ(302u, snapshot.max_ns);
+  EXPECT_GE(snapshot.median_ns, 290u);
+  EXPECT_LE(snapshot.median_ns, 310u);
+  EXPECT_LE(snapshot.p99_ns, 310u);
+}
+
+// The percentiles are within an eighth of the real latency, from nanoseconds to minutes.
+TEST_F(XposedHookStatsTest, Percentiles) {
+  XposedHookStats stats("void Foo.qux()");
+  for (size_t i = 0; i < 980; ++i) {
+    stats.AddCall(1000);
+  }
+  for (size_t i = 0; i < 20; ++i) {
+    stats.AddCall(100 * 1000);
+  }
+  XposedHookStats::Snapshot snapshot = stats.GetSnapshot();
+  EXPECT_GE(snapshot.median_ns, 875u);
+  EXPECT_LE(snapshot.median_ns, 1125u);
+  EXPECT_GE(snapshot.p99_ns, 87500u);
+  EXPECT_LE(snapshot.p99_ns, 100u * 1000);
+
+  // Calls longer than the last bucket are still counted.
+  XposedHookStats slow_stats("void Foo.slow()");
+  slow_stats.AddCall(UINT64_C(1) << 50);
+  snapshot = slow_stats.GetSnapshot();
+  EXPECT_EQ(1u, snapshot.calls);
+  EXPECT_EQ(UINT64_C(1) << 50, snapshot.max_ns);
+  EXPECT_NE(0u, snapshot.p99_ns);
+}
+
+}  // namespace art
@@ -0,0 +1,71 @@
+class Base {
+  static int hooked(int x) {
+    return x + 1;
+  }
+
+  static int notHooked(int x) {
+    return x + 2;
+  }
+}
+
+class Derived extends Base {
+}
+
+public class Main {
+
+  public static void assertIntEquals(int expected, int result) {
+    if (expected != result) {
+      throw new Error("Expected: " + expected + ", found: " + result);
+    }
+  }
+
+  /// CHECK-START: int Main.callHooked(int) inliner (after)
+  /// CHECK:                InvokeStaticOrDirect
+
+  /// CHECK-START: int Main.callHooked(int) sharpening (after)
+  /// CHECK:                InvokeStaticOrDirect code_ptr_location:art_method
+
+  public static int callHooked(int x) {
+    return Base.hooked(x);
+  }
+
+  // The call refers to Derived.hooked(), which resolves to the hooked Base.hooked().
+
+  /// CHECK-START: int Main.callHookedThroughSubclass(int) inliner (after)
+  /// CHECK:                InvokeStaticOrDirect
+
+  /// CHECK-START: int Main.callHookedThroughSubclass(int) sharpening (after)
+  /// CHECK:                InvokeStaticOrDirect code_ptr_location:art_method
+
+  public static int callHookedThroughSubclass(int x) {
+    return Derived.hooked(x);
+  }
+
+  /// CHECK-START: int Main.callNotHookedThroughSubclass(int) inliner (after)
+  /// CHECK-NOT:            InvokeStaticOrDirect
+
+  public static int callNotHookedThroughSubclass(int x) {
+    return Derived.notHooked(x);
+  }
+
+  /// CHECK-START: int Main.callHookedIntrinsic(int) intrinsics_recognition (after)
+  /// CHECK:                InvokeStaticOrDirect intrinsic:None
+
+  /// CHECK-START: int Main.callHookedIntrinsic(int) inliner (after)
+  /// CHECK:                InvokeStaticOrDirect
+
+  /// CHECK-START: int Main.callHookedIntrinsic(int) sharpening (after)
+  /// CHECK:                InvokeStaticOrDirect code_ptr_location:art_method
+
+  public static int callHookedIntrinsic(int x) {
+    return Math.abs(x);
+  }
+
+  public static void main(String[] args) {
+    assertIntEquals(2, callHooked(1));
+    assertIntEquals(2, callHookedThroughSubclass(1));
+    assertIntEquals(3, callNotHookedThroughSubclass(1));
+    assertIntEquals(1, callHookedIntrinsic(-1));
+    System.out.println("passed");
+  }
+}